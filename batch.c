@@ -0,0 +1,541 @@
+/* headless batch runner. runs any number of cartridges side by side, one
+ * emulator context per worker thread, and reports a hash of the vector list
+ * and of the sound output for every frame so that the results of two builds
+ * can be diffed.
+ *
+ * usage: vecx_batch [-j threads] [-n frames] [-r rate] [-b bios] [-o dir]
+ *                   [-d dir] cart[:script] ...
+ *
+ * every line of an input script is
+ *
+ *    frame buttons x0 y0 x1 y1
+ *
+ * and holds from that frame on. buttons is a hex mask of the pressed
+ * buttons, bits 0-3 for pad 1 and bits 4-7 for pad 2. the axes are the
+ * joystick channels, 0 to 255 with 128 in the centre. blank lines and
+ * lines starting with # are ignored, any other line that does not parse
+ * fails the job.
+ *
+ * a frame is 1/50 of a second, as in the libretro core. the results of a
+ * job go to dir/<cart>.txt, or to stdout in job order when no directory is
+ * given, one line per frame:
+ *
+ *    <frame> <vectors> <vector hash> <sound hash>
+ *
+ * the vector hash is that of the last list drawn by the end of the frame.
+ * with -d the full vector lists and sound are also dumped to dir/<cart>.vxd,
+ * see dump.h, for comparison with vecx_dumpcmp.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "osint.h"
+#include "vecx.h"
+#include "e8910.h"
+#include "dump.h"
+
+#include "bios/system.h"
+
+#define FRAME_CYCLES (VECTREX_MHZ / 50)
+
+typedef struct input_type {
+   long frame;
+   unsigned buttons;
+   unsigned axis[4];
+} input_t;
+
+typedef struct job_type {
+   const char *cart;
+   const char *script;
+
+   char *out;    /* results, NULL when written to a file */
+   size_t out_len;
+   size_t out_size;
+   int failed;   /* set until the job has run without error */
+} job_t;
+
+/* osint_render is handed the context, which is the first member */
+
+typedef struct worker_type {
+   vecx_context_t vc;
+
+   long vector_cnt;     /* of the last frame drawn */
+   uint64_t vector_hash;
+
+   FILE *dump;          /* NULL unless dumping */
+   long frame;
+   int dump_failed;
+} worker_t;
+
+static job_t *jobs;
+static int job_cnt;
+static int job_next;
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static long frames    = 3000;
+static int bios_loaded;
+static unsigned rate  = 44100;
+static const char *out_dir;
+static const char *dump_dir;
+
+/* 64-bit fnv-1a */
+
+static uint64_t hash_bytes(uint64_t h, const unsigned char *p, size_t len)
+{
+   while (len-- > 0)
+   {
+      h ^= *p++;
+      h *= 0x100000001b3ull;
+   }
+
+   return h;
+}
+
+static uint64_t hash_u16(uint64_t h, unsigned v)
+{
+   unsigned char b[2];
+
+   b[0] = v & 0xff;
+   b[1] = (v >> 8) & 0xff;
+
+   return hash_bytes(h, b, 2);
+}
+
+void osint_render(vecx_context_t *vc)
+{
+   worker_t *w = (worker_t *) vc;
+   uint64_t h  = 0xcbf29ce484222325ull;
+   long i;
+
+   for (i = 0; i < vc->vector_draw_cnt; i++)
+   {
+      const vector_t *v = &vc->vectors_draw[i];
+
+      h = hash_u16(h, v->x0);
+      h = hash_u16(h, v->y0);
+      h = hash_u16(h, v->x1);
+      h = hash_u16(h, v->y1);
+      h = hash_u16(h, v->color);
+   }
+
+   w->vector_cnt  = vc->vector_draw_cnt;
+   w->vector_hash = h;
+
+   if (w->dump && !dump_write_vectors(w->dump, w->frame, vc->vectors_draw,
+            vc->vector_draw_cnt))
+      w->dump_failed = 1;
+}
+
+static void job_write(job_t *job, FILE *f, const char *line)
+{
+   size_t len = strlen(line);
+
+   if (f)
+   {
+      fputs(line, f);
+      return;
+   }
+
+   if (job->out_len + len + 1 > job->out_size)
+   {
+      size_t size = (job->out_size + len + 1) * 2;
+      char *out   = (char *) realloc(job->out, size);
+
+      /* the results are incomplete from here on, fail the job once */
+      if (!out)
+      {
+         if (!job->failed)
+            fprintf(stderr, "%s: out of memory\n", job->cart);
+         job->failed = 1;
+         return;
+      }
+
+      job->out      = out;
+      job->out_size = size;
+   }
+
+   memcpy(job->out + job->out_len, line, len + 1);
+   job->out_len += len;
+}
+
+static FILE *open_result(const job_t *job, const char *dir,
+      const char *ext, const char *mode)
+{
+   const char *base = strrchr(job->cart, '/');
+   char path[1024];
+   FILE *f;
+
+   snprintf(path, sizeof(path), "%s/%s%s", dir, base ? base + 1 : job->cart,
+         ext);
+
+   if (!(f = fopen(path, mode)))
+      fprintf(stderr, "%s: cannot write results\n", path);
+
+   return f;
+}
+
+/* returns NULL after reporting why the script cannot be used */
+
+static input_t *load_script(const char *path, int *cnt)
+{
+   FILE *f = fopen(path, "r");
+   input_t *inputs = NULL;
+   char line[256];
+   int size = 0, line_no = 0, ok = 1;
+
+   *cnt = 0;
+
+   if (!f)
+   {
+      fprintf(stderr, "%s: cannot read input script\n", path);
+      return NULL;
+   }
+
+   while (fgets(line, sizeof(line), f))
+   {
+      input_t in;
+
+      line_no++;
+
+      if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0')
+         continue;
+
+      if (sscanf(line, "%ld %x %u %u %u %u", &in.frame, &in.buttons,
+               &in.axis[0], &in.axis[1], &in.axis[2], &in.axis[3]) != 6)
+      {
+         fprintf(stderr, "%s:%d: bad input line\n", path, line_no);
+         ok = 0;
+         break;
+      }
+
+      if (*cnt == size)
+      {
+         int grown     = size ? size * 2 : 64;
+         input_t *more = (input_t *) realloc(inputs,
+               grown * sizeof(*inputs));
+
+         if (!more)
+         {
+            fprintf(stderr, "%s: out of memory\n", path);
+            ok = 0;
+            break;
+         }
+
+         inputs = more;
+         size   = grown;
+      }
+
+      inputs[(*cnt)++] = in;
+   }
+
+   fclose(f);
+
+   if (!ok)
+   {
+      free(inputs);
+      *cnt = 0;
+      return NULL;
+   }
+
+   /* an empty script is still a script */
+   if (!inputs && !(inputs = (input_t *) malloc(sizeof(*inputs))))
+      fprintf(stderr, "%s: out of memory\n", path);
+
+   return inputs;
+}
+
+static int load_cart(vecx_context_t *vc, const char *path)
+{
+   unsigned char data[4096];
+   FILE *f = fopen(path, "rb");
+   unsigned pos = 0;
+   size_t size, b;
+
+   if (!f)
+      return 0;
+
+   /* the context was cleared, so the rest of the space stays 0 */
+   while ((size = fread(data, 1, sizeof(data), f)) > 0)
+   {
+      /* larger images do not fit the cartridge space */
+      if (pos + size > sizeof(vc->cart))
+      {
+         fclose(f);
+         return 0;
+      }
+
+      for (b = 0; b < size; b++)
+         set_cart(vc, pos++, data[b]);
+   }
+
+   fclose(f);
+
+   return pos > 0;
+}
+
+static void run_job(worker_t *w, job_t *job)
+{
+   vecx_context_t *vc = &w->vc;
+   int16_t buffer[E8910_MAX_SAMPLES * 2];
+   int samples = rate / 50;
+   input_t *inputs = NULL;
+   int input_cnt = 0, next = 0;
+   FILE *f = NULL;
+   uint64_t sound_hash;
+   char line[128];
+   long frame;
+   int i;
+
+   /* start from nothing, a previous job must not leak into this one */
+   memset(w, 0, sizeof(*w));
+   job->failed = 0;
+
+   if (job->script && !(inputs = load_script(job->script, &input_cnt)))
+   {
+      job->failed = 1;
+      return;
+   }
+
+   if (!load_cart(vc, job->cart))
+   {
+      fprintf(stderr, "%s: cannot load cartridge\n", job->cart);
+      free(inputs);
+      job->failed = 1;
+      return;
+   }
+
+   if ((out_dir && !(f = open_result(job, out_dir, ".txt", "w"))) ||
+         (dump_dir && !(w->dump = open_result(job, dump_dir, ".vxd", "wb"))))
+   {
+      if (f)
+         fclose(f);
+      free(inputs);
+      job->failed = 1;
+      return;
+   }
+
+   if (w->dump && !dump_write_header(w->dump, rate))
+      w->dump_failed = 1;
+
+   e8910_set_rate(&vc->psg, rate);
+   vecx_reset(vc);
+   e8910_init_sound(&vc->psg);
+
+   for (frame = 0; frame < frames; frame++)
+   {
+      w->frame = frame;
+
+      while (next < input_cnt && inputs[next].frame <= frame)
+      {
+         const input_t *in = &inputs[next++];
+
+         vc->psg.snd_regs[14] = ~in->buttons & 0xff;
+         vc->alg_jch0 = in->axis[0];
+         vc->alg_jch1 = in->axis[1];
+         vc->alg_jch2 = in->axis[2];
+         vc->alg_jch3 = in->axis[3];
+      }
+
+      vecx_emu(vc, FRAME_CYCLES);
+      e8910_callback(&vc->psg, buffer, samples);
+
+      if (w->dump && !dump_write_sound(w->dump, frame, buffer, samples))
+         w->dump_failed = 1;
+
+      sound_hash = 0xcbf29ce484222325ull;
+
+      for (i = 0; i < samples * 2; i++)
+         sound_hash = hash_u16(sound_hash, (uint16_t) buffer[i]);
+
+      snprintf(line, sizeof(line), "%ld %ld %016llx %016llx\n", frame,
+            w->vector_cnt, (unsigned long long) w->vector_hash,
+            (unsigned long long) sound_hash);
+      job_write(job, f, line);
+   }
+
+   if (f)
+      fclose(f);
+
+   if (w->dump && fclose(w->dump) != 0)
+      w->dump_failed = 1;
+
+   if (w->dump_failed)
+   {
+      fprintf(stderr, "%s: cannot write dump\n", job->cart);
+      job->failed = 1;
+   }
+
+   free(inputs);
+}
+
+static void *worker(void *arg)
+{
+   worker_t *w = (worker_t *) malloc(sizeof(*w));
+
+   (void) arg;
+
+   if (!w)
+   {
+      fprintf(stderr, "vecx_batch: cannot allocate worker\n");
+      return NULL;
+   }
+
+   for (;;)
+   {
+      int i;
+
+      pthread_mutex_lock(&job_lock);
+      i = job_next++;
+      pthread_mutex_unlock(&job_lock);
+
+      if (i >= job_cnt)
+         break;
+
+      run_job(w, &jobs[i]);
+   }
+
+   free(w);
+
+   return NULL;
+}
+
+static void usage(void)
+{
+   fprintf(stderr, "usage: vecx_batch [-j threads] [-n frames] [-r rate] "
+         "[-b bios] [-o dir] [-d dir] cart[:script] ...\n");
+   exit(2);
+}
+
+int main(int argc, char **argv)
+{
+   pthread_t *threads;
+   int thread_cnt = 0, started = 0;
+   int i, failed = 0;
+   int opt;
+
+   while ((opt = getopt(argc, argv, "j:n:r:b:o:d:")) != -1)
+   {
+      switch (opt)
+      {
+         case 'j':
+            thread_cnt = atoi(optarg);
+            break;
+         case 'n':
+            frames = atol(optarg);
+            break;
+         case 'r':
+            rate = strtoul(optarg, NULL, 0);
+            break;
+         case 'b':
+            {
+               FILE *f = fopen(optarg, "rb");
+
+               if (!f || fread(rom, 1, sizeof(rom), f) != sizeof(rom))
+               {
+                  fprintf(stderr, "%s: cannot load bios\n", optarg);
+                  return 1;
+               }
+
+               fclose(f);
+               bios_loaded = 1;
+            }
+            break;
+         case 'o':
+            out_dir = optarg;
+            break;
+         case 'd':
+            dump_dir = optarg;
+            break;
+         default:
+            usage();
+      }
+   }
+
+   if (optind >= argc || rate == 0 || rate / 50 > E8910_MAX_SAMPLES)
+      usage();
+
+   /* the bios is shared by every context */
+   if (!bios_loaded)
+      memcpy(rom, bios_data, sizeof(rom));
+
+   job_cnt = argc - optind;
+   jobs    = (job_t *) calloc(job_cnt, sizeof(*jobs));
+
+   if (!jobs)
+   {
+      fprintf(stderr, "vecx_batch: out of memory\n");
+      return 1;
+   }
+
+   /* a job no worker got to stays failed */
+   for (i = 0; i < job_cnt; i++)
+   {
+      char *sep = strchr(argv[optind + i], ':');
+
+      jobs[i].failed = 1;
+
+      if (sep)
+      {
+         *sep = '\0';
+         jobs[i].script = sep + 1;
+      }
+
+      jobs[i].cart = argv[optind + i];
+   }
+
+   if (thread_cnt <= 0)
+   {
+#ifdef _SC_NPROCESSORS_ONLN
+      thread_cnt = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+      if (thread_cnt <= 0)
+         thread_cnt = 1;
+   }
+
+   if (thread_cnt > job_cnt)
+      thread_cnt = job_cnt;
+
+   threads = (pthread_t *) malloc(thread_cnt * sizeof(*threads));
+
+   if (!threads)
+      thread_cnt = 0;
+
+   for (i = 0; i < thread_cnt; i++)
+   {
+      if (pthread_create(&threads[started], NULL, worker, NULL) != 0)
+         fprintf(stderr, "vecx_batch: cannot start thread %d\n", i);
+      else
+         started++;
+   }
+
+   for (i = 0; i < started; i++)
+      pthread_join(threads[i], NULL);
+
+   for (i = 0; i < job_cnt; i++)
+   {
+      if (jobs[i].failed)
+      {
+         /* run_job reports its own errors, these were never started */
+         if (i >= job_next)
+            fprintf(stderr, "%s: not run\n", jobs[i].cart);
+         failed = 1;
+      }
+      else if (jobs[i].out)
+      {
+         printf("# %s\n", jobs[i].cart);
+         fputs(jobs[i].out, stdout);
+      }
+
+      free(jobs[i].out);
+   }
+
+   free(threads);
+   free(jobs);
+
+   return failed;
+}
@@ -0,0 +1,393 @@
+/* microbenchmarks for the parts of the core that optimization work goes
+ * into, each timed on its own so that a change to one shows up in its
+ * number alone:
+ *
+ *    e6809    e6809_sstep on a loop of mixed instructions in flat memory
+ *    emu      vecx_emu booting the real bios into mine storm, no rendering
+ *    psg      e8910_callback with all channels, noise and the envelope busy
+ *    render   the software osint_render at every resolution, drawing the
+ *             vector lists of the last second of the emu run
+ *    smooth   the same with the smooth software renderer
+ *
+ * usage: vecx_bench [-r runs] [-t threads] [benchmark ...]
+ *
+ * every benchmark does a fixed amount of work runs times and reports the
+ * fastest, which is the most repeatable figure on a busy machine. threads
+ * is passed to the renderer as the vecx_sw_threads option.
+ */
+
+#include <time.h>
+#include <unistd.h>
+
+/* the software renderer lives in libretro.c along with its state, so it is
+ * built into this file with the gpu path left out. its osint_render is
+ * renamed to make way for the one below, which only keeps the vector
+ * lists for the render benchmark.
+ */
+
+#undef HAS_GPU
+#define STANDARD_BIOS
+#define osint_render sw_osint_render
+#include "libretro.c"
+#undef osint_render
+
+void osint_render(vecx_context_t *vc);
+
+#define FRAME_CYCLES  (VECTREX_MHZ / 50)
+
+#define E6809_STEPS   20000000
+#define EMU_FRAMES    1500
+#define PSG_FRAMES    5000
+#define RENDER_FRAMES 50     /* lists kept for the render benchmark */
+#define RENDER_LOOPS  20     /* times each of them is drawn */
+
+typedef struct bench_type {
+   const char *name;
+   void (*run)(double *amount);
+   const char *unit;
+} bench_t;
+
+static int runs = 5;
+
+static double now(void)
+{
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+
+   return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* e6809 */
+
+static unsigned char cpu_mem[65536];
+static unsigned char *cpu_pages[256];
+
+/* a loop touching loads and stores in several addressing modes, alu and
+ * 16-bit arithmetic, mul, the stack, a subroutine and short and taken and
+ * untaken branches.
+ */
+
+static const unsigned char cpu_prog[] = {
+   0x10, 0xce, 0x80, 0x00, /* 1000 lds  #$8000 */
+   0x8e, 0x20, 0x00,       /* 1004 ldx  #$2000 */
+   0xce, 0x30, 0x00,       /* 1007 ldu  #$3000 */
+   0xa6, 0x80,             /* 100a lda  ,x+ */
+   0x8b, 0x13,             /* 100c adda #$13 */
+   0xa7, 0xc4,             /* 100e sta  ,u */
+   0xe6, 0x88, 0x10,       /* 1010 ldb  $10,x */
+   0x3d,                   /* 1013 mul */
+   0xc3, 0x12, 0x34,       /* 1014 addd #$1234 */
+   0xed, 0x42,             /* 1017 std  2,u */
+   0x34, 0x16,             /* 1019 pshs x,b,a */
+   0x8d, 0x13,             /* 101b bsr  $1030 */
+   0x35, 0x16,             /* 101d puls a,b,x */
+   0x44,                   /* 101f lsra */
+   0x56,                   /* 1020 rorb */
+   0xc4, 0x07,             /* 1021 andb #$07 */
+   0x5a,                   /* 1023 decb */
+   0x2a, 0xfd,             /* 1024 bpl  $1023 */
+   0x8c, 0x21, 0x00,       /* 1026 cmpx #$2100 */
+   0x26, 0xdf,             /* 1029 bne  $100a */
+   0x8e, 0x20, 0x00,       /* 102b ldx  #$2000 */
+   0x20, 0xda,             /* 102e bra  $100a */
+   0x9e, 0x40,             /* 1030 ldx  <$40 */
+   0x30, 0x01,             /* 1032 leax 1,x */
+   0x9f, 0x40,             /* 1034 stx  <$40 */
+   0x39                    /* 1036 rts */
+};
+
+static unsigned char cpu_read8(void *user, unsigned address)
+{
+   return cpu_mem[address];
+}
+
+static void cpu_write8(void *user, unsigned address, unsigned char data)
+{
+   cpu_mem[address] = data;
+}
+
+static void bench_e6809(double *amount)
+{
+   e6809_t cpu;
+   unsigned long cycles = 0;
+   long i;
+
+   memset(cpu_mem, 0, sizeof(cpu_mem));
+   memcpy(cpu_mem + 0x1000, cpu_prog, sizeof(cpu_prog));
+   cpu_mem[0xfffe] = 0x10;
+   cpu_mem[0xffff] = 0x00;
+
+   for (i = 0; i < 256; i++)
+      cpu_pages[i] = cpu_mem + i * 256;
+
+   memset(&cpu, 0, sizeof(cpu));
+   cpu.read8     = cpu_read8;
+   cpu.write8    = cpu_write8;
+   cpu.fetch_map = cpu_pages;
+   e6809_reset(&cpu);
+
+   for (i = 0; i < E6809_STEPS; i++)
+      cycles += e6809_sstep(&cpu, 0, 0);
+
+   amount[0] = E6809_STEPS;
+   amount[1] = cycles;
+}
+
+/* emu */
+
+static vector_t *render_lists[RENDER_FRAMES];
+static long render_cnt[RENDER_FRAMES];
+static long render_frame;
+
+void osint_render(vecx_context_t *vc)
+{
+   long i = render_frame++ % RENDER_FRAMES;
+   vector_t *list = (vector_t *) realloc(render_lists[i],
+         (vc->vector_draw_cnt + 1) * sizeof(vector_t));
+
+   /* the render benchmarks mean nothing without the lists */
+   if (!list)
+   {
+      fprintf(stderr, "vecx_bench: out of memory for the vector lists\n");
+      exit(1);
+   }
+
+   render_lists[i] = list;
+   render_cnt[i]   = vc->vector_draw_cnt;
+   memcpy(render_lists[i], vc->vectors_draw,
+         vc->vector_draw_cnt * sizeof(vector_t));
+}
+
+static void bench_emu(double *amount)
+{
+   static vecx_context_t vc;
+   long frame;
+
+   memset(&vc, 0, sizeof(vc));
+   memcpy(rom, bios_data, bios_data_size);
+   vecx_reset(&vc);
+   e8910_init_sound(&vc.psg);
+
+   for (frame = 0; frame < EMU_FRAMES; frame++)
+      vecx_emu(&vc, FRAME_CYCLES);
+
+   amount[0] = (double) EMU_FRAMES * FRAME_CYCLES;
+   amount[1] = (double) EMU_FRAMES / 50;
+}
+
+/* psg */
+
+static void bench_psg_rate(double *amount, unsigned rate)
+{
+   static e8910_t psg;
+   int16_t buffer[E8910_MAX_SAMPLES * 2];
+   int samples = rate / 50;
+   long frame;
+
+   memset(&psg, 0, sizeof(psg));
+   e8910_set_rate(&psg, rate);
+   e8910_init_sound(&psg);
+
+   e8910_write(&psg, 6, 0x07);  /* noise period */
+   e8910_write(&psg, 7, 0x30);  /* tones on a, b, c and noise on a, b */
+   e8910_write(&psg, 8, 0x10);  /* a on the envelope */
+   e8910_write(&psg, 9, 0x0c);
+   e8910_write(&psg, 10, 0x0a);
+   e8910_write(&psg, 11, 0x40); /* envelope period */
+   e8910_write(&psg, 12, 0x00);
+   e8910_write(&psg, 13, 0x0e); /* triangle */
+
+   for (frame = 0; frame < PSG_FRAMES; frame++)
+   {
+      int i;
+
+      /* sweep the tones a few times a frame, as games do */
+      for (i = 0; i < 4; i++)
+      {
+         unsigned cycle = i * FRAME_CYCLES / 4;
+         unsigned period = 0x40 + ((frame * 4 + i) & 0xff);
+
+         e8910_write_at(&psg, cycle, 0, period & 0xff);
+         e8910_write_at(&psg, cycle, 2, (period * 3 / 2) & 0xff);
+         e8910_write_at(&psg, cycle, 4, (period / 2) & 0xff);
+      }
+
+      e8910_callback(&psg, buffer, samples);
+   }
+
+   amount[0] = (double) PSG_FRAMES * samples;
+   amount[1] = (double) PSG_FRAMES / 50;
+}
+
+static void bench_psg_22050(double *amount) { bench_psg_rate(amount, 22050); }
+static void bench_psg_44100(double *amount) { bench_psg_rate(amount, 44100); }
+static void bench_psg_48000(double *amount) { bench_psg_rate(amount, 48000); }
+
+/* render */
+
+static const char *render_res;
+static const char *render_quality;
+static const char *render_threads = "1";
+
+static bool render_environ(unsigned cmd, void *data)
+{
+   struct retro_variable *var = (struct retro_variable *) data;
+
+   if (cmd != RETRO_ENVIRONMENT_GET_VARIABLE)
+      return false;
+
+   if (!strcmp(var->key, "vecx_res_multi"))
+      var->value = render_res;
+   else if (!strcmp(var->key, "vecx_sw_quality"))
+      var->value = render_quality;
+   else if (!strcmp(var->key, "vecx_sw_threads"))
+      var->value = render_threads;
+   else
+      return false;
+
+   return true;
+}
+
+static void bench_render_res(double *amount, const char *res,
+      const char *quality)
+{
+   static vecx_context_t vc;
+   long lines = 0;
+   int loop, i;
+
+   render_res     = res;
+   render_quality = quality;
+   check_variables(false);
+
+   /* the first frame after a change of resolution is drawn in full */
+   tile_width = 0;
+
+   for (loop = 0; loop < RENDER_LOOPS; loop++)
+   {
+      for (i = 0; i < RENDER_FRAMES; i++)
+      {
+         vc.vectors_draw    = render_lists[i];
+         vc.vector_draw_cnt = render_cnt[i];
+         sw_osint_render(&vc);
+         lines += render_cnt[i];
+      }
+   }
+
+   amount[0] = lines;
+   amount[1] = RENDER_LOOPS * RENDER_FRAMES / 50.0;
+}
+
+static void bench_render_1(double *amount) { bench_render_res(amount, "1", "Standard"); }
+static void bench_render_2(double *amount) { bench_render_res(amount, "2", "Standard"); }
+static void bench_render_3(double *amount) { bench_render_res(amount, "3", "Standard"); }
+static void bench_render_4(double *amount) { bench_render_res(amount, "4", "Standard"); }
+static void bench_smooth_1(double *amount) { bench_render_res(amount, "1", "Smooth"); }
+static void bench_smooth_2(double *amount) { bench_render_res(amount, "2", "Smooth"); }
+static void bench_smooth_3(double *amount) { bench_render_res(amount, "3", "Smooth"); }
+static void bench_smooth_4(double *amount) { bench_render_res(amount, "4", "Smooth"); }
+
+/* render and smooth need the lists of emu, so the order matters */
+
+static const bench_t benches[] = {
+   { "e6809",        bench_e6809,     "instructions" },
+   { "emu",          bench_emu,       "cycles" },
+   { "psg 22050",    bench_psg_22050, "samples" },
+   { "psg 44100",    bench_psg_44100, "samples" },
+   { "psg 48000",    bench_psg_48000, "samples" },
+   { "render 1x",    bench_render_1,  "lines" },
+   { "render 2x",    bench_render_2,  "lines" },
+   { "render 3x",    bench_render_3,  "lines" },
+   { "render 4x",    bench_render_4,  "lines" },
+   { "smooth 1x",    bench_smooth_1,  "lines" },
+   { "smooth 2x",    bench_smooth_2,  "lines" },
+   { "smooth 3x",    bench_smooth_3,  "lines" },
+   { "smooth 4x",    bench_smooth_4,  "lines" }
+};
+
+static bool selected(const bench_t *b, int argc, char **argv)
+{
+   int i;
+
+   if (optind >= argc)
+      return true;
+
+   /* a name selects every benchmark that starts with it */
+   for (i = optind; i < argc; i++)
+   {
+      if (!strncmp(b->name, argv[i], strlen(argv[i])))
+         return true;
+   }
+
+   return false;
+}
+
+int main(int argc, char **argv)
+{
+   int opt;
+   size_t i;
+
+   while ((opt = getopt(argc, argv, "r:t:")) != -1)
+   {
+      switch (opt)
+      {
+         case 'r':
+            runs = atoi(optarg);
+            break;
+         case 't':
+            render_threads = optarg;
+            break;
+         default:
+            fprintf(stderr, "usage: vecx_bench [-r runs] [-t threads] "
+                  "[benchmark ...]\n");
+            return 2;
+      }
+   }
+
+   if (runs < 1)
+      runs = 1;
+
+   /* the resolution is picked through the core option */
+   retro_set_environment(render_environ);
+
+   for (i = 0; i < ARRAY_SIZE(benches); i++)
+   {
+      const bench_t *b = &benches[i];
+      double best = 0, amount[2] = { 0, 0 };
+      int run;
+
+      if (!selected(b, argc, argv))
+         continue;
+
+      if (!strcmp(b->unit, "lines") && !render_frame)
+      {
+         double skip[2];
+
+         /* only boot far enough to have something on screen */
+         bench_emu(skip);
+      }
+
+      for (run = 0; run < runs; run++)
+      {
+         double start = now(), time;
+
+         b->run(amount);
+         time = now() - start;
+
+         if (run == 0 || time < best)
+            best = time;
+      }
+
+      /* amount[1] is cycles for the cpu, otherwise seconds of emulated
+       * time
+       */
+      if (!strcmp(b->name, "e6809"))
+         printf("%-10s %8.2f M %s/s  %8.2f emulated MHz\n", b->name,
+               amount[0] / best / 1e6, b->unit, amount[1] / best / 1e6);
+      else
+         printf("%-10s %8.2f M %s/s  %8.1fx real time\n", b->name,
+               amount[0] / best / 1e6, b->unit, amount[1] / best);
+   }
+
+   return 0;
+}
@@ -0,0 +1,178 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "dump.h"
+
+static const char dump_magic[6] = { 'V', 'X', 'D', 'U', 'M', 'P' };
+
+static int put_u16(FILE *f, unsigned v)
+{
+   return putc(v & 0xff, f) != EOF && putc((v >> 8) & 0xff, f) != EOF;
+}
+
+static int put_u32(FILE *f, unsigned long v)
+{
+   return put_u16(f, v & 0xffff) && put_u16(f, (v >> 16) & 0xffff);
+}
+
+static int get_u16(FILE *f, unsigned *v)
+{
+   int lo = getc(f);
+   int hi = getc(f);
+
+   if (lo == EOF || hi == EOF)
+      return 0;
+
+   *v = (unsigned) lo | ((unsigned) hi << 8);
+
+   return 1;
+}
+
+static int get_u32(FILE *f, unsigned long *v)
+{
+   unsigned lo, hi;
+
+   if (!get_u16(f, &lo) || !get_u16(f, &hi))
+      return 0;
+
+   *v = (unsigned long) lo | ((unsigned long) hi << 16);
+
+   return 1;
+}
+
+int dump_write_header(FILE *f, unsigned rate)
+{
+   return fwrite(dump_magic, 1, sizeof(dump_magic), f) == sizeof(dump_magic) &&
+      put_u16(f, DUMP_VERSION) && put_u32(f, rate);
+}
+
+int dump_write_vectors(FILE *f, unsigned long frame, const vector_t *vectors,
+      long count)
+{
+   long i;
+
+   if (putc(DUMP_VECTORS, f) == EOF || !put_u32(f, frame) ||
+         !put_u32(f, count))
+      return 0;
+
+   for (i = 0; i < count; i++)
+   {
+      const vector_t *v = &vectors[i];
+
+      if (!put_u16(f, v->x0) || !put_u16(f, v->y0) ||
+            !put_u16(f, v->x1) || !put_u16(f, v->y1) ||
+            putc(v->color, f) == EOF)
+         return 0;
+   }
+
+   return 1;
+}
+
+int dump_write_sound(FILE *f, unsigned long frame, const int16_t *stream,
+      int length)
+{
+   int i;
+
+   if (putc(DUMP_SOUND, f) == EOF || !put_u32(f, frame) ||
+         !put_u32(f, length))
+      return 0;
+
+   for (i = 0; i < length; i++)
+   {
+      if (!put_u16(f, (uint16_t) stream[i * 2]))
+         return 0;
+   }
+
+   return 1;
+}
+
+int dump_read_header(FILE *f, unsigned *rate)
+{
+   char magic[sizeof(dump_magic)];
+   unsigned version;
+   unsigned long r;
+
+   if (fread(magic, 1, sizeof(magic), f) != sizeof(magic) ||
+         memcmp(magic, dump_magic, sizeof(magic)) != 0 ||
+         !get_u16(f, &version) || version != DUMP_VERSION ||
+         !get_u32(f, &r))
+      return 0;
+
+   *rate = (unsigned) r;
+
+   return 1;
+}
+
+int dump_read(FILE *f, dump_record_t *rec)
+{
+   unsigned long i;
+   int kind = getc(f);
+
+   if (kind == EOF)
+      return 0;
+
+   if ((kind != DUMP_VECTORS && kind != DUMP_SOUND) ||
+         !get_u32(f, &rec->frame) || !get_u32(f, &rec->count))
+      return -1;
+
+   rec->kind = kind;
+
+   if (rec->count > rec->size)
+   {
+      /* a single record never comes near the largest list or frame */
+      if (rec->count > 2 * VECTOR_CNT)
+         return -1;
+
+      free(rec->vectors);
+      free(rec->samples);
+
+      rec->size    = rec->count;
+      rec->vectors = (vector_t *) malloc(rec->size * sizeof(*rec->vectors));
+      rec->samples = (int16_t *) malloc(rec->size * sizeof(*rec->samples));
+
+      if (!rec->vectors || !rec->samples)
+      {
+         rec->size = 0;
+         return -1;
+      }
+   }
+
+   for (i = 0; i < rec->count; i++)
+   {
+      if (kind == DUMP_VECTORS)
+      {
+         vector_t *v = &rec->vectors[i];
+         unsigned x0, y0, x1, y1;
+         int color;
+
+         if (!get_u16(f, &x0) || !get_u16(f, &y0) ||
+               !get_u16(f, &x1) || !get_u16(f, &y1) ||
+               (color = getc(f)) == EOF)
+            return -1;
+
+         v->x0    = (unsigned short) x0;
+         v->y0    = (unsigned short) y0;
+         v->x1    = (unsigned short) x1;
+         v->y1    = (unsigned short) y1;
+         v->color = (unsigned char) color;
+      }
+      else
+      {
+         unsigned s;
+
+         if (!get_u16(f, &s))
+            return -1;
+
+         rec->samples[i] = (int16_t) s;
+      }
+   }
+
+   return 1;
+}
+
+void dump_free(dump_record_t *rec)
+{
+   free(rec->vectors);
+   free(rec->samples);
+   memset(rec, 0, sizeof(*rec));
+}
@@ -0,0 +1,57 @@
+#ifndef __DUMP_H
+#define __DUMP_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "vecx.h"
+
+/* dumps of the vector lists and sound produced by a run, for golden tests
+ * that do not depend on a renderer. a dump is a header followed by
+ * records, with all integers little-endian:
+ *
+ *    header   "VXDUMP" u16 version, u32 sample rate
+ *    vectors  'V' u32 frame, u32 count, count * (u16 x0 y0 x1 y1, u8 color)
+ *    sound    'S' u32 frame, u32 count, count * s16
+ *
+ * a vector record is written whenever a list is drawn, a sound record
+ * every frame. the psg output is mono so only the left channel is kept.
+ */
+
+#define DUMP_VERSION 1
+
+enum {
+	DUMP_VECTORS = 'V',
+	DUMP_SOUND   = 'S'
+};
+
+typedef struct dump_record_type {
+	int kind;
+	unsigned long frame;
+	unsigned long count;
+
+	/* count entries of one of these, depending on kind */
+	vector_t *vectors;
+	int16_t *samples;
+
+	unsigned long size; /* entries allocated for each */
+} dump_record_t;
+
+int dump_write_header(FILE *f, unsigned rate);
+int dump_write_vectors(FILE *f, unsigned long frame, const vector_t *vectors,
+		long count);
+
+/* write length stereo frames as produced by e8910_callback */
+int dump_write_sound(FILE *f, unsigned long frame, const int16_t *stream,
+		int length);
+
+/* returns 1 on success, 0 if f is not a dump of a supported version */
+int dump_read_header(FILE *f, unsigned *rate);
+
+/* read the next record into rec, reusing its buffers. returns 1 for a
+ * record, 0 at the end of the dump and -1 if it is truncated or corrupt.
+ */
+int dump_read(FILE *f, dump_record_t *rec);
+void dump_free(dump_record_t *rec);
+
+#endif
@@ -0,0 +1,234 @@
+/* compares two dumps written by vecx_batch -d, e.g. one from a reference
+ * build and one from a build under test.
+ *
+ * usage: vecx_dumpcmp [-s tolerance] [-m max] a.vxd b.vxd
+ *
+ * the vector lists must match exactly. sound frames may differ by up to
+ * tolerance per sample, which allows for changes to the filtering. every
+ * difference is reported up to max of them, followed by a summary. the
+ * exit status is 0 if the dumps match, 1 if they differ and 2 if one of
+ * them cannot be read.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "dump.h"
+
+static long reports;
+static long max_reports = 20;
+
+static void report(const char *kind, const dump_record_t *a,
+      const char *fmt, long i, long x, long y)
+{
+   if (reports++ >= max_reports)
+      return;
+
+   printf("frame %lu: %s ", a->frame, kind);
+   printf(fmt, i, x, y);
+   putchar('\n');
+}
+
+static void report_count(const char *kind, const dump_record_t *a,
+      const dump_record_t *b)
+{
+   if (reports++ >= max_reports)
+      return;
+
+   printf("frame %lu: %s count %lu vs %lu\n", a->frame, kind, a->count,
+         b->count);
+}
+
+static long compare_vectors(const dump_record_t *a, const dump_record_t *b)
+{
+   unsigned long i, n = a->count < b->count ? a->count : b->count;
+   long diffs = 0;
+
+   if (a->count != b->count)
+   {
+      report_count("vectors", a, b);
+      diffs++;
+   }
+
+   /* only the first differing vector, later ones usually follow from it */
+   for (i = 0; i < n; i++)
+   {
+      const vector_t *va = &a->vectors[i];
+      const vector_t *vb = &b->vectors[i];
+
+      if (va->x0 != vb->x0 || va->y0 != vb->y0 || va->x1 != vb->x1 ||
+            va->y1 != vb->y1 || va->color != vb->color)
+      {
+         if (reports++ < max_reports)
+            printf("frame %lu: vector %lu: %u,%u-%u,%u c%u vs "
+                  "%u,%u-%u,%u c%u\n", a->frame, i,
+                  va->x0, va->y0, va->x1, va->y1, va->color,
+                  vb->x0, vb->y0, vb->x1, vb->y1, vb->color);
+         return diffs + 1;
+      }
+   }
+
+   return diffs;
+}
+
+static long compare_sound(const dump_record_t *a, const dump_record_t *b,
+      long tolerance)
+{
+   unsigned long i, worst = 0;
+   long max = 0;
+
+   if (a->count != b->count)
+   {
+      report_count("sound", a, b);
+      return 1;
+   }
+
+   for (i = 0; i < a->count; i++)
+   {
+      long d = labs((long) a->samples[i] - b->samples[i]);
+
+      if (d > max)
+      {
+         max   = d;
+         worst = i;
+      }
+   }
+
+   if (max <= tolerance)
+      return 0;
+
+   report("sound", a, "sample %ld: %ld vs %ld", (long) worst,
+         a->samples[worst], b->samples[worst]);
+
+   return 1;
+}
+
+static FILE *open_dump(const char *path, unsigned *rate)
+{
+   FILE *f = fopen(path, "rb");
+
+   if (!f)
+      fprintf(stderr, "%s: cannot open\n", path);
+   else if (!dump_read_header(f, rate))
+   {
+      fprintf(stderr, "%s: not a dump of version %d\n", path, DUMP_VERSION);
+      fclose(f);
+      f = NULL;
+   }
+
+   return f;
+}
+
+static void usage(void)
+{
+   fprintf(stderr, "usage: vecx_dumpcmp [-s tolerance] [-m max] "
+         "a.vxd b.vxd\n");
+   exit(2);
+}
+
+int main(int argc, char **argv)
+{
+   dump_record_t a, b;
+   unsigned rate_a, rate_b;
+   long tolerance = 0;
+   long records = 0, vector_diffs = 0, sound_diffs = 0;
+   int status = 0;
+   FILE *fa, *fb;
+   int opt;
+
+   while ((opt = getopt(argc, argv, "s:m:")) != -1)
+   {
+      switch (opt)
+      {
+         case 's':
+            tolerance = atol(optarg);
+            break;
+         case 'm':
+            max_reports = atol(optarg);
+            break;
+         default:
+            usage();
+      }
+   }
+
+   if (argc - optind != 2)
+      usage();
+
+   if (!(fa = open_dump(argv[optind], &rate_a)))
+      return 2;
+
+   if (!(fb = open_dump(argv[optind + 1], &rate_b)))
+   {
+      fclose(fa);
+      return 2;
+   }
+
+   if (rate_a != rate_b)
+   {
+      printf("sample rate %u vs %u\n", rate_a, rate_b);
+      status = 1;
+   }
+
+   memset(&a, 0, sizeof(a));
+   memset(&b, 0, sizeof(b));
+
+   for (;;)
+   {
+      int ra = dump_read(fa, &a);
+      int rb = dump_read(fb, &b);
+
+      if (ra < 0 || rb < 0)
+      {
+         fprintf(stderr, "%s: truncated or corrupt\n",
+               argv[ra < 0 ? optind : optind + 1]);
+         status = 2;
+         break;
+      }
+
+      if (ra == 0 || rb == 0)
+      {
+         /* one run went on for longer than the other */
+         if (ra != rb)
+         {
+            printf("%s ends after %ld records\n",
+                  argv[ra == 0 ? optind : optind + 1], records);
+            status = 1;
+         }
+         break;
+      }
+
+      records++;
+
+      /* once the records are out of step nothing after them means much */
+      if (a.kind != b.kind || a.frame != b.frame)
+      {
+         printf("record %ld: %c frame %lu vs %c frame %lu\n", records,
+               a.kind, a.frame, b.kind, b.frame);
+         status = 1;
+         break;
+      }
+
+      if (a.kind == DUMP_VECTORS)
+         vector_diffs += compare_vectors(&a, &b) ? 1 : 0;
+      else
+         sound_diffs += compare_sound(&a, &b, tolerance);
+   }
+
+   if (reports > max_reports)
+      printf("... %ld more\n", reports - max_reports);
+
+   printf("%ld records, %ld vector lists and %ld sound frames differ\n",
+         records, vector_diffs, sound_diffs);
+
+   if (status == 0 && (vector_diffs || sound_diffs))
+      status = 1;
+
+   dump_free(&a);
+   dump_free(&b);
+   fclose(fa);
+   fclose(fb);
+
+   return status;
+}
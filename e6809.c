@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include "e6809.h"
 
@@ -27,97 +28,127 @@ enum {
 	IRQ_CWAI	= 2
 };
 
-/* index registers */
-
-static unsigned reg_x;
-static unsigned reg_y;
-
-/* user stack pointer */
-
-static unsigned reg_u;
-
-/* hardware stack pointer */
-
-static unsigned reg_s;
-
-/* program counter */
-
-static unsigned reg_pc;
+/* instruction dispatch. compilers that support computed gotos (gcc, clang)
+ * jump straight to each opcode handler through a label table, which gives
+ * every handler its own indirect branch to predict. everything else, or a
+ * build with E6809_SWITCH defined, uses a plain switch statement.
+ */
 
-/* accumulators */
+#if defined(__GNUC__) && !defined(E6809_SWITCH)
+#define E6809_THREADED
+#endif
+
+#ifdef E6809_THREADED
+#define DISPATCH(table, op) goto *table[op];
+#define OP(n)               op_##n:
+#define OP10(n)             op10_##n:
+#define OP11(n)             op11_##n:
+#define OP_NONE             op_none:
+#define OP10_NONE           op10_none:
+#define OP11_NONE           op11_none:
+#define NEXT                goto next
+#else
+#define DISPATCH(table, op) switch (op)
+#define OP(n)               case 0x##n:
+#define OP10(n)             case 0x##n:
+#define OP11(n)             case 0x##n:
+#define OP_NONE             default:
+#define OP10_NONE           default:
+#define OP11_NONE           default:
+#define NEXT                break
+#endif
+
+/* the registers selected by bits 5 and 6 of an indexed post byte */
+
+static const size_t rptr_xyus[4] = {
+	offsetof (e6809_t, reg_x),
+	offsetof (e6809_t, reg_y),
+	offsetof (e6809_t, reg_u),
+	offsetof (e6809_t, reg_s)
+};
 
-static unsigned reg_a;
-static unsigned reg_b;
+/* obtain a particular condition code. returns 0 or 1. */
 
-/* direct page register */
+#define GET_CC(flag) \
+	((flag) == FLAG_N ? (cpu->cc_n >> 7) & 1 : \
+	 (flag) == FLAG_Z ? cpu->cc_z == 0 : \
+	 (flag) == FLAG_H ? (cpu->cc_h >> 4) & 1 : \
+	 (cpu->reg_cc / (flag)) & 1)
 
-static unsigned reg_dp;
+/* set a particular condition code to either 0 or 1.
+ * value parameter must be either 0 or 1.
+ */
 
-/* condition codes */
+static einline void set_cc (e6809_t *cpu, unsigned flag, unsigned value)
+{
+	if (flag == FLAG_N) {
+		cpu->cc_n = value << 7;
+	} else if (flag == FLAG_Z) {
+		cpu->cc_z = value ^ 1;
+	} else if (flag == FLAG_H) {
+		cpu->cc_h = value << 4;
+	} else {
+		cpu->reg_cc &= ~flag;
+		cpu->reg_cc |= value * flag;
+	}
+}
 
-static unsigned reg_cc;
+/* set n and z from an 8 or 16-bit result */
 
-/* flag to see if interrupts should be handled (sync/cwai). */
+static einline void set_nz8 (e6809_t *cpu, unsigned r)
+{
+	cpu->cc_n = r;
+	cpu->cc_z = r & 0xff;
+}
 
-static unsigned irq_status;
+static einline void set_nz16 (e6809_t *cpu, unsigned r)
+{
+	cpu->cc_n = r >> 8;
+	cpu->cc_z = r & 0xffff;
+}
 
-static unsigned *rptr_xyus[4] = {
-	&reg_x,
-	&reg_y,
-	&reg_u,
-	&reg_s
-};
+/* set h from the inputs and result of an 8-bit addition. the carry into
+ * bit 4 is the bit 4 sum of both inputs and the result.
+ */
 
-int e6809_statesz(void)
+static einline void set_h (e6809_t *cpu, unsigned i0, unsigned i1, unsigned r)
 {
-   return 10 * sizeof(unsigned);
+	cpu->cc_h = i0 ^ i1 ^ r;
 }
 
-void e6809_serialize ( char* dst)
+/* read or write the complete condition code register */
+
+static einline unsigned get_cc (e6809_t *cpu)
 {
-	memcpy(dst, &reg_x,  sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &reg_y,  sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &reg_u,  sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &reg_s,  sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &reg_pc, sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &reg_a,  sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &reg_b,  sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &reg_dp, sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &reg_cc, sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &irq_status, sizeof(int)); dst += sizeof(int);
+	return (cpu->reg_cc & ~(FLAG_H | FLAG_N | FLAG_Z)) |
+		(GET_CC (FLAG_H) * FLAG_H) |
+		(GET_CC (FLAG_N) * FLAG_N) |
+		(GET_CC (FLAG_Z) * FLAG_Z);
 }
 
-void e6809_deserialize ( char* dst)
+static einline void put_cc (e6809_t *cpu, unsigned value)
 {
-	memcpy(&reg_x,  dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&reg_y,  dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&reg_u,  dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&reg_s,  dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&reg_pc, dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&reg_a,  dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&reg_b,  dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&reg_dp, dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&reg_cc, dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&irq_status, dst, sizeof(int)); dst += sizeof(int);
+	cpu->reg_cc = value;
+	cpu->cc_n = (value & FLAG_N) << 4;
+	cpu->cc_z = ~value & FLAG_Z;
+	cpu->cc_h = (value & FLAG_H) >> 1;
 }
 
-/* user defined read and write functions */
-
-unsigned char (*e6809_read8) (unsigned address);
-void (*e6809_write8) (unsigned address, unsigned char data);
+/* the state is everything in front of user, see e6809.h */
 
-/* obtain a particular condition code. returns 0 or 1. */
-
-#define GET_CC(flag) ((reg_cc / (flag)) & 1)
+int e6809_statesz(void)
+{
+	return offsetof (e6809_t, user);
+}
 
-/* set a particular condition code to either 0 or 1.
- * value parameter must be either 0 or 1.
- */
+void e6809_serialize (e6809_t *cpu, char* dst)
+{
+	memcpy(dst, cpu, offsetof (e6809_t, user));
+}
 
-static einline void set_cc (unsigned flag, unsigned value)
+void e6809_deserialize (e6809_t *cpu, char* dst)
 {
-	reg_cc &= ~flag;
-	reg_cc |= value * flag;
+	memcpy(cpu, dst, offsetof (e6809_t, user));
 }
 
 /* test carry */
@@ -133,10 +164,6 @@ static einline unsigned test_c (unsigned i0, unsigned i1,
 	return flag;
 }
 
-/* test negative */
-
-#define TEST_N(r) (((r) >> 7) & 1)
-
 /* test for zero in lower 8 bits */
 
 static einline unsigned test_z8 (unsigned r)
@@ -179,95 +206,106 @@ static einline unsigned test_v (unsigned i0, unsigned i1, unsigned r)
 	return flag;
 }
 
-static einline unsigned get_reg_d (void)
+static einline unsigned get_reg_d (e6809_t *cpu)
 {
-	return (reg_a << 8) | (reg_b & 0xff);
+	return (cpu->reg_a << 8) | (cpu->reg_b & 0xff);
 }
 
-static einline void set_reg_d (unsigned value)
+static einline void set_reg_d (e6809_t *cpu, unsigned value)
 {
-	reg_a = value >> 8;
-	reg_b = value;
+	cpu->reg_a = value >> 8;
+	cpu->reg_b = value;
 }
 
 /* read a byte ... the returned value has the lower 8-bits set to the byte
  * while the upper bits are all zero.
  */
 
-static einline unsigned read8 (unsigned address)
+static einline unsigned read8 (e6809_t *cpu, unsigned address)
 {
-	return (*e6809_read8) (address & 0xffff);
+	return (*cpu->read8) (cpu->user, address & 0xffff);
 }
 
 /* write a byte ... only the lower 8-bits of the unsigned data
  * is written. the upper bits are ignored.
  */
 
-static einline void write8 (unsigned address, unsigned data)
+static einline void write8 (e6809_t *cpu, unsigned address, unsigned data)
 {
-	(*e6809_write8) (address & 0xffff, (unsigned char) data);
+	(*cpu->write8) (cpu->user, address & 0xffff, (unsigned char) data);
 }
 
-static einline unsigned read16 (unsigned address)
+static einline unsigned read16 (e6809_t *cpu, unsigned address)
 {
-	unsigned datahi = read8 (address);
-	unsigned datalo = read8 (address + 1);
+	unsigned datahi = read8 (cpu, address);
+	unsigned datalo = read8 (cpu, address + 1);
 
 	return (datahi << 8) | datalo;
 }
 
-static einline void write16 (unsigned address, unsigned data)
+static einline void write16 (e6809_t *cpu, unsigned address, unsigned data)
 {
-	write8 (address, data >> 8);
-	write8 (address + 1, data);
+	write8 (cpu, address, data >> 8);
+	write8 (cpu, address + 1, data);
 }
 
-static einline void push8 (unsigned *sp, unsigned data)
+static einline void push8 (e6809_t *cpu, unsigned *sp, unsigned data)
 {
 	(*sp)--;
-	write8 (*sp, data);
+	write8 (cpu, *sp, data);
 }
 
-static einline unsigned pull8 (unsigned *sp)
+static einline unsigned pull8 (e6809_t *cpu, unsigned *sp)
 {
-	unsigned	data = read8 (*sp);
+	unsigned	data = read8 (cpu, *sp);
 	(*sp)++;
 
 	return data;
 }
 
-static einline void push16 (unsigned *sp, unsigned data)
+static einline void push16 (e6809_t *cpu, unsigned *sp, unsigned data)
 {
-	push8 (sp, data);
-	push8 (sp, data >> 8);
+	push8 (cpu, sp, data);
+	push8 (cpu, sp, data >> 8);
 }
 
-static einline unsigned pull16 (unsigned *sp)
+static einline unsigned pull16 (e6809_t *cpu, unsigned *sp)
 {
-	unsigned datahi = pull8 (sp);
-	unsigned datalo = pull8 (sp);
+	unsigned datahi = pull8 (cpu, sp);
+	unsigned datalo = pull8 (cpu, sp);
 
 	return (datahi << 8) | datalo;
 }
 
-/* read a byte from the address pointed to by the pc */
+/* read a byte from the address pointed to by the pc. code almost always
+ * runs from rom or cartridge space, so the byte is read directly from the
+ * page in the code map when there is one.
+ */
 
-static einline unsigned pc_read8 (void)
+static einline unsigned pc_read8 (e6809_t *cpu)
 {
-	unsigned data = read8 (reg_pc);
-	reg_pc++;
+	const unsigned char *page;
+	unsigned data;
+
+	if (cpu->fetch_map &&
+			(page = cpu->fetch_map[(cpu->reg_pc >> 8) & 0xff]) != NULL)
+		data = page[cpu->reg_pc & 0xff];
+	else
+		data = read8 (cpu, cpu->reg_pc);
+
+	cpu->reg_pc++;
 
 	return data;
 }
 
 /* read a word from the address pointed to by the pc */
 
-static einline unsigned pc_read16 (void)
+static einline unsigned pc_read16 (e6809_t *cpu)
 {
-	unsigned data = read16 (reg_pc);
-	reg_pc += 2;
+	unsigned datahi = pc_read8 (cpu);
+	unsigned datalo = pc_read8 (cpu);
 
-	return data;
+	return (datahi << 8) | datalo;
 }
 
 /* sign extend an 8-bit quantity into a 16-bit quantity */
@@ -282,241 +320,124 @@ static einline unsigned sign_extend (unsigned data)
  * instruction itself.
  */
 
-static einline unsigned ea_direct (void)
+static einline unsigned ea_direct (e6809_t *cpu)
 {
-	return (reg_dp << 8) | pc_read8 ();
+	return (cpu->reg_dp << 8) | pc_read8 (cpu);
 }
 
 /* extended addressing, address is obtained from 2 bytes following
  * the instruction.
  */
 
-static einline unsigned ea_extended (void)
+static einline unsigned ea_extended (e6809_t *cpu)
 {
-	return pc_read16 ();
+	return pc_read16 (cpu);
 }
 
-/* indexed addressing */
+/* indexed addressing.
+ * apart from the 5-bit offset forms, the low five bits of the post byte
+ * select the addressing mode (bit 4 being indirection) and bits 5 and 6
+ * select the register. the extra cycles taken by each mode are decoded
+ * ahead of time in the table below. a 0 entry with no matching mode is an
+ * illegal post byte.
+ */
+
+static const unsigned char ea_indexed_cycles[32] = {
+	2, 3, 2, 3, 0, 1, 1, 0, 1, 4, 0, 4, 1, 5, 0, 0,
+	5, 6, 5, 6, 3, 4, 4, 0, 4, 7, 0, 7, 4, 8, 0, 5
+};
 
-static einline unsigned ea_indexed (unsigned *cycles)
+static einline unsigned ea_indexed (e6809_t *cpu, unsigned *cycles)
 {
-	unsigned r, op, ea;
+	unsigned *rptr, op, ea;
 
 	/* post byte */
 
-	op = pc_read8 ();
-
-	r = (op >> 5) & 3;
-
-	switch (op) {
-	case 0x00: case 0x01: case 0x02: case 0x03:
-	case 0x04: case 0x05: case 0x06: case 0x07:
-	case 0x08: case 0x09: case 0x0a: case 0x0b:
-	case 0x0c: case 0x0d: case 0x0e: case 0x0f:
-	case 0x20: case 0x21: case 0x22: case 0x23:
-	case 0x24: case 0x25: case 0x26: case 0x27:
-	case 0x28: case 0x29: case 0x2a: case 0x2b:
-	case 0x2c: case 0x2d: case 0x2e: case 0x2f:
-	case 0x40: case 0x41: case 0x42: case 0x43:
-	case 0x44: case 0x45: case 0x46: case 0x47:
-	case 0x48: case 0x49: case 0x4a: case 0x4b:
-	case 0x4c: case 0x4d: case 0x4e: case 0x4f:
-	case 0x60: case 0x61: case 0x62: case 0x63:
-	case 0x64: case 0x65: case 0x66: case 0x67:
-	case 0x68: case 0x69: case 0x6a: case 0x6b:
-	case 0x6c: case 0x6d: case 0x6e: case 0x6f:
-		/* R, +[0, 15] */
-
-		ea = *rptr_xyus[r] + (op & 0xf);
-		(*cycles)++;
-		break;
-	case 0x10: case 0x11: case 0x12: case 0x13:
-	case 0x14: case 0x15: case 0x16: case 0x17:
-	case 0x18: case 0x19: case 0x1a: case 0x1b:
-	case 0x1c: case 0x1d: case 0x1e: case 0x1f:
-	case 0x30: case 0x31: case 0x32: case 0x33:
-	case 0x34: case 0x35: case 0x36: case 0x37:
-	case 0x38: case 0x39: case 0x3a: case 0x3b:
-	case 0x3c: case 0x3d: case 0x3e: case 0x3f:
-	case 0x50: case 0x51: case 0x52: case 0x53:
-	case 0x54: case 0x55: case 0x56: case 0x57:
-	case 0x58: case 0x59: case 0x5a: case 0x5b:
-	case 0x5c: case 0x5d: case 0x5e: case 0x5f:
-	case 0x70: case 0x71: case 0x72: case 0x73:
-	case 0x74: case 0x75: case 0x76: case 0x77:
-	case 0x78: case 0x79: case 0x7a: case 0x7b:
-	case 0x7c: case 0x7d: case 0x7e: case 0x7f:
-		/* R, +[-16, -1] */
-
-		ea = *rptr_xyus[r] + (op & 0xf) - 0x10;
+	op = pc_read8 (cpu);
+
+	rptr = (unsigned *) ((char *) cpu + rptr_xyus[(op >> 5) & 3]);
+
+	if ((op & 0x80) == 0) {
+		/* R, +[-16, 15] */
+
 		(*cycles)++;
-		break;
-	case 0x80: case 0x81:
-	case 0xa0: case 0xa1:
-	case 0xc0: case 0xc1:
-	case 0xe0: case 0xe1:
+		return *rptr + (op & 0xf) - (op & 0x10);
+	}
+
+	switch (op & 0xf) {
+	case 0x0: case 0x1:
 		/* ,R+ / ,R++ */
 
-		ea = *rptr_xyus[r];
-		*rptr_xyus[r] += 1 + (op & 1);
-		*cycles += 2 + (op & 1);
+		ea = *rptr;
+		*rptr += 1 + (op & 1);
 		break;
-	case 0x90: case 0x91:
-	case 0xb0: case 0xb1:
-	case 0xd0: case 0xd1:
-	case 0xf0: case 0xf1:
-		/* [,R+] ??? / [,R++] */
-
-		ea = read16 (*rptr_xyus[r]);
-		*rptr_xyus[r] += 1 + (op & 1);
-		*cycles += 5 + (op & 1);
-		break;
-	case 0x82: case 0x83:
-	case 0xa2: case 0xa3:
-	case 0xc2: case 0xc3:
-	case 0xe2: case 0xe3:
-
+	case 0x2: case 0x3:
 		/* ,-R / ,--R */
 
-		*rptr_xyus[r] -= 1 + (op & 1);
-		ea = *rptr_xyus[r];
-		*cycles += 2 + (op & 1);
+		*rptr -= 1 + (op & 1);
+		ea = *rptr;
 		break;
-	case 0x92: case 0x93:
-	case 0xb2: case 0xb3:
-	case 0xd2: case 0xd3:
-	case 0xf2: case 0xf3:
-		/* [,-R] ??? / [,--R] */
-
-		*rptr_xyus[r] -= 1 + (op & 1);
-		ea = read16 (*rptr_xyus[r]);
-		*cycles += 5 + (op & 1);
-		break;
-	case 0x84: case 0xa4:
-	case 0xc4: case 0xe4:
+	case 0x4:
 		/* ,R */
 
-		ea = *rptr_xyus[r];
-		break;
-	case 0x94: case 0xb4:
-	case 0xd4: case 0xf4:
-		/* [,R] */
-
-		ea = read16 (*rptr_xyus[r]);
-		*cycles += 3;
+		ea = *rptr;
 		break;
-	case 0x85: case 0xa5:
-	case 0xc5: case 0xe5:
+	case 0x5:
 		/* B,R */
 
-		ea = *rptr_xyus[r] + sign_extend (reg_b);
-		*cycles += 1;
+		ea = *rptr + sign_extend (cpu->reg_b);
 		break;
-	case 0x95: case 0xb5:
-	case 0xd5: case 0xf5:
-		/* [B,R] */
-
-		ea = read16 (*rptr_xyus[r] + sign_extend (reg_b));
-		*cycles += 4;
-		break;
-	case 0x86: case 0xa6:
-	case 0xc6: case 0xe6:
+	case 0x6:
 		/* A,R */
 
-		ea = *rptr_xyus[r] + sign_extend (reg_a);
-		*cycles += 1;
+		ea = *rptr + sign_extend (cpu->reg_a);
 		break;
-	case 0x96: case 0xb6:
-	case 0xd6: case 0xf6:
-		/* [A,R] */
-
-		ea = read16 (*rptr_xyus[r] + sign_extend (reg_a));
-		*cycles += 4;
-		break;
-	case 0x88: case 0xa8:
-	case 0xc8: case 0xe8:
+	case 0x8:
 		/* byte,R */
 
-		ea = *rptr_xyus[r] + sign_extend (pc_read8 ());
-		*cycles += 1;
-		break;
-	case 0x98: case 0xb8:
-	case 0xd8: case 0xf8:
-		/* [byte,R] */
-
-		ea = read16 (*rptr_xyus[r] + sign_extend (pc_read8 ()));
-		*cycles += 4;
+		ea = *rptr + sign_extend (pc_read8 (cpu));
 		break;
-	case 0x89: case 0xa9:
-	case 0xc9: case 0xe9:
+	case 0x9:
 		/* word,R */
 
-		ea = *rptr_xyus[r] + pc_read16 ();
-		*cycles += 4;
+		ea = *rptr + pc_read16 (cpu);
 		break;
-	case 0x99: case 0xb9:
-	case 0xd9: case 0xf9:
-		/* [word,R] */
-
-		ea = read16 (*rptr_xyus[r] + pc_read16 ());
-		*cycles += 7;
-		break;
-	case 0x8b: case 0xab:
-	case 0xcb: case 0xeb:
+	case 0xb:
 		/* D,R */
 
-		ea = *rptr_xyus[r] + get_reg_d ();
-		*cycles += 4;
+		ea = *rptr + get_reg_d (cpu);
 		break;
-	case 0x9b: case 0xbb:
-	case 0xdb: case 0xfb:
-		/* [D,R] */
-
-		ea = read16 (*rptr_xyus[r] + get_reg_d ());
-		*cycles += 7;
-		break;
-	case 0x8c: case 0xac:
-	case 0xcc: case 0xec:
+	case 0xc:
 		/* byte, PC */
 
-		r = sign_extend (pc_read8 ());
-		ea = reg_pc + r;
-		*cycles += 1;
+		ea = sign_extend (pc_read8 (cpu));
+		ea += cpu->reg_pc;
 		break;
-	case 0x9c: case 0xbc:
-	case 0xdc: case 0xfc:
-		/* [byte, PC] */
-
-		r = sign_extend (pc_read8 ());
-		ea = read16 (reg_pc + r);
-		*cycles += 4;
-		break;
-	case 0x8d: case 0xad:
-	case 0xcd: case 0xed:
+	case 0xd:
 		/* word, PC */
 
-		r = pc_read16 ();
-		ea = reg_pc + r;
-		*cycles += 5;
+		ea = pc_read16 (cpu);
+		ea += cpu->reg_pc;
 		break;
-	case 0x9d: case 0xbd:
-	case 0xdd: case 0xfd:
-		/* [word, PC] */
-
-		r = pc_read16 ();
-		ea = read16 (reg_pc + r);
-		*cycles += 8;
-		break;
-	case 0x9f:
+	case 0xf:
 		/* [address] */
 
-		ea = read16 (pc_read16 ());
-		*cycles += 5;
+		if (op != 0x9f)
+			return 0;
+
+		ea = pc_read16 (cpu);
 		break;
 	default:
-		break;
+		return 0;
 	}
 
+	/* [...] */
+
+	if (op & 0x10)
+		ea = read16 (cpu, ea);
+
+	*cycles += ea_indexed_cycles[op & 0x1f];
+
 	return ea;
 }
 
@@ -524,31 +445,29 @@ static einline unsigned ea_indexed (unsigned *cycles)
  * essentially (0 - data).
  */
 
-static einline unsigned inst_neg (unsigned data)
+static einline unsigned inst_neg (e6809_t *cpu, unsigned data)
 {
 	unsigned i0 = 0;
 	unsigned i1 = ~data;
 	unsigned r = i0 + i1 + 1;
 
-	set_cc (FLAG_H, test_c (i0 << 4, i1 << 4, r << 4, 0));
-	set_cc (FLAG_N, TEST_N (r));
-	set_cc (FLAG_Z, test_z8 (r));
-	set_cc (FLAG_V, test_v (i0, i1, r));
-	set_cc (FLAG_C, test_c (i0, i1, r, 1));
+	set_h (cpu, i0, i1, r);
+	set_nz8 (cpu, r);
+	set_cc (cpu, FLAG_V, test_v (i0, i1, r));
+	set_cc (cpu, FLAG_C, test_c (i0, i1, r, 1));
 
 	return r;
 }
 
 /* instruction: com */
 
-static einline unsigned inst_com (unsigned data)
+static einline unsigned inst_com (e6809_t *cpu, unsigned data)
 {
 	unsigned r = ~data;
 
-	set_cc (FLAG_N, TEST_N (r));
-	set_cc (FLAG_Z, test_z8 (r));
-	set_cc (FLAG_V, 0);
-	set_cc (FLAG_C, 1);
+	set_nz8 (cpu, r);
+	set_cc (cpu, FLAG_V, 0);
+	set_cc (cpu, FLAG_C, 1);
 
 	return r;
 }
@@ -557,13 +476,13 @@ static einline unsigned inst_com (unsigned data)
  * cannot be faked as an add or substract.
  */
 
-static einline unsigned inst_lsr (unsigned data)
+static einline unsigned inst_lsr (e6809_t *cpu, unsigned data)
 {
 	unsigned r = (data >> 1) & 0x7f;
 
-	set_cc (FLAG_N, 0);
-	set_cc (FLAG_Z, test_z8 (r));
-	set_cc (FLAG_C, data & 1);
+	set_cc (cpu, FLAG_N, 0);
+	set_cc (cpu, FLAG_Z, test_z8 (r));
+	set_cc (cpu, FLAG_C, data & 1);
 
 	return r;
 }
@@ -572,14 +491,13 @@ static einline unsigned inst_lsr (unsigned data)
  * cannot be faked as an add or substract.
  */
 
-static einline unsigned inst_ror (unsigned data)
+static einline unsigned inst_ror (e6809_t *cpu, unsigned data)
 {
 	unsigned c = GET_CC(FLAG_C);
 	unsigned r = ((data >> 1) & 0x7f) | (c << 7);
 
-	set_cc (FLAG_N, TEST_N (r));
-	set_cc (FLAG_Z, test_z8 (r));
-	set_cc (FLAG_C, data & 1);
+	set_nz8 (cpu, r);
+	set_cc (cpu, FLAG_C, data & 1);
 
 	return r;
 }
@@ -588,13 +506,12 @@ static einline unsigned inst_ror (unsigned data)
  * cannot be faked as an add or substract.
  */
 
-static einline unsigned inst_asr (unsigned data)
+static einline unsigned inst_asr (e6809_t *cpu, unsigned data)
 {
 	unsigned r = ((data >> 1) & 0x7f) | (data & 0x80);
 
-	set_cc (FLAG_N, TEST_N (r));
-	set_cc (FLAG_Z, test_z8 (r));
-	set_cc (FLAG_C, data & 1);
+	set_nz8 (cpu, r);
+	set_cc (cpu, FLAG_C, data & 1);
 
 	return r;
 }
@@ -603,17 +520,16 @@ static einline unsigned inst_asr (unsigned data)
  * essentially (data + data). simple addition.
  */
 
-static einline unsigned inst_asl (unsigned data)
+static einline unsigned inst_asl (e6809_t *cpu, unsigned data)
 {
 	unsigned i0 = data;
 	unsigned i1 = data;
 	unsigned r = i0 + i1;
 
-	set_cc (FLAG_H, test_c (i0 << 4, i1 << 4, r << 4, 0));
-	set_cc (FLAG_N, TEST_N (r));
-	set_cc (FLAG_Z, test_z8 (r));
-	set_cc (FLAG_V, test_v (i0, i1, r));
-	set_cc (FLAG_C, test_c (i0, i1, r, 0));
+	set_h (cpu, i0, i1, r);
+	set_nz8 (cpu, r);
+	set_cc (cpu, FLAG_V, test_v (i0, i1, r));
+	set_cc (cpu, FLAG_C, test_c (i0, i1, r, 0));
 
 	return r;
 }
@@ -622,17 +538,16 @@ static einline unsigned inst_asl (unsigned data)
  * essentially (data + data + carry). addition with carry.
  */
 
-static einline unsigned inst_rol (unsigned data)
+static einline unsigned inst_rol (e6809_t *cpu, unsigned data)
 {
 	unsigned i0 = data;
 	unsigned i1 = data;
 	unsigned c = GET_CC(FLAG_C);
 	unsigned r = i0 + i1 + c;
 
-	set_cc (FLAG_N, TEST_N (r));
-	set_cc (FLAG_Z, test_z8 (r));
-	set_cc (FLAG_V, test_v (i0, i1, r));
-	set_cc (FLAG_C, test_c (i0, i1, r, 0));
+	set_nz8 (cpu, r);
+	set_cc (cpu, FLAG_V, test_v (i0, i1, r));
+	set_cc (cpu, FLAG_C, test_c (i0, i1, r, 0));
 
 	return r;
 }
@@ -641,15 +556,14 @@ static einline unsigned inst_rol (unsigned data)
  * essentially (data - 1).
  */
 
-static einline unsigned inst_dec (unsigned data)
+static einline unsigned inst_dec (e6809_t *cpu, unsigned data)
 {
 	unsigned i0 = data;
 	unsigned i1 = 0xff;
 	unsigned r = i0 + i1;
 
-	set_cc (FLAG_N, TEST_N (r));
-	set_cc (FLAG_Z, test_z8 (r));
-	set_cc (FLAG_V, test_v (i0, i1, r));
+	set_nz8 (cpu, r);
+	set_cc (cpu, FLAG_V, test_v (i0, i1, r));
 
 	return r;
 }
@@ -658,58 +572,54 @@ static einline unsigned inst_dec (unsigned data)
  * essentially (data + 1).
  */
 
-static einline unsigned inst_inc (unsigned data)
+static einline unsigned inst_inc (e6809_t *cpu, unsigned data)
 {
 	unsigned i0 = data;
 	unsigned i1 = 1;
 	unsigned r = i0 + i1;
 
-	set_cc (FLAG_N, TEST_N (r));
-	set_cc (FLAG_Z, test_z8 (r));
-	set_cc (FLAG_V, test_v (i0, i1, r));
+	set_nz8 (cpu, r);
+	set_cc (cpu, FLAG_V, test_v (i0, i1, r));
 
 	return r;
 }
 
 /* instruction: tst */
 
-static einline void inst_tst8 (unsigned data)
+static einline void inst_tst8 (e6809_t *cpu, unsigned data)
 {
-	set_cc (FLAG_N, TEST_N (data));
-	set_cc (FLAG_Z, test_z8 (data));
-	set_cc (FLAG_V, 0);
+	set_nz8 (cpu, data);
+	set_cc (cpu, FLAG_V, 0);
 }
 
-static einline void inst_tst16 (unsigned data)
+static einline void inst_tst16 (e6809_t *cpu, unsigned data)
 {
-	set_cc (FLAG_N, TEST_N (data >> 8));
-	set_cc (FLAG_Z, test_z16 (data));
-	set_cc (FLAG_V, 0);
+	set_nz16 (cpu, data);
+	set_cc (cpu, FLAG_V, 0);
 }
 
 /* instruction: clr */
 
-static einline void inst_clr (void)
+static einline void inst_clr (e6809_t *cpu)
 {
-	set_cc (FLAG_N, 0);
-	set_cc (FLAG_Z, 1);
-	set_cc (FLAG_V, 0);
-	set_cc (FLAG_C, 0);
+	set_cc (cpu, FLAG_N, 0);
+	set_cc (cpu, FLAG_Z, 1);
+	set_cc (cpu, FLAG_V, 0);
+	set_cc (cpu, FLAG_C, 0);
 }
 
 /* instruction: suba/subb */
 
-static einline unsigned inst_sub8 (unsigned data0, unsigned data1)
+static einline unsigned inst_sub8 (e6809_t *cpu, unsigned data0, unsigned data1)
 {
 	unsigned i0 = data0;
 	unsigned i1 = ~data1;
 	unsigned r = i0 + i1 + 1;
 
-	set_cc (FLAG_H, test_c (i0 << 4, i1 << 4, r << 4, 0));
-	set_cc (FLAG_N, TEST_N (r));
-	set_cc (FLAG_Z, test_z8 (r));
-	set_cc (FLAG_V, test_v (i0, i1, r));
-	set_cc (FLAG_C, test_c (i0, i1, r, 1));
+	set_h (cpu, i0, i1, r);
+	set_nz8 (cpu, r);
+	set_cc (cpu, FLAG_V, test_v (i0, i1, r));
+	set_cc (cpu, FLAG_C, test_c (i0, i1, r, 1));
 
 	return r;
 }
@@ -718,18 +628,17 @@ static einline unsigned inst_sub8 (unsigned data0, unsigned data1)
  * only 8-bit version, 16-bit version not needed.
  */
 
-static einline unsigned inst_sbc (unsigned data0, unsigned data1)
+static einline unsigned inst_sbc (e6809_t *cpu, unsigned data0, unsigned data1)
 {
 	unsigned i0 = data0;
 	unsigned i1 = ~data1;
 	unsigned c = 1 - GET_CC(FLAG_C);
 	unsigned r = i0 + i1 + c;
 
-	set_cc (FLAG_H, test_c (i0 << 4, i1 << 4, r << 4, 0));
-	set_cc (FLAG_N, TEST_N (r));
-	set_cc (FLAG_Z, test_z8 (r));
-	set_cc (FLAG_V, test_v (i0, i1, r));
-	set_cc (FLAG_C, test_c (i0, i1, r, 1));
+	set_h (cpu, i0, i1, r);
+	set_nz8 (cpu, r);
+	set_cc (cpu, FLAG_V, test_v (i0, i1, r));
+	set_cc (cpu, FLAG_C, test_c (i0, i1, r, 1));
 
 	return r;
 }
@@ -738,11 +647,11 @@ static einline unsigned inst_sbc (unsigned data0, unsigned data1)
  * only 8-bit version, 16-bit version not needed.
  */
 
-static einline unsigned inst_and (unsigned data0, unsigned data1)
+static einline unsigned inst_and (e6809_t *cpu, unsigned data0, unsigned data1)
 {
 	unsigned r = data0 & data1;
 
-	inst_tst8 (r);
+	inst_tst8 (cpu, r);
 
 	return r;
 }
@@ -751,11 +660,11 @@ static einline unsigned inst_and (unsigned data0, unsigned data1)
  * only 8-bit version, 16-bit version not needed.
  */
 
-static einline unsigned inst_eor (unsigned data0, unsigned data1)
+static einline unsigned inst_eor (e6809_t *cpu, unsigned data0, unsigned data1)
 {
 	unsigned r = data0 ^ data1;
 
-	inst_tst8 (r);
+	inst_tst8 (cpu, r);
 
 	return r;
 }
@@ -764,18 +673,17 @@ static einline unsigned inst_eor (unsigned data0, unsigned data1)
  * only 8-bit version, 16-bit version not needed.
  */
 
-static einline unsigned inst_adc (unsigned data0, unsigned data1)
+static einline unsigned inst_adc (e6809_t *cpu, unsigned data0, unsigned data1)
 {
 	unsigned i0 = data0;
 	unsigned i1 = data1;
 	unsigned c = GET_CC(FLAG_C);
 	unsigned r = i0 + i1 + c;
 
-	set_cc (FLAG_H, test_c (i0 << 4, i1 << 4, r << 4, 0));
-	set_cc (FLAG_N, TEST_N (r));
-	set_cc (FLAG_Z, test_z8 (r));
-	set_cc (FLAG_V, test_v (i0, i1, r));
-	set_cc (FLAG_C, test_c (i0, i1, r, 0));
+	set_h (cpu, i0, i1, r);
+	set_nz8 (cpu, r);
+	set_cc (cpu, FLAG_V, test_v (i0, i1, r));
+	set_cc (cpu, FLAG_C, test_c (i0, i1, r, 0));
 
 	return r;
 }
@@ -784,221 +692,220 @@ static einline unsigned inst_adc (unsigned data0, unsigned data1)
  * only 8-bit version, 16-bit version not needed.
  */
 
-static einline unsigned inst_or (unsigned data0, unsigned data1)
+static einline unsigned inst_or (e6809_t *cpu, unsigned data0, unsigned data1)
 {
 	unsigned r = data0 | data1;
 
-	inst_tst8 (r);
+	inst_tst8 (cpu, r);
 
 	return r;
 }
 
 /* instruction: adda/addb */
 
-static einline unsigned inst_add8 (unsigned data0, unsigned data1)
+static einline unsigned inst_add8 (e6809_t *cpu, unsigned data0, unsigned data1)
 {
 	unsigned i0 = data0;
 	unsigned i1 = data1;
 	unsigned r = i0 + i1;
 
-	set_cc (FLAG_H, test_c (i0 << 4, i1 << 4, r << 4, 0));
-	set_cc (FLAG_N, TEST_N (r));
-	set_cc (FLAG_Z, test_z8 (r));
-	set_cc (FLAG_V, test_v (i0, i1, r));
-	set_cc (FLAG_C, test_c (i0, i1, r, 0));
+	set_h (cpu, i0, i1, r);
+	set_nz8 (cpu, r);
+	set_cc (cpu, FLAG_V, test_v (i0, i1, r));
+	set_cc (cpu, FLAG_C, test_c (i0, i1, r, 0));
 
 	return r;
 }
 
 /* instruction: addd */
 
-static einline unsigned inst_add16 (unsigned data0, unsigned data1)
+static einline unsigned inst_add16 (e6809_t *cpu, unsigned data0, unsigned data1)
 {
 	unsigned i0 = data0;
 	unsigned i1 = data1;
 	unsigned r = i0 + i1;
 
-	set_cc (FLAG_N, TEST_N (r >> 8));
-	set_cc (FLAG_Z, test_z16 (r));
-	set_cc (FLAG_V, test_v (i0 >> 8, i1 >> 8, r >> 8));
-	set_cc (FLAG_C, test_c (i0 >> 8, i1 >> 8, r >> 8, 0));
+	set_nz16 (cpu, r);
+	set_cc (cpu, FLAG_V, test_v (i0 >> 8, i1 >> 8, r >> 8));
+	set_cc (cpu, FLAG_C, test_c (i0 >> 8, i1 >> 8, r >> 8, 0));
 
 	return r;
 }
 
 /* instruction: subd */
 
-static einline unsigned inst_sub16 (unsigned data0, unsigned data1)
+static einline unsigned inst_sub16 (e6809_t *cpu, unsigned data0, unsigned data1)
 {
 	unsigned i0 = data0;
 	unsigned i1 = ~data1;
 	unsigned r = i0 + i1 + 1;
 
-	set_cc (FLAG_N, TEST_N (r >> 8));
-	set_cc (FLAG_Z, test_z16 (r));
-	set_cc (FLAG_V, test_v (i0 >> 8, i1 >> 8, r >> 8));
-	set_cc (FLAG_C, test_c (i0 >> 8, i1 >> 8, r >> 8, 1));
+	set_nz16 (cpu, r);
+	set_cc (cpu, FLAG_V, test_v (i0 >> 8, i1 >> 8, r >> 8));
+	set_cc (cpu, FLAG_C, test_c (i0 >> 8, i1 >> 8, r >> 8, 1));
 
 	return r;
 }
 
 /* instruction: 8-bit offset branch */
 
-static einline void inst_bra8 (unsigned test, unsigned op, unsigned *cycles)
+static einline void inst_bra8 (e6809_t *cpu, unsigned test, unsigned op,
+								unsigned *cycles)
 {
-	unsigned offset = pc_read8 ();
+	unsigned offset = pc_read8 (cpu);
 
 	/* trying to avoid an if statement */
 
 	unsigned mask = (test ^ (op & 1)) - 1; /* 0xffff when taken, 0 when not taken */
-	reg_pc += sign_extend (offset) & mask;
+	cpu->reg_pc += sign_extend (offset) & mask;
 
 	*cycles += 3;
 }
 
 /* instruction: 16-bit offset branch */
 
-static einline void inst_bra16 (unsigned test, unsigned op, unsigned *cycles)
+static einline void inst_bra16 (e6809_t *cpu, unsigned test, unsigned op,
+								unsigned *cycles)
 {
-	unsigned offset = pc_read16 ();
+	unsigned offset = pc_read16 (cpu);
 
 	/* trying to avoid an if statement */
 
 	unsigned mask = (test ^ (op & 1)) - 1; /* 0xffff when taken, 0 when not taken */
-	reg_pc += offset & mask;
+	cpu->reg_pc += offset & mask;
 
 	*cycles += 5 - mask;
 }
 
 /* instruction: pshs/pshu */
 
-static einline void inst_psh (unsigned op, unsigned *sp,
+static einline void inst_psh (e6809_t *cpu, unsigned op, unsigned *sp,
 					   unsigned data, unsigned *cycles)
 {
 	if (op & 0x80) {
-		push16 (sp, reg_pc);
+		push16 (cpu, sp, cpu->reg_pc);
 		*cycles += 2;
 	}
 
 	if (op & 0x40) {
 		/* either s or u */
-		push16 (sp, data);
+		push16 (cpu, sp, data);
 		*cycles += 2;
 	}
 
 	if (op & 0x20) {
-		push16 (sp, reg_y);
+		push16 (cpu, sp, cpu->reg_y);
 		*cycles += 2;
 	}
 
 	if (op & 0x10) {
-		push16 (sp, reg_x);
+		push16 (cpu, sp, cpu->reg_x);
 		*cycles += 2;
 	}
 
 	if (op & 0x08) {
-		push8 (sp, reg_dp);
+		push8 (cpu, sp, cpu->reg_dp);
 		*cycles += 1;
 	}
 
 	if (op & 0x04) {
-		push8 (sp, reg_b);
+		push8 (cpu, sp, cpu->reg_b);
 		*cycles += 1;
 	}
 
 	if (op & 0x02) {
-		push8 (sp, reg_a);
+		push8 (cpu, sp, cpu->reg_a);
 		*cycles += 1;
 	}
 
 	if (op & 0x01) {
-		push8 (sp, reg_cc);
+		push8 (cpu, sp, get_cc (cpu));
 		*cycles += 1;
 	}
 }
 
 /* instruction: puls/pulu */
 
-static einline void inst_pul (unsigned op, unsigned *sp, unsigned *osp,
-					   unsigned *cycles)
+static einline void inst_pul (e6809_t *cpu, unsigned op, unsigned *sp,
+					   unsigned *osp, unsigned *cycles)
 {
 	if (op & 0x01) {
-		reg_cc = pull8 (sp);
+		put_cc (cpu, pull8 (cpu, sp));
 		*cycles += 1;
 	}
 
 	if (op & 0x02) {
-		reg_a = pull8 (sp);
+		cpu->reg_a = pull8 (cpu, sp);
 		*cycles += 1;
 	}
 
 	if (op & 0x04) {
-		reg_b = pull8 (sp);
+		cpu->reg_b = pull8 (cpu, sp);
 		*cycles += 1;
 	}
 
 	if (op & 0x08) {
-		reg_dp = pull8 (sp);
+		cpu->reg_dp = pull8 (cpu, sp);
 		*cycles += 1;
 	}
 
 	if (op & 0x10) {
-		reg_x = pull16 (sp);
+		cpu->reg_x = pull16 (cpu, sp);
 		*cycles += 2;
 	}
 
 	if (op & 0x20) {
-		reg_y = pull16 (sp);
+		cpu->reg_y = pull16 (cpu, sp);
 		*cycles += 2;
 	}
 
 	if (op & 0x40) {
 		/* either s or u */
-		*osp = pull16 (sp);
+		*osp = pull16 (cpu, sp);
 		*cycles += 2;
 	}
 
 	if (op & 0x80) {
-		reg_pc = pull16 (sp);
+		cpu->reg_pc = pull16 (cpu, sp);
 		*cycles += 2;
 	}
 }
 
-static einline unsigned exgtfr_read (unsigned reg)
+static einline unsigned exgtfr_read (e6809_t *cpu, unsigned reg)
 {
    unsigned data;
 
    switch (reg)
    {
       case 0x0:
-         data = get_reg_d ();
+         data = get_reg_d (cpu);
          break;
       case 0x1:
-         data = reg_x;
+         data = cpu->reg_x;
          break;
       case 0x2:
-         data = reg_y;
+         data = cpu->reg_y;
          break;
       case 0x3:
-         data = reg_u;
+         data = cpu->reg_u;
          break;
       case 0x4:
-         data = reg_s;
+         data = cpu->reg_s;
          break;
       case 0x5:
-         data = reg_pc;
+         data = cpu->reg_pc;
          break;
       case 0x8:
-         data = 0xff00 | reg_a;
+         data = 0xff00 | cpu->reg_a;
          break;
       case 0x9:
-         data = 0xff00 | reg_b;
+         data = 0xff00 | cpu->reg_b;
          break;
       case 0xa:
-         data = 0xff00 | reg_cc;
+         data = 0xff00 | get_cc (cpu);
          break;
       case 0xb:
-         data = 0xff00 | reg_dp;
+         data = 0xff00 | cpu->reg_dp;
          break;
       default:
          data = 0xffff;
@@ -1008,39 +915,39 @@ static einline unsigned exgtfr_read (unsigned reg)
    return data;
 }
 
-static einline void exgtfr_write (unsigned reg, unsigned data)
+static einline void exgtfr_write (e6809_t *cpu, unsigned reg, unsigned data)
 {
    switch (reg)
    {
       case 0x0:
-         set_reg_d (data);
+         set_reg_d (cpu, data);
          break;
       case 0x1:
-         reg_x = data;
+         cpu->reg_x = data;
          break;
       case 0x2:
-         reg_y = data;
+         cpu->reg_y = data;
          break;
       case 0x3:
-         reg_u = data;
+         cpu->reg_u = data;
          break;
       case 0x4:
-         reg_s = data;
+         cpu->reg_s = data;
          break;
       case 0x5:
-         reg_pc = data;
+         cpu->reg_pc = data;
          break;
       case 0x8:
-         reg_a = data;
+         cpu->reg_a = data;
          break;
       case 0x9:
-         reg_b = data;
+         cpu->reg_b = data;
          break;
       case 0xa:
-         reg_cc = data;
+         put_cc (cpu, data);
          break;
       case 0xb:
-         reg_dp = data;
+         cpu->reg_dp = data;
          break;
       default:
          break;
@@ -1049,1544 +956,1708 @@ static einline void exgtfr_write (unsigned reg, unsigned data)
 
 /* instruction: exg */
 
-static einline void inst_exg (void)
+static einline void inst_exg (e6809_t *cpu)
 {
 	unsigned op, tmp;
 
-	op = pc_read8 ();
+	op = pc_read8 (cpu);
 
-	tmp = exgtfr_read (op & 0xf);
-	exgtfr_write (op & 0xf, exgtfr_read (op >> 4));
-	exgtfr_write (op >> 4, tmp);
+	tmp = exgtfr_read (cpu, op & 0xf);
+	exgtfr_write (cpu, op & 0xf, exgtfr_read (cpu, op >> 4));
+	exgtfr_write (cpu, op >> 4, tmp);
 }
 
 /* instruction: tfr */
 
-static void inst_tfr (void)
+static void inst_tfr (e6809_t *cpu)
 {
 	unsigned op;
 
-	op = pc_read8 ();
+	op = pc_read8 (cpu);
 
-	exgtfr_write (op & 0xf, exgtfr_read (op >> 4));
+	exgtfr_write (cpu, op & 0xf, exgtfr_read (cpu, op >> 4));
 }
 
 /* reset the 6809 */
 
-void e6809_reset (void)
+void e6809_reset (e6809_t *cpu)
 {
-	reg_x = 0;
-	reg_y = 0;
-	reg_u = 0;
-	reg_s = 0;
+	cpu->reg_x = 0;
+	cpu->reg_y = 0;
+	cpu->reg_u = 0;
+	cpu->reg_s = 0;
 
-	reg_a = 0;
-	reg_b = 0;
+	cpu->reg_a = 0;
+	cpu->reg_b = 0;
 
-	reg_dp = 0;
+	cpu->reg_dp = 0;
 
-	reg_cc = FLAG_I | FLAG_F;
-	irq_status = IRQ_NORMAL;
+	put_cc (cpu, FLAG_I | FLAG_F);
+	cpu->irq_status = IRQ_NORMAL;
 
-	reg_pc = read16 (0xfffe);
+	cpu->reg_pc = read16 (cpu, 0xfffe);
 }
 
-/* execute a single instruction or handle interrupts and return */
+/* execute instructions and handle interrupts until at least budget cycles
+ * have elapsed. after each instruction the cycles it took are passed to
+ * sync, which returns the irq line for the next one. with no sync function
+ * a single instruction is executed.
+ */
 
-unsigned e6809_sstep (unsigned irq_i, unsigned irq_f)
+static long e6809_execute (e6809_t *cpu, unsigned irq_i, unsigned irq_f, long budget,
+						   unsigned (*sync) (void *user, unsigned cycles))
 {
 	unsigned op;
 	unsigned cycles = 0;
 	unsigned ea, i0, i1, r;
-
+	long total = 0;
+
+#ifdef E6809_THREADED
+	static const void *const page0[256] = {
+		&&op_00, &&op_none, &&op_none, &&op_03, &&op_04, &&op_none, &&op_06, &&op_07,
+		&&op_08, &&op_09, &&op_0a, &&op_none, &&op_0c, &&op_0d, &&op_0e, &&op_0f,
+		&&op_10, &&op_11, &&op_12, &&op_13, &&op_none, &&op_none, &&op_16, &&op_17,
+		&&op_none, &&op_19, &&op_1a, &&op_none, &&op_1c, &&op_1d, &&op_1e, &&op_1f,
+		&&op_20, &&op_21, &&op_22, &&op_23, &&op_24, &&op_25, &&op_26, &&op_27,
+		&&op_28, &&op_29, &&op_2a, &&op_2b, &&op_2c, &&op_2d, &&op_2e, &&op_2f,
+		&&op_30, &&op_31, &&op_32, &&op_33, &&op_34, &&op_35, &&op_36, &&op_37,
+		&&op_none, &&op_39, &&op_3a, &&op_3b, &&op_3c, &&op_3d, &&op_none, &&op_3f,
+		&&op_40, &&op_none, &&op_none, &&op_43, &&op_44, &&op_none, &&op_46, &&op_47,
+		&&op_48, &&op_49, &&op_4a, &&op_none, &&op_4c, &&op_4d, &&op_none, &&op_4f,
+		&&op_50, &&op_none, &&op_none, &&op_53, &&op_54, &&op_none, &&op_56, &&op_57,
+		&&op_58, &&op_59, &&op_5a, &&op_none, &&op_5c, &&op_5d, &&op_none, &&op_5f,
+		&&op_60, &&op_none, &&op_none, &&op_63, &&op_64, &&op_none, &&op_66, &&op_67,
+		&&op_68, &&op_69, &&op_6a, &&op_none, &&op_6c, &&op_6d, &&op_6e, &&op_6f,
+		&&op_70, &&op_none, &&op_none, &&op_73, &&op_74, &&op_none, &&op_76, &&op_77,
+		&&op_78, &&op_79, &&op_7a, &&op_none, &&op_7c, &&op_7d, &&op_7e, &&op_7f,
+		&&op_80, &&op_81, &&op_82, &&op_83, &&op_84, &&op_85, &&op_86, &&op_none,
+		&&op_88, &&op_89, &&op_8a, &&op_8b, &&op_8c, &&op_8d, &&op_8e, &&op_none,
+		&&op_90, &&op_91, &&op_92, &&op_93, &&op_94, &&op_95, &&op_96, &&op_97,
+		&&op_98, &&op_99, &&op_9a, &&op_9b, &&op_9c, &&op_9d, &&op_9e, &&op_9f,
+		&&op_a0, &&op_a1, &&op_a2, &&op_a3, &&op_a4, &&op_a5, &&op_a6, &&op_a7,
+		&&op_a8, &&op_a9, &&op_aa, &&op_ab, &&op_ac, &&op_ad, &&op_ae, &&op_af,
+		&&op_b0, &&op_b1, &&op_b2, &&op_b3, &&op_b4, &&op_b5, &&op_b6, &&op_b7,
+		&&op_b8, &&op_b9, &&op_ba, &&op_bb, &&op_bc, &&op_bd, &&op_be, &&op_bf,
+		&&op_c0, &&op_c1, &&op_c2, &&op_c3, &&op_c4, &&op_c5, &&op_c6, &&op_none,
+		&&op_c8, &&op_c9, &&op_ca, &&op_cb, &&op_cc, &&op_none, &&op_ce, &&op_none,
+		&&op_d0, &&op_d1, &&op_d2, &&op_d3, &&op_d4, &&op_d5, &&op_d6, &&op_d7,
+		&&op_d8, &&op_d9, &&op_da, &&op_db, &&op_dc, &&op_dd, &&op_de, &&op_df,
+		&&op_e0, &&op_e1, &&op_e2, &&op_e3, &&op_e4, &&op_e5, &&op_e6, &&op_e7,
+		&&op_e8, &&op_e9, &&op_ea, &&op_eb, &&op_ec, &&op_ed, &&op_ee, &&op_ef,
+		&&op_f0, &&op_f1, &&op_f2, &&op_f3, &&op_f4, &&op_f5, &&op_f6, &&op_f7,
+		&&op_f8, &&op_f9, &&op_fa, &&op_fb, &&op_fc, &&op_fd, &&op_fe, &&op_ff
+	};
+	static const void *const page10[256] = {
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_20, &&op10_21, &&op10_22, &&op10_23,
+		&&op10_24, &&op10_25, &&op10_26, &&op10_27, &&op10_28, &&op10_29,
+		&&op10_2a, &&op10_2b, &&op10_2c, &&op10_2d, &&op10_2e, &&op10_2f,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_3f, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_83,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_8c, &&op10_none, &&op10_8e, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_93, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_9c, &&op10_none, &&op10_9e, &&op10_9f, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_a3, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_ac, &&op10_none,
+		&&op10_ae, &&op10_af, &&op10_none, &&op10_none, &&op10_none, &&op10_b3,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_bc, &&op10_none, &&op10_be, &&op10_bf,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_ce, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_de, &&op10_df, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_ee, &&op10_ef,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none, &&op10_none,
+		&&op10_none, &&op10_none, &&op10_fe, &&op10_ff
+	};
+	static const void *const page11[256] = {
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_3f, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_83,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_8c, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_93, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_9c, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_a3, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_ac, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_b3,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_bc, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none, &&op11_none,
+		&&op11_none, &&op11_none, &&op11_none, &&op11_none
+	};
+#endif
+
+step:
 	if (irq_f) {
 		if (GET_CC(FLAG_F) == 0) {
-			if (irq_status != IRQ_CWAI) {
-				set_cc (FLAG_E, 0);
-				inst_psh (0x81, &reg_s, reg_u, &cycles);
+			if (cpu->irq_status != IRQ_CWAI) {
+				set_cc (cpu, FLAG_E, 0);
+				inst_psh (cpu, 0x81, &cpu->reg_s, cpu->reg_u, &cycles);
 			}
 
-			set_cc (FLAG_I, 1);
-			set_cc (FLAG_F, 1);
+			set_cc (cpu, FLAG_I, 1);
+			set_cc (cpu, FLAG_F, 1);
 
-			reg_pc = read16 (0xfff6);
-			irq_status = IRQ_NORMAL;
+			cpu->reg_pc = read16 (cpu, 0xfff6);
+			cpu->irq_status = IRQ_NORMAL;
 			cycles += 7;
 		} else {
-			if (irq_status == IRQ_SYNC) {
-				irq_status = IRQ_NORMAL;
+			if (cpu->irq_status == IRQ_SYNC) {
+				cpu->irq_status = IRQ_NORMAL;
 			}
 		}
 	}
 
 	if (irq_i) {
 		if (GET_CC(FLAG_I) == 0) {
-			if (irq_status != IRQ_CWAI) {
-				set_cc (FLAG_E, 1);
-				inst_psh (0xff, &reg_s, reg_u, &cycles);
+			if (cpu->irq_status != IRQ_CWAI) {
+				set_cc (cpu, FLAG_E, 1);
+				inst_psh (cpu, 0xff, &cpu->reg_s, cpu->reg_u, &cycles);
 			}
 
-			set_cc (FLAG_I, 1);
+			set_cc (cpu, FLAG_I, 1);
 
-			reg_pc = read16 (0xfff8);
-			irq_status = IRQ_NORMAL;
+			cpu->reg_pc = read16 (cpu, 0xfff8);
+			cpu->irq_status = IRQ_NORMAL;
 			cycles += 7;
 		} else {
-			if (irq_status == IRQ_SYNC) {
-				irq_status = IRQ_NORMAL;
+			if (cpu->irq_status == IRQ_SYNC) {
+				cpu->irq_status = IRQ_NORMAL;
 			}
 		}
 	}
 
-	if (irq_status != IRQ_NORMAL) {
-		return cycles + 1;
+	if (cpu->irq_status != IRQ_NORMAL) {
+		cycles++;
+		goto next;
 	}
 
-	op = pc_read8 ();
+	op = pc_read8 (cpu);
 
-	switch (op) {
+	DISPATCH (page0, op) {
 	/* page 0 instructions */
 
 	/* neg, nega, negb */
-	case 0x00:
-		ea = ea_direct ();
-		r = inst_neg (read8 (ea));
-		write8 (ea, r);
+	OP (00)
+		ea = ea_direct (cpu);
+		r = inst_neg (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 6;
-		break;
-	case 0x40:
-		reg_a = inst_neg (reg_a);
+		NEXT;
+	OP (40)
+		cpu->reg_a = inst_neg (cpu, cpu->reg_a);
 		cycles += 2;
-		break;
-	case 0x50:
-		reg_b = inst_neg (reg_b);
+		NEXT;
+	OP (50)
+		cpu->reg_b = inst_neg (cpu, cpu->reg_b);
 		cycles += 2;
-		break;
-	case 0x60:
-		ea = ea_indexed (&cycles);
-		r = inst_neg (read8 (ea));
-		write8 (ea, r);
+		NEXT;
+	OP (60)
+		ea = ea_indexed (cpu, &cycles);
+		r = inst_neg (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 6;
-		break;
-	case 0x70:
-		ea = ea_extended ();
-		r = inst_neg (read8 (ea));
-		write8 (ea, r);
+		NEXT;
+	OP (70)
+		ea = ea_extended (cpu);
+		r = inst_neg (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 7;
-		break;
+		NEXT;
 	/* com, coma, comb */
-	case 0x03:
-		ea = ea_direct ();
-		r = inst_com (read8 (ea));
-		write8 (ea, r);
+	OP (03)
+		ea = ea_direct (cpu);
+		r = inst_com (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 6;
-		break;
-	case 0x43:
-		reg_a = inst_com (reg_a);
+		NEXT;
+	OP (43)
+		cpu->reg_a = inst_com (cpu, cpu->reg_a);
 		cycles += 2;
-		break;
-	case 0x53:
-		reg_b = inst_com (reg_b);
+		NEXT;
+	OP (53)
+		cpu->reg_b = inst_com (cpu, cpu->reg_b);
 		cycles += 2;
-		break;
-	case 0x63:
-		ea = ea_indexed (&cycles);
-		r = inst_com (read8 (ea));
-		write8 (ea, r);
+		NEXT;
+	OP (63)
+		ea = ea_indexed (cpu, &cycles);
+		r = inst_com (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 6;
-		break;
-	case 0x73:
-		ea = ea_extended ();
-		r = inst_com (read8 (ea));
-		write8 (ea, r);
+		NEXT;
+	OP (73)
+		ea = ea_extended (cpu);
+		r = inst_com (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 7;
-		break;
+		NEXT;
 	/* lsr, lsra, lsrb */
-	case 0x04:
-		ea = ea_direct ();
-		r = inst_lsr (read8 (ea));
-		write8 (ea, r);
+	OP (04)
+		ea = ea_direct (cpu);
+		r = inst_lsr (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 6;
-		break;
-	case 0x44:
-		reg_a = inst_lsr (reg_a);
+		NEXT;
+	OP (44)
+		cpu->reg_a = inst_lsr (cpu, cpu->reg_a);
 		cycles += 2;
-		break;
-	case 0x54:
-		reg_b = inst_lsr (reg_b);
+		NEXT;
+	OP (54)
+		cpu->reg_b = inst_lsr (cpu, cpu->reg_b);
 		cycles += 2;
-		break;
-	case 0x64:
-		ea = ea_indexed (&cycles);
-		r = inst_lsr (read8 (ea));
-		write8 (ea, r);
+		NEXT;
+	OP (64)
+		ea = ea_indexed (cpu, &cycles);
+		r = inst_lsr (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 6;
-		break;
-	case 0x74:
-		ea = ea_extended ();
-		r = inst_lsr (read8 (ea));
-		write8 (ea, r);
+		NEXT;
+	OP (74)
+		ea = ea_extended (cpu);
+		r = inst_lsr (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 7;
-		break;
+		NEXT;
 	/* ror, rora, rorb */
-	case 0x06:
-		ea = ea_direct ();
-		r = inst_ror (read8 (ea));
-		write8 (ea, r);
+	OP (06)
+		ea = ea_direct (cpu);
+		r = inst_ror (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 6;
-		break;
-	case 0x46:
-		reg_a = inst_ror (reg_a);
+		NEXT;
+	OP (46)
+		cpu->reg_a = inst_ror (cpu, cpu->reg_a);
 		cycles += 2;
-		break;
-	case 0x56:
-		reg_b = inst_ror (reg_b);
+		NEXT;
+	OP (56)
+		cpu->reg_b = inst_ror (cpu, cpu->reg_b);
 		cycles += 2;
-		break;
-	case 0x66:
-		ea = ea_indexed (&cycles);
-		r = inst_ror (read8 (ea));
-		write8 (ea, r);
+		NEXT;
+	OP (66)
+		ea = ea_indexed (cpu, &cycles);
+		r = inst_ror (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 6;
-		break;
-	case 0x76:
-		ea = ea_extended ();
-		r = inst_ror (read8 (ea));
-		write8 (ea, r);
+		NEXT;
+	OP (76)
+		ea = ea_extended (cpu);
+		r = inst_ror (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 7;
-		break;
+		NEXT;
 	/* asr, asra, asrb */
-	case 0x07:
-		ea = ea_direct ();
-		r = inst_asr (read8 (ea));
-		write8 (ea, r);
+	OP (07)
+		ea = ea_direct (cpu);
+		r = inst_asr (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 6;
-		break;
-	case 0x47:
-		reg_a = inst_asr (reg_a);
+		NEXT;
+	OP (47)
+		cpu->reg_a = inst_asr (cpu, cpu->reg_a);
 		cycles += 2;
-		break;
-	case 0x57:
-		reg_b = inst_asr (reg_b);
+		NEXT;
+	OP (57)
+		cpu->reg_b = inst_asr (cpu, cpu->reg_b);
 		cycles += 2;
-		break;
-	case 0x67:
-		ea = ea_indexed (&cycles);
-		r = inst_asr (read8 (ea));
-		write8 (ea, r);
+		NEXT;
+	OP (67)
+		ea = ea_indexed (cpu, &cycles);
+		r = inst_asr (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 6;
-		break;
-	case 0x77:
-		ea = ea_extended ();
-		r = inst_asr (read8 (ea));
-		write8 (ea, r);
+		NEXT;
+	OP (77)
+		ea = ea_extended (cpu);
+		r = inst_asr (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 7;
-		break;
+		NEXT;
 	/* asl, asla, aslb */
-	case 0x08:
-		ea = ea_direct ();
-		r = inst_asl (read8 (ea));
-		write8 (ea, r);
+	OP (08)
+		ea = ea_direct (cpu);
+		r = inst_asl (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 6;
-		break;
-	case 0x48:
-		reg_a = inst_asl (reg_a);
+		NEXT;
+	OP (48)
+		cpu->reg_a = inst_asl (cpu, cpu->reg_a);
 		cycles += 2;
-		break;
-	case 0x58:
-		reg_b = inst_asl (reg_b);
+		NEXT;
+	OP (58)
+		cpu->reg_b = inst_asl (cpu, cpu->reg_b);
 		cycles += 2;
-		break;
-	case 0x68:
-		ea = ea_indexed (&cycles);
-		r = inst_asl (read8 (ea));
-		write8 (ea, r);
+		NEXT;
+	OP (68)
+		ea = ea_indexed (cpu, &cycles);
+		r = inst_asl (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 6;
-		break;
-	case 0x78:
-		ea = ea_extended ();
-		r = inst_asl (read8 (ea));
-		write8 (ea, r);
+		NEXT;
+	OP (78)
+		ea = ea_extended (cpu);
+		r = inst_asl (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 7;
-		break;
+		NEXT;
 	/* rol, rola, rolb */
-	case 0x09:
-		ea = ea_direct ();
-		r = inst_rol (read8 (ea));
-		write8 (ea, r);
+	OP (09)
+		ea = ea_direct (cpu);
+		r = inst_rol (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 6;
-		break;
-	case 0x49:
-		reg_a = inst_rol (reg_a);
+		NEXT;
+	OP (49)
+		cpu->reg_a = inst_rol (cpu, cpu->reg_a);
 		cycles += 2;
-		break;
-	case 0x59:
-		reg_b = inst_rol (reg_b);
+		NEXT;
+	OP (59)
+		cpu->reg_b = inst_rol (cpu, cpu->reg_b);
 		cycles += 2;
-		break;
-	case 0x69:
-		ea = ea_indexed (&cycles);
-		r = inst_rol (read8 (ea));
-		write8 (ea, r);
+		NEXT;
+	OP (69)
+		ea = ea_indexed (cpu, &cycles);
+		r = inst_rol (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 6;
-		break;
-	case 0x79:
-		ea = ea_extended ();
-		r = inst_rol (read8 (ea));
-		write8 (ea, r);
+		NEXT;
+	OP (79)
+		ea = ea_extended (cpu);
+		r = inst_rol (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 7;
-		break;
+		NEXT;
 	/* dec, deca, decb */
-	case 0x0a:
-		ea = ea_direct ();
-		r = inst_dec (read8 (ea));
-		write8 (ea, r);
+	OP (0a)
+		ea = ea_direct (cpu);
+		r = inst_dec (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 6;
-		break;
-	case 0x4a:
-		reg_a = inst_dec (reg_a);
+		NEXT;
+	OP (4a)
+		cpu->reg_a = inst_dec (cpu, cpu->reg_a);
 		cycles += 2;
-		break;
-	case 0x5a:
-		reg_b = inst_dec (reg_b);
+		NEXT;
+	OP (5a)
+		cpu->reg_b = inst_dec (cpu, cpu->reg_b);
 		cycles += 2;
-		break;
-	case 0x6a:
-		ea = ea_indexed (&cycles);
-		r = inst_dec (read8 (ea));
-		write8 (ea, r);
+		NEXT;
+	OP (6a)
+		ea = ea_indexed (cpu, &cycles);
+		r = inst_dec (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 6;
-		break;
-	case 0x7a:
-		ea = ea_extended ();
-		r = inst_dec (read8 (ea));
-		write8 (ea, r);
+		NEXT;
+	OP (7a)
+		ea = ea_extended (cpu);
+		r = inst_dec (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 7;
-		break;
+		NEXT;
 	/* inc, inca, incb */
-	case 0x0c:
-		ea = ea_direct ();
-		r = inst_inc (read8 (ea));
-		write8 (ea, r);
+	OP (0c)
+		ea = ea_direct (cpu);
+		r = inst_inc (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 6;
-		break;
-	case 0x4c:
-		reg_a = inst_inc (reg_a);
+		NEXT;
+	OP (4c)
+		cpu->reg_a = inst_inc (cpu, cpu->reg_a);
 		cycles += 2;
-		break;
-	case 0x5c:
-		reg_b = inst_inc (reg_b);
+		NEXT;
+	OP (5c)
+		cpu->reg_b = inst_inc (cpu, cpu->reg_b);
 		cycles += 2;
-		break;
-	case 0x6c:
-		ea = ea_indexed (&cycles);
-		r = inst_inc (read8 (ea));
-		write8 (ea, r);
+		NEXT;
+	OP (6c)
+		ea = ea_indexed (cpu, &cycles);
+		r = inst_inc (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 6;
-		break;
-	case 0x7c:
-		ea = ea_extended ();
-		r = inst_inc (read8 (ea));
-		write8 (ea, r);
+		NEXT;
+	OP (7c)
+		ea = ea_extended (cpu);
+		r = inst_inc (cpu, read8 (cpu, ea));
+		write8 (cpu, ea, r);
 		cycles += 7;
-		break;
+		NEXT;
 	/* tst, tsta, tstb */
-	case 0x0d:
-		ea = ea_direct ();
-		inst_tst8 (read8 (ea));
+	OP (0d)
+		ea = ea_direct (cpu);
+		inst_tst8 (cpu, read8 (cpu, ea));
 		cycles += 6;
-		break;
-	case 0x4d:
-		inst_tst8 (reg_a);
+		NEXT;
+	OP (4d)
+		inst_tst8 (cpu, cpu->reg_a);
 		cycles += 2;
-		break;
-	case 0x5d:
-		inst_tst8 (reg_b);
+		NEXT;
+	OP (5d)
+		inst_tst8 (cpu, cpu->reg_b);
 		cycles += 2;
-		break;
-	case 0x6d:
-		ea = ea_indexed (&cycles);
-		inst_tst8 (read8 (ea));
+		NEXT;
+	OP (6d)
+		ea = ea_indexed (cpu, &cycles);
+		inst_tst8 (cpu, read8 (cpu, ea));
 		cycles += 6;
-		break;
-	case 0x7d:
-		ea = ea_extended ();
-		inst_tst8 (read8 (ea));
+		NEXT;
+	OP (7d)
+		ea = ea_extended (cpu);
+		inst_tst8 (cpu, read8 (cpu, ea));
 		cycles += 7;
-		break;
+		NEXT;
 	/* jmp */
-	case 0x0e:
-		reg_pc = ea_direct ();
+	OP (0e)
+		cpu->reg_pc = ea_direct (cpu);
 		cycles += 3;
-		break;
-	case 0x6e:
-		reg_pc = ea_indexed (&cycles);
+		NEXT;
+	OP (6e)
+		cpu->reg_pc = ea_indexed (cpu, &cycles);
 		cycles += 3;
-		break;
-	case 0x7e:
-		reg_pc = ea_extended ();
+		NEXT;
+	OP (7e)
+		cpu->reg_pc = ea_extended (cpu);
 		cycles += 4;
-		break;
+		NEXT;
 	/* clr */
-	case 0x0f:
-		ea = ea_direct ();
-		inst_clr ();
-		write8 (ea, 0);
+	OP (0f)
+		ea = ea_direct (cpu);
+		inst_clr (cpu);
+		write8 (cpu, ea, 0);
 		cycles += 6;
-		break;
-	case 0x4f:
-		inst_clr ();
-		reg_a = 0;
+		NEXT;
+	OP (4f)
+		inst_clr (cpu);
+		cpu->reg_a = 0;
 		cycles += 2;
-		break;
-	case 0x5f:
-		inst_clr ();
-		reg_b = 0;
+		NEXT;
+	OP (5f)
+		inst_clr (cpu);
+		cpu->reg_b = 0;
 		cycles += 2;
-		break;
-	case 0x6f:
-		ea = ea_indexed (&cycles);
-		inst_clr ();
-		write8 (ea, 0);
+		NEXT;
+	OP (6f)
+		ea = ea_indexed (cpu, &cycles);
+		inst_clr (cpu);
+		write8 (cpu, ea, 0);
 		cycles += 6;
-		break;
-	case 0x7f:
-		ea = ea_extended ();
-		inst_clr ();
-		write8 (ea, 0);
+		NEXT;
+	OP (7f)
+		ea = ea_extended (cpu);
+		inst_clr (cpu);
+		write8 (cpu, ea, 0);
 		cycles += 7;
-		break;
+		NEXT;
 	/* suba */
-	case 0x80:
-		reg_a = inst_sub8 (reg_a, pc_read8 ());
+	OP (80)
+		cpu->reg_a = inst_sub8 (cpu, cpu->reg_a, pc_read8 (cpu));
 		cycles += 2;
-		break;
-	case 0x90:
-		ea = ea_direct ();
-		reg_a = inst_sub8 (reg_a, read8 (ea));
+		NEXT;
+	OP (90)
+		ea = ea_direct (cpu);
+		cpu->reg_a = inst_sub8 (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xa0:
-		ea = ea_indexed (&cycles);
-		reg_a = inst_sub8 (reg_a, read8 (ea));
+		NEXT;
+	OP (a0)
+		ea = ea_indexed (cpu, &cycles);
+		cpu->reg_a = inst_sub8 (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xb0:
-		ea = ea_extended ();
-		reg_a = inst_sub8 (reg_a, read8 (ea));
+		NEXT;
+	OP (b0)
+		ea = ea_extended (cpu);
+		cpu->reg_a = inst_sub8 (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 5;
-		break;
+		NEXT;
 	/* subb */
-	case 0xc0:
-		reg_b = inst_sub8 (reg_b, pc_read8 ());
+	OP (c0)
+		cpu->reg_b = inst_sub8 (cpu, cpu->reg_b, pc_read8 (cpu));
 		cycles += 2;
-		break;
-	case 0xd0:
-		ea = ea_direct ();
-		reg_b = inst_sub8 (reg_b, read8 (ea));
+		NEXT;
+	OP (d0)
+		ea = ea_direct (cpu);
+		cpu->reg_b = inst_sub8 (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xe0:
-		ea = ea_indexed (&cycles);
-		reg_b = inst_sub8 (reg_b, read8 (ea));
+		NEXT;
+	OP (e0)
+		ea = ea_indexed (cpu, &cycles);
+		cpu->reg_b = inst_sub8 (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xf0:
-		ea = ea_extended ();
-		reg_b = inst_sub8 (reg_b, read8 (ea));
+		NEXT;
+	OP (f0)
+		ea = ea_extended (cpu);
+		cpu->reg_b = inst_sub8 (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 5;
-		break;
+		NEXT;
 	/* cmpa */
-	case 0x81:
-		inst_sub8 (reg_a, pc_read8 ());
+	OP (81)
+		inst_sub8 (cpu, cpu->reg_a, pc_read8 (cpu));
 		cycles += 2;
-		break;
-	case 0x91:
-		ea = ea_direct ();
-		inst_sub8 (reg_a, read8 (ea));
+		NEXT;
+	OP (91)
+		ea = ea_direct (cpu);
+		inst_sub8 (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xa1:
-		ea = ea_indexed (&cycles);
-		inst_sub8 (reg_a, read8 (ea));
+		NEXT;
+	OP (a1)
+		ea = ea_indexed (cpu, &cycles);
+		inst_sub8 (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xb1:
-		ea = ea_extended ();
-		inst_sub8 (reg_a, read8 (ea));
+		NEXT;
+	OP (b1)
+		ea = ea_extended (cpu);
+		inst_sub8 (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 5;
-		break;
+		NEXT;
 	/* cmpb */
-	case 0xc1:
-		inst_sub8 (reg_b, pc_read8 ());
+	OP (c1)
+		inst_sub8 (cpu, cpu->reg_b, pc_read8 (cpu));
 		cycles += 2;
-		break;
-	case 0xd1:
-		ea = ea_direct ();
-		inst_sub8 (reg_b, read8 (ea));
+		NEXT;
+	OP (d1)
+		ea = ea_direct (cpu);
+		inst_sub8 (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xe1:
-		ea = ea_indexed (&cycles);
-		inst_sub8 (reg_b, read8 (ea));
+		NEXT;
+	OP (e1)
+		ea = ea_indexed (cpu, &cycles);
+		inst_sub8 (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xf1:
-		ea = ea_extended ();
-		inst_sub8 (reg_b, read8 (ea));
+		NEXT;
+	OP (f1)
+		ea = ea_extended (cpu);
+		inst_sub8 (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 5;
-		break;
+		NEXT;
 	/* sbca */
-	case 0x82:
-		reg_a = inst_sbc (reg_a, pc_read8 ());
+	OP (82)
+		cpu->reg_a = inst_sbc (cpu, cpu->reg_a, pc_read8 (cpu));
 		cycles += 2;
-		break;
-	case 0x92:
-		ea = ea_direct ();
-		reg_a = inst_sbc (reg_a, read8 (ea));
+		NEXT;
+	OP (92)
+		ea = ea_direct (cpu);
+		cpu->reg_a = inst_sbc (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xa2:
-		ea = ea_indexed (&cycles);
-		reg_a = inst_sbc (reg_a, read8 (ea));
+		NEXT;
+	OP (a2)
+		ea = ea_indexed (cpu, &cycles);
+		cpu->reg_a = inst_sbc (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xb2:
-		ea = ea_extended ();
-		reg_a = inst_sbc (reg_a, read8 (ea));
+		NEXT;
+	OP (b2)
+		ea = ea_extended (cpu);
+		cpu->reg_a = inst_sbc (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 5;
-		break;
+		NEXT;
 	/* sbcb */
-	case 0xc2:
-		reg_b = inst_sbc (reg_b, pc_read8 ());
+	OP (c2)
+		cpu->reg_b = inst_sbc (cpu, cpu->reg_b, pc_read8 (cpu));
 		cycles += 2;
-		break;
-	case 0xd2:
-		ea = ea_direct ();
-		reg_b = inst_sbc (reg_b, read8 (ea));
+		NEXT;
+	OP (d2)
+		ea = ea_direct (cpu);
+		cpu->reg_b = inst_sbc (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xe2:
-		ea = ea_indexed (&cycles);
-		reg_b = inst_sbc (reg_b, read8 (ea));
+		NEXT;
+	OP (e2)
+		ea = ea_indexed (cpu, &cycles);
+		cpu->reg_b = inst_sbc (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xf2:
-		ea = ea_extended ();
-		reg_b = inst_sbc (reg_b, read8 (ea));
+		NEXT;
+	OP (f2)
+		ea = ea_extended (cpu);
+		cpu->reg_b = inst_sbc (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 5;
-		break;
+		NEXT;
 	/* anda */
-	case 0x84:
-		reg_a = inst_and (reg_a, pc_read8 ());
+	OP (84)
+		cpu->reg_a = inst_and (cpu, cpu->reg_a, pc_read8 (cpu));
 		cycles += 2;
-		break;
-	case 0x94:
-		ea = ea_direct ();
-		reg_a = inst_and (reg_a, read8 (ea));
+		NEXT;
+	OP (94)
+		ea = ea_direct (cpu);
+		cpu->reg_a = inst_and (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xa4:
-		ea = ea_indexed (&cycles);
-		reg_a = inst_and (reg_a, read8 (ea));
+		NEXT;
+	OP (a4)
+		ea = ea_indexed (cpu, &cycles);
+		cpu->reg_a = inst_and (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xb4:
-		ea = ea_extended ();
-		reg_a = inst_and (reg_a, read8 (ea));
+		NEXT;
+	OP (b4)
+		ea = ea_extended (cpu);
+		cpu->reg_a = inst_and (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 5;
-		break;
+		NEXT;
 	/* andb */
-	case 0xc4:
-		reg_b = inst_and (reg_b, pc_read8 ());
+	OP (c4)
+		cpu->reg_b = inst_and (cpu, cpu->reg_b, pc_read8 (cpu));
 		cycles += 2;
-		break;
-	case 0xd4:
-		ea = ea_direct ();
-		reg_b = inst_and (reg_b, read8 (ea));
+		NEXT;
+	OP (d4)
+		ea = ea_direct (cpu);
+		cpu->reg_b = inst_and (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xe4:
-		ea = ea_indexed (&cycles);
-		reg_b = inst_and (reg_b, read8 (ea));
+		NEXT;
+	OP (e4)
+		ea = ea_indexed (cpu, &cycles);
+		cpu->reg_b = inst_and (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xf4:
-		ea = ea_extended ();
-		reg_b = inst_and (reg_b, read8 (ea));
+		NEXT;
+	OP (f4)
+		ea = ea_extended (cpu);
+		cpu->reg_b = inst_and (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 5;
-		break;
+		NEXT;
 	/* bita */
-	case 0x85:
-		inst_and (reg_a, pc_read8 ());
+	OP (85)
+		inst_and (cpu, cpu->reg_a, pc_read8 (cpu));
 		cycles += 2;
-		break;
-	case 0x95:
-		ea = ea_direct ();
-		inst_and (reg_a, read8 (ea));
+		NEXT;
+	OP (95)
+		ea = ea_direct (cpu);
+		inst_and (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xa5:
-		ea = ea_indexed (&cycles);
-		inst_and (reg_a, read8 (ea));
+		NEXT;
+	OP (a5)
+		ea = ea_indexed (cpu, &cycles);
+		inst_and (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xb5:
-		ea = ea_extended ();
-		inst_and (reg_a, read8 (ea));
+		NEXT;
+	OP (b5)
+		ea = ea_extended (cpu);
+		inst_and (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 5;
-		break;
+		NEXT;
 	/* bitb */
-	case 0xc5:
-		inst_and (reg_b, pc_read8 ());
+	OP (c5)
+		inst_and (cpu, cpu->reg_b, pc_read8 (cpu));
 		cycles += 2;
-		break;
-	case 0xd5:
-		ea = ea_direct ();
-		inst_and (reg_b, read8 (ea));
+		NEXT;
+	OP (d5)
+		ea = ea_direct (cpu);
+		inst_and (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xe5:
-		ea = ea_indexed (&cycles);
-		inst_and (reg_b, read8 (ea));
+		NEXT;
+	OP (e5)
+		ea = ea_indexed (cpu, &cycles);
+		inst_and (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xf5:
-		ea = ea_extended ();
-		inst_and (reg_b, read8 (ea));
+		NEXT;
+	OP (f5)
+		ea = ea_extended (cpu);
+		inst_and (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 5;
-		break;
+		NEXT;
 	/* lda */
-	case 0x86:
-		reg_a = pc_read8 ();
-		inst_tst8 (reg_a);
+	OP (86)
+		cpu->reg_a = pc_read8 (cpu);
+		inst_tst8 (cpu, cpu->reg_a);
 		cycles += 2;
-		break;
-	case 0x96:
-		ea = ea_direct ();
-		reg_a = read8 (ea);
-		inst_tst8 (reg_a);
+		NEXT;
+	OP (96)
+		ea = ea_direct (cpu);
+		cpu->reg_a = read8 (cpu, ea);
+		inst_tst8 (cpu, cpu->reg_a);
 		cycles += 4;
-		break;
-	case 0xa6:
-		ea = ea_indexed (&cycles);
-		reg_a = read8 (ea);
-		inst_tst8 (reg_a);
+		NEXT;
+	OP (a6)
+		ea = ea_indexed (cpu, &cycles);
+		cpu->reg_a = read8 (cpu, ea);
+		inst_tst8 (cpu, cpu->reg_a);
 		cycles += 4;
-		break;
-	case 0xb6:
-		ea = ea_extended ();
-		reg_a = read8 (ea);
-		inst_tst8 (reg_a);
+		NEXT;
+	OP (b6)
+		ea = ea_extended (cpu);
+		cpu->reg_a = read8 (cpu, ea);
+		inst_tst8 (cpu, cpu->reg_a);
 		cycles += 5;
-		break;
+		NEXT;
 	/* ldb */
-	case 0xc6:
-		reg_b = pc_read8 ();
-		inst_tst8 (reg_b);
+	OP (c6)
+		cpu->reg_b = pc_read8 (cpu);
+		inst_tst8 (cpu, cpu->reg_b);
 		cycles += 2;
-		break;
-	case 0xd6:
-		ea = ea_direct ();
-		reg_b = read8 (ea);
-		inst_tst8 (reg_b);
+		NEXT;
+	OP (d6)
+		ea = ea_direct (cpu);
+		cpu->reg_b = read8 (cpu, ea);
+		inst_tst8 (cpu, cpu->reg_b);
 		cycles += 4;
-		break;
-	case 0xe6:
-		ea = ea_indexed (&cycles);
-		reg_b = read8 (ea);
-		inst_tst8 (reg_b);
+		NEXT;
+	OP (e6)
+		ea = ea_indexed (cpu, &cycles);
+		cpu->reg_b = read8 (cpu, ea);
+		inst_tst8 (cpu, cpu->reg_b);
 		cycles += 4;
-		break;
-	case 0xf6:
-		ea = ea_extended ();
-		reg_b = read8 (ea);
-		inst_tst8 (reg_b);
+		NEXT;
+	OP (f6)
+		ea = ea_extended (cpu);
+		cpu->reg_b = read8 (cpu, ea);
+		inst_tst8 (cpu, cpu->reg_b);
 		cycles += 5;
-		break;
+		NEXT;
 	/* sta */
-	case 0x97:
-		ea = ea_direct ();
-		write8 (ea, reg_a);
-		inst_tst8 (reg_a);
+	OP (97)
+		ea = ea_direct (cpu);
+		write8 (cpu, ea, cpu->reg_a);
+		inst_tst8 (cpu, cpu->reg_a);
 		cycles += 4;
-		break;
-	case 0xa7:
-		ea = ea_indexed (&cycles);
-		write8 (ea, reg_a);
-		inst_tst8 (reg_a);
+		NEXT;
+	OP (a7)
+		ea = ea_indexed (cpu, &cycles);
+		write8 (cpu, ea, cpu->reg_a);
+		inst_tst8 (cpu, cpu->reg_a);
 		cycles += 4;
-		break;
-	case 0xb7:
-		ea = ea_extended ();
-		write8 (ea, reg_a);
-		inst_tst8 (reg_a);
+		NEXT;
+	OP (b7)
+		ea = ea_extended (cpu);
+		write8 (cpu, ea, cpu->reg_a);
+		inst_tst8 (cpu, cpu->reg_a);
 		cycles += 5;
-		break;
+		NEXT;
 	/* stb */
-	case 0xd7:
-		ea = ea_direct ();
-		write8 (ea, reg_b);
-		inst_tst8 (reg_b);
+	OP (d7)
+		ea = ea_direct (cpu);
+		write8 (cpu, ea, cpu->reg_b);
+		inst_tst8 (cpu, cpu->reg_b);
 		cycles += 4;
-		break;
-	case 0xe7:
-		ea = ea_indexed (&cycles);
-		write8 (ea, reg_b);
-		inst_tst8 (reg_b);
+		NEXT;
+	OP (e7)
+		ea = ea_indexed (cpu, &cycles);
+		write8 (cpu, ea, cpu->reg_b);
+		inst_tst8 (cpu, cpu->reg_b);
 		cycles += 4;
-		break;
-	case 0xf7:
-		ea = ea_extended ();
-		write8 (ea, reg_b);
-		inst_tst8 (reg_b);
+		NEXT;
+	OP (f7)
+		ea = ea_extended (cpu);
+		write8 (cpu, ea, cpu->reg_b);
+		inst_tst8 (cpu, cpu->reg_b);
 		cycles += 5;
-		break;
+		NEXT;
 	/* eora */
-	case 0x88:
-		reg_a = inst_eor (reg_a, pc_read8 ());
+	OP (88)
+		cpu->reg_a = inst_eor (cpu, cpu->reg_a, pc_read8 (cpu));
 		cycles += 2;
-		break;
-	case 0x98:
-		ea = ea_direct ();
-		reg_a = inst_eor (reg_a, read8 (ea));
+		NEXT;
+	OP (98)
+		ea = ea_direct (cpu);
+		cpu->reg_a = inst_eor (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xa8:
-		ea = ea_indexed (&cycles);
-		reg_a = inst_eor (reg_a, read8 (ea));
+		NEXT;
+	OP (a8)
+		ea = ea_indexed (cpu, &cycles);
+		cpu->reg_a = inst_eor (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xb8:
-		ea = ea_extended ();
-		reg_a = inst_eor (reg_a, read8 (ea));
+		NEXT;
+	OP (b8)
+		ea = ea_extended (cpu);
+		cpu->reg_a = inst_eor (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 5;
-		break;
+		NEXT;
 	/* eorb */
-	case 0xc8:
-		reg_b = inst_eor (reg_b, pc_read8 ());
+	OP (c8)
+		cpu->reg_b = inst_eor (cpu, cpu->reg_b, pc_read8 (cpu));
 		cycles += 2;
-		break;
-	case 0xd8:
-		ea = ea_direct ();
-		reg_b = inst_eor (reg_b, read8 (ea));
+		NEXT;
+	OP (d8)
+		ea = ea_direct (cpu);
+		cpu->reg_b = inst_eor (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xe8:
-		ea = ea_indexed (&cycles);
-		reg_b = inst_eor (reg_b, read8 (ea));
+		NEXT;
+	OP (e8)
+		ea = ea_indexed (cpu, &cycles);
+		cpu->reg_b = inst_eor (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xf8:
-		ea = ea_extended ();
-		reg_b = inst_eor (reg_b, read8 (ea));
+		NEXT;
+	OP (f8)
+		ea = ea_extended (cpu);
+		cpu->reg_b = inst_eor (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 5;
-		break;
+		NEXT;
 	/* adca */
-	case 0x89:
-		reg_a = inst_adc (reg_a, pc_read8 ());
+	OP (89)
+		cpu->reg_a = inst_adc (cpu, cpu->reg_a, pc_read8 (cpu));
 		cycles += 2;
-		break;
-	case 0x99:
-		ea = ea_direct ();
-		reg_a = inst_adc (reg_a, read8 (ea));
+		NEXT;
+	OP (99)
+		ea = ea_direct (cpu);
+		cpu->reg_a = inst_adc (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xa9:
-		ea = ea_indexed (&cycles);
-		reg_a = inst_adc (reg_a, read8 (ea));
+		NEXT;
+	OP (a9)
+		ea = ea_indexed (cpu, &cycles);
+		cpu->reg_a = inst_adc (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xb9:
-		ea = ea_extended ();
-		reg_a = inst_adc (reg_a, read8 (ea));
+		NEXT;
+	OP (b9)
+		ea = ea_extended (cpu);
+		cpu->reg_a = inst_adc (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 5;
-		break;
+		NEXT;
 	/* adcb */
-	case 0xc9:
-		reg_b = inst_adc (reg_b, pc_read8 ());
+	OP (c9)
+		cpu->reg_b = inst_adc (cpu, cpu->reg_b, pc_read8 (cpu));
 		cycles += 2;
-		break;
-	case 0xd9:
-		ea = ea_direct ();
-		reg_b = inst_adc (reg_b, read8 (ea));
+		NEXT;
+	OP (d9)
+		ea = ea_direct (cpu);
+		cpu->reg_b = inst_adc (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xe9:
-		ea = ea_indexed (&cycles);
-		reg_b = inst_adc (reg_b, read8 (ea));
+		NEXT;
+	OP (e9)
+		ea = ea_indexed (cpu, &cycles);
+		cpu->reg_b = inst_adc (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xf9:
-		ea = ea_extended ();
-		reg_b = inst_adc (reg_b, read8 (ea));
+		NEXT;
+	OP (f9)
+		ea = ea_extended (cpu);
+		cpu->reg_b = inst_adc (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 5;
-		break;
+		NEXT;
 	/* ora */
-	case 0x8a:
-		reg_a = inst_or (reg_a, pc_read8 ());
+	OP (8a)
+		cpu->reg_a = inst_or (cpu, cpu->reg_a, pc_read8 (cpu));
 		cycles += 2;
-		break;
-	case 0x9a:
-		ea = ea_direct ();
-		reg_a = inst_or (reg_a, read8 (ea));
+		NEXT;
+	OP (9a)
+		ea = ea_direct (cpu);
+		cpu->reg_a = inst_or (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xaa:
-		ea = ea_indexed (&cycles);
-		reg_a = inst_or (reg_a, read8 (ea));
+		NEXT;
+	OP (aa)
+		ea = ea_indexed (cpu, &cycles);
+		cpu->reg_a = inst_or (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xba:
-		ea = ea_extended ();
-		reg_a = inst_or (reg_a, read8 (ea));
+		NEXT;
+	OP (ba)
+		ea = ea_extended (cpu);
+		cpu->reg_a = inst_or (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 5;
-		break;
+		NEXT;
 	/* orb */
-	case 0xca:
-		reg_b = inst_or (reg_b, pc_read8 ());
+	OP (ca)
+		cpu->reg_b = inst_or (cpu, cpu->reg_b, pc_read8 (cpu));
 		cycles += 2;
-		break;
-	case 0xda:
-		ea = ea_direct ();
-		reg_b = inst_or (reg_b, read8 (ea));
+		NEXT;
+	OP (da)
+		ea = ea_direct (cpu);
+		cpu->reg_b = inst_or (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xea:
-		ea = ea_indexed (&cycles);
-		reg_b = inst_or (reg_b, read8 (ea));
+		NEXT;
+	OP (ea)
+		ea = ea_indexed (cpu, &cycles);
+		cpu->reg_b = inst_or (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xfa:
-		ea = ea_extended ();
-		reg_b = inst_or (reg_b, read8 (ea));
+		NEXT;
+	OP (fa)
+		ea = ea_extended (cpu);
+		cpu->reg_b = inst_or (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 5;
-		break;
+		NEXT;
 	/* adda */
-	case 0x8b:
-		reg_a = inst_add8 (reg_a, pc_read8 ());
+	OP (8b)
+		cpu->reg_a = inst_add8 (cpu, cpu->reg_a, pc_read8 (cpu));
 		cycles += 2;
-		break;
-	case 0x9b:
-		ea = ea_direct ();
-		reg_a = inst_add8 (reg_a, read8 (ea));
+		NEXT;
+	OP (9b)
+		ea = ea_direct (cpu);
+		cpu->reg_a = inst_add8 (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xab:
-		ea = ea_indexed (&cycles);
-		reg_a = inst_add8 (reg_a, read8 (ea));
+		NEXT;
+	OP (ab)
+		ea = ea_indexed (cpu, &cycles);
+		cpu->reg_a = inst_add8 (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xbb:
-		ea = ea_extended ();
-		reg_a = inst_add8 (reg_a, read8 (ea));
+		NEXT;
+	OP (bb)
+		ea = ea_extended (cpu);
+		cpu->reg_a = inst_add8 (cpu, cpu->reg_a, read8 (cpu, ea));
 		cycles += 5;
-		break;
+		NEXT;
 	/* addb */
-	case 0xcb:
-		reg_b = inst_add8 (reg_b, pc_read8 ());
+	OP (cb)
+		cpu->reg_b = inst_add8 (cpu, cpu->reg_b, pc_read8 (cpu));
 		cycles += 2;
-		break;
-	case 0xdb:
-		ea = ea_direct ();
-		reg_b = inst_add8 (reg_b, read8 (ea));
+		NEXT;
+	OP (db)
+		ea = ea_direct (cpu);
+		cpu->reg_b = inst_add8 (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xeb:
-		ea = ea_indexed (&cycles);
-		reg_b = inst_add8 (reg_b, read8 (ea));
+		NEXT;
+	OP (eb)
+		ea = ea_indexed (cpu, &cycles);
+		cpu->reg_b = inst_add8 (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 4;
-		break;
-	case 0xfb:
-		ea = ea_extended ();
-		reg_b = inst_add8 (reg_b, read8 (ea));
+		NEXT;
+	OP (fb)
+		ea = ea_extended (cpu);
+		cpu->reg_b = inst_add8 (cpu, cpu->reg_b, read8 (cpu, ea));
 		cycles += 5;
-		break;
+		NEXT;
 	/* subd */
-	case 0x83:
-		set_reg_d (inst_sub16 (get_reg_d (), pc_read16 ()));
+	OP (83)
+		set_reg_d (cpu, inst_sub16 (cpu, get_reg_d (cpu), pc_read16 (cpu)));
 		cycles += 4;
-		break;
-	case 0x93:
-		ea = ea_direct ();
-		set_reg_d (inst_sub16 (get_reg_d (), read16 (ea)));
+		NEXT;
+	OP (93)
+		ea = ea_direct (cpu);
+		set_reg_d (cpu, inst_sub16 (cpu, get_reg_d (cpu), read16 (cpu, ea)));
 		cycles += 6;
-		break;
-	case 0xa3:
-		ea = ea_indexed (&cycles);
-		set_reg_d (inst_sub16 (get_reg_d (), read16 (ea)));
+		NEXT;
+	OP (a3)
+		ea = ea_indexed (cpu, &cycles);
+		set_reg_d (cpu, inst_sub16 (cpu, get_reg_d (cpu), read16 (cpu, ea)));
 		cycles += 6;
-		break;
-	case 0xb3:
-		ea = ea_extended ();
-		set_reg_d (inst_sub16 (get_reg_d (), read16 (ea)));
+		NEXT;
+	OP (b3)
+		ea = ea_extended (cpu);
+		set_reg_d (cpu, inst_sub16 (cpu, get_reg_d (cpu), read16 (cpu, ea)));
 		cycles += 7;
-		break;
+		NEXT;
 	/* cmpx */
-	case 0x8c:
-		inst_sub16 (reg_x, pc_read16 ());
+	OP (8c)
+		inst_sub16 (cpu, cpu->reg_x, pc_read16 (cpu));
 		cycles += 4;
-		break;
-	case 0x9c:
-		ea = ea_direct ();
-		inst_sub16 (reg_x, read16 (ea));
+		NEXT;
+	OP (9c)
+		ea = ea_direct (cpu);
+		inst_sub16 (cpu, cpu->reg_x, read16 (cpu, ea));
 		cycles += 6;
-		break;
-	case 0xac:
-		ea = ea_indexed (&cycles);
-		inst_sub16 (reg_x, read16 (ea));
+		NEXT;
+	OP (ac)
+		ea = ea_indexed (cpu, &cycles);
+		inst_sub16 (cpu, cpu->reg_x, read16 (cpu, ea));
 		cycles += 6;
-		break;
-	case 0xbc:
-		ea = ea_extended ();
-		inst_sub16 (reg_x, read16 (ea));
+		NEXT;
+	OP (bc)
+		ea = ea_extended (cpu);
+		inst_sub16 (cpu, cpu->reg_x, read16 (cpu, ea));
 		cycles += 7;
-		break;
+		NEXT;
 	/* ldx */
-	case 0x8e:
-		reg_x = pc_read16 ();
-		inst_tst16 (reg_x);
+	OP (8e)
+		cpu->reg_x = pc_read16 (cpu);
+		inst_tst16 (cpu, cpu->reg_x);
 		cycles += 3;
-		break;
-	case 0x9e:
-		ea = ea_direct ();
-		reg_x = read16 (ea);
-		inst_tst16 (reg_x);
+		NEXT;
+	OP (9e)
+		ea = ea_direct (cpu);
+		cpu->reg_x = read16 (cpu, ea);
+		inst_tst16 (cpu, cpu->reg_x);
 		cycles += 5;
-		break;
-	case 0xae:
-		ea = ea_indexed (&cycles);
-		reg_x = read16 (ea);
-		inst_tst16 (reg_x);
+		NEXT;
+	OP (ae)
+		ea = ea_indexed (cpu, &cycles);
+		cpu->reg_x = read16 (cpu, ea);
+		inst_tst16 (cpu, cpu->reg_x);
 		cycles += 5;
-		break;
-	case 0xbe:
-		ea = ea_extended ();
-		reg_x = read16 (ea);
-		inst_tst16 (reg_x);
+		NEXT;
+	OP (be)
+		ea = ea_extended (cpu);
+		cpu->reg_x = read16 (cpu, ea);
+		inst_tst16 (cpu, cpu->reg_x);
 		cycles += 6;
-		break;
+		NEXT;
 	/* ldu */
-	case 0xce:
-		reg_u = pc_read16 ();
-		inst_tst16 (reg_u);
+	OP (ce)
+		cpu->reg_u = pc_read16 (cpu);
+		inst_tst16 (cpu, cpu->reg_u);
 		cycles += 3;
-		break;
-	case 0xde:
-		ea = ea_direct ();
-		reg_u = read16 (ea);
-		inst_tst16 (reg_u);
+		NEXT;
+	OP (de)
+		ea = ea_direct (cpu);
+		cpu->reg_u = read16 (cpu, ea);
+		inst_tst16 (cpu, cpu->reg_u);
 		cycles += 5;
-		break;
-	case 0xee:
-		ea = ea_indexed (&cycles);
-		reg_u = read16 (ea);
-		inst_tst16 (reg_u);
+		NEXT;
+	OP (ee)
+		ea = ea_indexed (cpu, &cycles);
+		cpu->reg_u = read16 (cpu, ea);
+		inst_tst16 (cpu, cpu->reg_u);
 		cycles += 5;
-		break;
-	case 0xfe:
-		ea = ea_extended ();
-		reg_u = read16 (ea);
-		inst_tst16 (reg_u);
+		NEXT;
+	OP (fe)
+		ea = ea_extended (cpu);
+		cpu->reg_u = read16 (cpu, ea);
+		inst_tst16 (cpu, cpu->reg_u);
 		cycles += 6;
-		break;
+		NEXT;
 	/* stx */
-	case 0x9f:
-		ea = ea_direct ();
-		write16 (ea, reg_x);
-		inst_tst16 (reg_x);
+	OP (9f)
+		ea = ea_direct (cpu);
+		write16 (cpu, ea, cpu->reg_x);
+		inst_tst16 (cpu, cpu->reg_x);
 		cycles += 5;
-		break;
-	case 0xaf:
-		ea = ea_indexed (&cycles);
-		write16 (ea, reg_x);
-		inst_tst16 (reg_x);
+		NEXT;
+	OP (af)
+		ea = ea_indexed (cpu, &cycles);
+		write16 (cpu, ea, cpu->reg_x);
+		inst_tst16 (cpu, cpu->reg_x);
 		cycles += 5;
-		break;
-	case 0xbf:
-		ea = ea_extended ();
-		write16 (ea, reg_x);
-		inst_tst16 (reg_x);
+		NEXT;
+	OP (bf)
+		ea = ea_extended (cpu);
+		write16 (cpu, ea, cpu->reg_x);
+		inst_tst16 (cpu, cpu->reg_x);
 		cycles += 6;
-		break;
+		NEXT;
 	/* stu */
-	case 0xdf:
-		ea = ea_direct ();
-		write16 (ea, reg_u);
-		inst_tst16 (reg_u);
+	OP (df)
+		ea = ea_direct (cpu);
+		write16 (cpu, ea, cpu->reg_u);
+		inst_tst16 (cpu, cpu->reg_u);
 		cycles += 5;
-		break;
-	case 0xef:
-		ea = ea_indexed (&cycles);
-		write16 (ea, reg_u);
-		inst_tst16 (reg_u);
+		NEXT;
+	OP (ef)
+		ea = ea_indexed (cpu, &cycles);
+		write16 (cpu, ea, cpu->reg_u);
+		inst_tst16 (cpu, cpu->reg_u);
 		cycles += 5;
-		break;
-	case 0xff:
-		ea = ea_extended ();
-		write16 (ea, reg_u);
-		inst_tst16 (reg_u);
+		NEXT;
+	OP (ff)
+		ea = ea_extended (cpu);
+		write16 (cpu, ea, cpu->reg_u);
+		inst_tst16 (cpu, cpu->reg_u);
 		cycles += 6;
-		break;
+		NEXT;
 	/* addd */
-	case 0xc3:
-		set_reg_d (inst_add16 (get_reg_d (), pc_read16 ()));
+	OP (c3)
+		set_reg_d (cpu, inst_add16 (cpu, get_reg_d (cpu), pc_read16 (cpu)));
 		cycles += 4;
-		break;
-	case 0xd3:
-		ea = ea_direct ();
-		set_reg_d (inst_add16 (get_reg_d (), read16 (ea)));
+		NEXT;
+	OP (d3)
+		ea = ea_direct (cpu);
+		set_reg_d (cpu, inst_add16 (cpu, get_reg_d (cpu), read16 (cpu, ea)));
 		cycles += 6;
-		break;
-	case 0xe3:
-		ea = ea_indexed (&cycles);
-		set_reg_d (inst_add16 (get_reg_d (), read16 (ea)));
+		NEXT;
+	OP (e3)
+		ea = ea_indexed (cpu, &cycles);
+		set_reg_d (cpu, inst_add16 (cpu, get_reg_d (cpu), read16 (cpu, ea)));
 		cycles += 6;
-		break;
-	case 0xf3:
-		ea = ea_extended ();
-		set_reg_d (inst_add16 (get_reg_d (), read16 (ea)));
+		NEXT;
+	OP (f3)
+		ea = ea_extended (cpu);
+		set_reg_d (cpu, inst_add16 (cpu, get_reg_d (cpu), read16 (cpu, ea)));
 		cycles += 7;
-		break;
+		NEXT;
 	/* ldd */
-	case 0xcc:
-		set_reg_d (pc_read16 ());
-		inst_tst16 (get_reg_d ());
+	OP (cc)
+		set_reg_d (cpu, pc_read16 (cpu));
+		inst_tst16 (cpu, get_reg_d (cpu));
 		cycles += 3;
-		break;
-	case 0xdc:
-		ea = ea_direct ();
-		set_reg_d (read16 (ea));
-		inst_tst16 (get_reg_d ());
+		NEXT;
+	OP (dc)
+		ea = ea_direct (cpu);
+		set_reg_d (cpu, read16 (cpu, ea));
+		inst_tst16 (cpu, get_reg_d (cpu));
 		cycles += 5;
-		break;
-	case 0xec:
-		ea = ea_indexed (&cycles);
-		set_reg_d (read16 (ea));
-		inst_tst16 (get_reg_d ());
+		NEXT;
+	OP (ec)
+		ea = ea_indexed (cpu, &cycles);
+		set_reg_d (cpu, read16 (cpu, ea));
+		inst_tst16 (cpu, get_reg_d (cpu));
 		cycles += 5;
-		break;
-	case 0xfc:
-		ea = ea_extended ();
-		set_reg_d (read16 (ea));
-		inst_tst16 (get_reg_d ());
+		NEXT;
+	OP (fc)
+		ea = ea_extended (cpu);
+		set_reg_d (cpu, read16 (cpu, ea));
+		inst_tst16 (cpu, get_reg_d (cpu));
 		cycles += 6;
-		break;
+		NEXT;
 	/* std */
-	case 0xdd:
-		ea = ea_direct ();
-		write16 (ea, get_reg_d ());
-		inst_tst16 (get_reg_d ());
+	OP (dd)
+		ea = ea_direct (cpu);
+		write16 (cpu, ea, get_reg_d (cpu));
+		inst_tst16 (cpu, get_reg_d (cpu));
 		cycles += 5;
-		break;
-	case 0xed:
-		ea = ea_indexed (&cycles);
-		write16 (ea, get_reg_d ());
-		inst_tst16 (get_reg_d ());
+		NEXT;
+	OP (ed)
+		ea = ea_indexed (cpu, &cycles);
+		write16 (cpu, ea, get_reg_d (cpu));
+		inst_tst16 (cpu, get_reg_d (cpu));
 		cycles += 5;
-		break;
-	case 0xfd:
-		ea = ea_extended ();
-		write16 (ea, get_reg_d ());
-		inst_tst16 (get_reg_d ());
+		NEXT;
+	OP (fd)
+		ea = ea_extended (cpu);
+		write16 (cpu, ea, get_reg_d (cpu));
+		inst_tst16 (cpu, get_reg_d (cpu));
 		cycles += 6;
-		break;
+		NEXT;
 	/* nop */
-	case 0x12:
+	OP (12)
 		cycles += 2;
-		break;
+		NEXT;
 	/* mul */
-	case 0x3d:
-		r = (reg_a & 0xff) * (reg_b & 0xff);
-		set_reg_d (r);
+	OP (3d)
+		r = (cpu->reg_a & 0xff) * (cpu->reg_b & 0xff);
+		set_reg_d (cpu, r);
 
-		set_cc (FLAG_Z, test_z16 (r));
-		set_cc (FLAG_C, (r >> 7) & 1);
+		set_cc (cpu, FLAG_Z, test_z16 (r));
+		set_cc (cpu, FLAG_C, (r >> 7) & 1);
 
 		cycles += 11;
-		break;
+		NEXT;
 	/* bra */
-	case 0x20:
+	OP (20)
 	/* brn */
-	case 0x21:
-		inst_bra8 (0, op, &cycles);
-		break;
+	OP (21)
+		inst_bra8 (cpu, 0, op, &cycles);
+		NEXT;
 	/* bhi */
-	case 0x22:
+	OP (22)
 	/* bls */
-	case 0x23:
-		inst_bra8 (GET_CC(FLAG_C) | GET_CC(FLAG_Z), op, &cycles);
-		break;
+	OP (23)
+		inst_bra8 (cpu, GET_CC(FLAG_C) | GET_CC(FLAG_Z), op, &cycles);
+		NEXT;
 	/* bhs/bcc */
-	case 0x24:
+	OP (24)
 	/* blo/bcs */
-	case 0x25:
-		inst_bra8 (GET_CC(FLAG_C), op, &cycles);
-		break;
+	OP (25)
+		inst_bra8 (cpu, GET_CC(FLAG_C), op, &cycles);
+		NEXT;
 	/* bne */
-	case 0x26:
+	OP (26)
 	/* beq */
-	case 0x27:
-		inst_bra8 (GET_CC(FLAG_Z), op, &cycles);
-		break;
+	OP (27)
+		inst_bra8 (cpu, GET_CC(FLAG_Z), op, &cycles);
+		NEXT;
 	/* bvc */
-	case 0x28:
+	OP (28)
 	/* bvs */
-	case 0x29:
-		inst_bra8 (GET_CC (FLAG_V), op, &cycles);
-		break;
+	OP (29)
+		inst_bra8 (cpu, GET_CC (FLAG_V), op, &cycles);
+		NEXT;
 	/* bpl */
-	case 0x2a:
+	OP (2a)
 	/* bmi */
-	case 0x2b:
-		inst_bra8 (GET_CC (FLAG_N), op, &cycles);
-		break;
+	OP (2b)
+		inst_bra8 (cpu, GET_CC (FLAG_N), op, &cycles);
+		NEXT;
 	/* bge */
-	case 0x2c:
+	OP (2c)
 	/* blt */
-	case 0x2d:
-		inst_bra8 (GET_CC (FLAG_N) ^ GET_CC (FLAG_V), op, &cycles);
-		break;
+	OP (2d)
+		inst_bra8 (cpu, GET_CC (FLAG_N) ^ GET_CC (FLAG_V), op, &cycles);
+		NEXT;
 	/* bgt */
-	case 0x2e:
+	OP (2e)
 	/* ble */
-	case 0x2f:
-		inst_bra8 (GET_CC (FLAG_Z) |
+	OP (2f)
+		inst_bra8 (cpu, GET_CC (FLAG_Z) |
 				   (GET_CC (FLAG_N) ^ GET_CC (FLAG_V)), op, &cycles);
-		break;
+		NEXT;
 	/* lbra */
-	case 0x16:
-		r = pc_read16 ();
-		reg_pc += r;
+	OP (16)
+		r = pc_read16 (cpu);
+		cpu->reg_pc += r;
 		cycles += 5;
-		break;
+		NEXT;
 	/* lbsr */
-	case 0x17:
-		r = pc_read16 ();
-		push16 (&reg_s, reg_pc);
-		reg_pc += r;
+	OP (17)
+		r = pc_read16 (cpu);
+		push16 (cpu, &cpu->reg_s, cpu->reg_pc);
+		cpu->reg_pc += r;
 		cycles += 9;
-		break;
+		NEXT;
 	/* bsr */
-	case 0x8d:
-		r = pc_read8 ();
-		push16 (&reg_s, reg_pc);
-		reg_pc += sign_extend (r);
+	OP (8d)
+		r = pc_read8 (cpu);
+		push16 (cpu, &cpu->reg_s, cpu->reg_pc);
+		cpu->reg_pc += sign_extend (r);
 		cycles += 7;
-		break;
+		NEXT;
 	/* jsr */
-	case 0x9d:
-		ea = ea_direct ();
-		push16 (&reg_s, reg_pc);
-		reg_pc = ea;
+	OP (9d)
+		ea = ea_direct (cpu);
+		push16 (cpu, &cpu->reg_s, cpu->reg_pc);
+		cpu->reg_pc = ea;
 		cycles += 7;
-		break;
-	case 0xad:
-		ea = ea_indexed (&cycles);
-		push16 (&reg_s, reg_pc);
-		reg_pc = ea;
+		NEXT;
+	OP (ad)
+		ea = ea_indexed (cpu, &cycles);
+		push16 (cpu, &cpu->reg_s, cpu->reg_pc);
+		cpu->reg_pc = ea;
 		cycles += 7;
-		break;
-	case 0xbd:
-		ea = ea_extended ();
-		push16 (&reg_s, reg_pc);
-		reg_pc = ea;
+		NEXT;
+	OP (bd)
+		ea = ea_extended (cpu);
+		push16 (cpu, &cpu->reg_s, cpu->reg_pc);
+		cpu->reg_pc = ea;
 		cycles += 8;
-		break;
+		NEXT;
 	/* leax */
-	case 0x30:
-		reg_x = ea_indexed (&cycles);
-		set_cc (FLAG_Z, test_z16 (reg_x));
+	OP (30)
+		cpu->reg_x = ea_indexed (cpu, &cycles);
+		set_cc (cpu, FLAG_Z, test_z16 (cpu->reg_x));
 		cycles += 4;
-		break;
+		NEXT;
 	/* leay */
-	case 0x31:
-		reg_y = ea_indexed (&cycles);
-		set_cc (FLAG_Z, test_z16 (reg_y));
+	OP (31)
+		cpu->reg_y = ea_indexed (cpu, &cycles);
+		set_cc (cpu, FLAG_Z, test_z16 (cpu->reg_y));
 		cycles += 4;
-		break;
+		NEXT;
 	/* leas */
-	case 0x32:
-		reg_s = ea_indexed (&cycles);
+	OP (32)
+		cpu->reg_s = ea_indexed (cpu, &cycles);
 		cycles += 4;
-		break;
+		NEXT;
 	/* leau */
-	case 0x33:
-		reg_u = ea_indexed (&cycles);
+	OP (33)
+		cpu->reg_u = ea_indexed (cpu, &cycles);
 		cycles += 4;
-		break;
+		NEXT;
 	/* pshs */
-	case 0x34:
-		inst_psh (pc_read8 (), &reg_s, reg_u, &cycles);
+	OP (34)
+		inst_psh (cpu, pc_read8 (cpu), &cpu->reg_s, cpu->reg_u, &cycles);
 		cycles += 5;
-		break;
+		NEXT;
 	/* puls */
-	case 0x35:
-		inst_pul (pc_read8 (), &reg_s, &reg_u, &cycles);
+	OP (35)
+		inst_pul (cpu, pc_read8 (cpu), &cpu->reg_s, &cpu->reg_u, &cycles);
 		cycles += 5;
-		break;
+		NEXT;
 	/* pshu */
-	case 0x36:
-		inst_psh (pc_read8 (), &reg_u, reg_s, &cycles);
+	OP (36)
+		inst_psh (cpu, pc_read8 (cpu), &cpu->reg_u, cpu->reg_s, &cycles);
 		cycles += 5;
-		break;
+		NEXT;
 	/* pulu */
-	case 0x37:
-		inst_pul (pc_read8 (), &reg_u, &reg_s, &cycles);
+	OP (37)
+		inst_pul (cpu, pc_read8 (cpu), &cpu->reg_u, &cpu->reg_s, &cycles);
 		cycles += 5;
-		break;
+		NEXT;
 	/* rts */
-	case 0x39:
-		reg_pc = pull16 (&reg_s);
+	OP (39)
+		cpu->reg_pc = pull16 (cpu, &cpu->reg_s);
 		cycles += 5;
-		break;
+		NEXT;
 	/* abx */
-	case 0x3a:
-		reg_x += reg_b & 0xff;
+	OP (3a)
+		cpu->reg_x += cpu->reg_b & 0xff;
 		cycles += 3;
-		break;
+		NEXT;
 	/* orcc */
-	case 0x1a:
-		reg_cc |= pc_read8 ();
+	OP (1a)
+		put_cc (cpu, get_cc (cpu) | pc_read8 (cpu));
 		cycles += 3;
-		break;
+		NEXT;
 	/* andcc */
-	case 0x1c:
-		reg_cc &= pc_read8 ();
+	OP (1c)
+		put_cc (cpu, get_cc (cpu) & pc_read8 (cpu));
 		cycles += 3;
-		break;
+		NEXT;
 	/* sex */
-	case 0x1d:
-		set_reg_d (sign_extend (reg_b));
-		set_cc (FLAG_N, TEST_N (reg_a));
-		set_cc (FLAG_Z, test_z16 (get_reg_d ()));
+	OP (1d)
+		set_reg_d (cpu, sign_extend (cpu->reg_b));
+		set_nz16 (cpu, get_reg_d (cpu));
 		cycles += 2;
-		break;
+		NEXT;
 	/* exg */
-	case 0x1e:
-		inst_exg ();
+	OP (1e)
+		inst_exg (cpu);
 		cycles += 8;
-		break;
+		NEXT;
 	/* tfr */
-	case 0x1f:
-		inst_tfr ();
+	OP (1f)
+		inst_tfr (cpu);
 		cycles += 6;
-		break;
+		NEXT;
 	/* rti */
-	case 0x3b:
+	OP (3b)
 		if (GET_CC (FLAG_E)) {
-			inst_pul (0xff, &reg_s, &reg_u, &cycles);
+			inst_pul (cpu, 0xff, &cpu->reg_s, &cpu->reg_u, &cycles);
 		} else {
-			inst_pul (0x81, &reg_s, &reg_u, &cycles);
+			inst_pul (cpu, 0x81, &cpu->reg_s, &cpu->reg_u, &cycles);
 		}
 
 		cycles += 3;
-		break;
+		NEXT;
 	/* swi */
-	case 0x3f:
-		set_cc (FLAG_E, 1);
-		inst_psh (0xff, &reg_s, reg_u, &cycles);
-		set_cc (FLAG_I, 1);
-		set_cc (FLAG_F, 1);
-        reg_pc = read16 (0xfffa);
+	OP (3f)
+		set_cc (cpu, FLAG_E, 1);
+		inst_psh (cpu, 0xff, &cpu->reg_s, cpu->reg_u, &cycles);
+		set_cc (cpu, FLAG_I, 1);
+		set_cc (cpu, FLAG_F, 1);
+        cpu->reg_pc = read16 (cpu, 0xfffa);
         cycles += 7;
-		break;
+		NEXT;
 	/* sync */
-	case 0x13:
-		irq_status = IRQ_SYNC;
+	OP (13)
+		cpu->irq_status = IRQ_SYNC;
 		cycles += 2;
-		break;
+		NEXT;
 	/* daa */
-	case 0x19:
-		i0 = reg_a;
+	OP (19)
+		i0 = cpu->reg_a;
 		i1 = 0;
 
-		if ((reg_a & 0x0f) > 0x09 || GET_CC (FLAG_H) == 1) {
+		if ((cpu->reg_a & 0x0f) > 0x09 || GET_CC (FLAG_H) == 1) {
 			i1 |= 0x06;
 		}
 
-		if ((reg_a & 0xf0) > 0x80 && (reg_a & 0x0f) > 0x09) {
+		if ((cpu->reg_a & 0xf0) > 0x80 && (cpu->reg_a & 0x0f) > 0x09) {
 			i1 |= 0x60;
 		}
 
-		if ((reg_a & 0xf0) > 0x90 || GET_CC (FLAG_C) == 1) {
+		if ((cpu->reg_a & 0xf0) > 0x90 || GET_CC (FLAG_C) == 1) {
 			i1 |= 0x60;
 		}
 
-		reg_a = i0 + i1;
+		cpu->reg_a = i0 + i1;
 
-		set_cc (FLAG_N, TEST_N (reg_a));
-		set_cc (FLAG_Z, test_z8 (reg_a));
-		set_cc (FLAG_V, 0);
-		set_cc (FLAG_C, test_c (i0, i1, reg_a, 0));
+		set_nz8 (cpu, cpu->reg_a);
+		set_cc (cpu, FLAG_V, 0);
+		set_cc (cpu, FLAG_C, test_c (i0, i1, cpu->reg_a, 0));
 		cycles += 2;
-		break;
+		NEXT;
 	/* cwai */
-	case 0x3c:
-		reg_cc &= pc_read8 ();
-		set_cc (FLAG_E, 1);
-		inst_psh (0xff, &reg_s, reg_u, &cycles);
-		irq_status = IRQ_CWAI;
+	OP (3c)
+		put_cc (cpu, get_cc (cpu) & pc_read8 (cpu));
+		set_cc (cpu, FLAG_E, 1);
+		inst_psh (cpu, 0xff, &cpu->reg_s, cpu->reg_u, &cycles);
+		cpu->irq_status = IRQ_CWAI;
 		cycles += 4;
-		break;
+		NEXT;
 
 	/* page 1 instructions */
 
-	case 0x10:
-		op = pc_read8 ();
+	OP (10)
+		op = pc_read8 (cpu);
 
-		switch (op) {
+		DISPATCH (page10, op) {
 		/* lbra */
-		case 0x20:
+		OP10 (20)
 		/* lbrn */
-		case 0x21:
-			inst_bra16 (0, op, &cycles);
-			break;
+		OP10 (21)
+			inst_bra16 (cpu, 0, op, &cycles);
+			NEXT;
 		/* lbhi */
-		case 0x22:
+		OP10 (22)
 		/* lbls */
-		case 0x23:
-			inst_bra16 (GET_CC (FLAG_C) | GET_CC (FLAG_Z), op, &cycles);
-			break;
+		OP10 (23)
+			inst_bra16 (cpu, GET_CC (FLAG_C) | GET_CC (FLAG_Z), op, &cycles);
+			NEXT;
 		/* lbhs/lbcc */
-		case 0x24:
+		OP10 (24)
 		/* lblo/lbcs */
-		case 0x25:
-			inst_bra16 (GET_CC (FLAG_C), op, &cycles);
-			break;
+		OP10 (25)
+			inst_bra16 (cpu, GET_CC (FLAG_C), op, &cycles);
+			NEXT;
 		/* lbne */
-		case 0x26:
+		OP10 (26)
 		/* lbeq */
-		case 0x27:
-			inst_bra16 (GET_CC (FLAG_Z), op, &cycles);
-			break;
+		OP10 (27)
+			inst_bra16 (cpu, GET_CC (FLAG_Z), op, &cycles);
+			NEXT;
 		/* lbvc */
-		case 0x28:
+		OP10 (28)
 		/* lbvs */
-		case 0x29:
-			inst_bra16 (GET_CC (FLAG_V), op, &cycles);
-			break;
+		OP10 (29)
+			inst_bra16 (cpu, GET_CC (FLAG_V), op, &cycles);
+			NEXT;
 		/* lbpl */
-		case 0x2a:
+		OP10 (2a)
 		/* lbmi */
-		case 0x2b:
-			inst_bra16 (GET_CC (FLAG_N), op, &cycles);
-			break;
+		OP10 (2b)
+			inst_bra16 (cpu, GET_CC (FLAG_N), op, &cycles);
+			NEXT;
 		/* lbge */
-		case 0x2c:
+		OP10 (2c)
 		/* lblt */
-		case 0x2d:
-			inst_bra16 (GET_CC (FLAG_N) ^ GET_CC (FLAG_V), op, &cycles);
-			break;
+		OP10 (2d)
+			inst_bra16 (cpu, GET_CC (FLAG_N) ^ GET_CC (FLAG_V), op, &cycles);
+			NEXT;
 		/* lbgt */
-		case 0x2e:
+		OP10 (2e)
 		/* lble */
-		case 0x2f:
-			inst_bra16 (GET_CC (FLAG_Z) |
+		OP10 (2f)
+			inst_bra16 (cpu, GET_CC (FLAG_Z) |
                (GET_CC (FLAG_N) ^ GET_CC (FLAG_V)), op, &cycles);
-			break;
+			NEXT;
 		/* cmpd */
-		case 0x83:
-			inst_sub16 (get_reg_d (), pc_read16 ());
+		OP10 (83)
+			inst_sub16 (cpu, get_reg_d (cpu), pc_read16 (cpu));
 			cycles += 5;
-			break;
-		case 0x93:
-			ea = ea_direct ();
-			inst_sub16 (get_reg_d (), read16 (ea));
+			NEXT;
+		OP10 (93)
+			ea = ea_direct (cpu);
+			inst_sub16 (cpu, get_reg_d (cpu), read16 (cpu, ea));
 			cycles += 7;
-			break;
-		case 0xa3:
-			ea = ea_indexed (&cycles);
-			inst_sub16 (get_reg_d (), read16 (ea));
+			NEXT;
+		OP10 (a3)
+			ea = ea_indexed (cpu, &cycles);
+			inst_sub16 (cpu, get_reg_d (cpu), read16 (cpu, ea));
 			cycles += 7;
-			break;
-		case 0xb3:
-			ea = ea_extended ();
-			inst_sub16 (get_reg_d (), read16 (ea));
+			NEXT;
+		OP10 (b3)
+			ea = ea_extended (cpu);
+			inst_sub16 (cpu, get_reg_d (cpu), read16 (cpu, ea));
 			cycles += 8;
-			break;
+			NEXT;
 		/* cmpy */
-		case 0x8c:
-			inst_sub16 (reg_y, pc_read16 ());
+		OP10 (8c)
+			inst_sub16 (cpu, cpu->reg_y, pc_read16 (cpu));
 			cycles += 5;
-			break;
-		case 0x9c:
-			ea = ea_direct ();
-			inst_sub16 (reg_y, read16 (ea));
+			NEXT;
+		OP10 (9c)
+			ea = ea_direct (cpu);
+			inst_sub16 (cpu, cpu->reg_y, read16 (cpu, ea));
 			cycles += 7;
-			break;
-		case 0xac:
-			ea = ea_indexed (&cycles);
-			inst_sub16 (reg_y, read16 (ea));
+			NEXT;
+		OP10 (ac)
+			ea = ea_indexed (cpu, &cycles);
+			inst_sub16 (cpu, cpu->reg_y, read16 (cpu, ea));
 			cycles += 7;
-			break;
-		case 0xbc:
-			ea = ea_extended ();
-			inst_sub16 (reg_y, read16 (ea));
+			NEXT;
+		OP10 (bc)
+			ea = ea_extended (cpu);
+			inst_sub16 (cpu, cpu->reg_y, read16 (cpu, ea));
 			cycles += 8;
-			break;
+			NEXT;
 		/* ldy */
-		case 0x8e:
-			reg_y = pc_read16 ();
-			inst_tst16 (reg_y);
+		OP10 (8e)
+			cpu->reg_y = pc_read16 (cpu);
+			inst_tst16 (cpu, cpu->reg_y);
 			cycles += 4;
-			break;
-		case 0x9e:
-			ea = ea_direct ();
-			reg_y = read16 (ea);
-			inst_tst16 (reg_y);
+			NEXT;
+		OP10 (9e)
+			ea = ea_direct (cpu);
+			cpu->reg_y = read16 (cpu, ea);
+			inst_tst16 (cpu, cpu->reg_y);
 			cycles += 6;
-			break;
-		case 0xae:
-			ea = ea_indexed (&cycles);
-			reg_y = read16 (ea);
-			inst_tst16 (reg_y);
+			NEXT;
+		OP10 (ae)
+			ea = ea_indexed (cpu, &cycles);
+			cpu->reg_y = read16 (cpu, ea);
+			inst_tst16 (cpu, cpu->reg_y);
 			cycles += 6;
-			break;
-		case 0xbe:
-			ea = ea_extended ();
-			reg_y = read16 (ea);
-			inst_tst16 (reg_y);
+			NEXT;
+		OP10 (be)
+			ea = ea_extended (cpu);
+			cpu->reg_y = read16 (cpu, ea);
+			inst_tst16 (cpu, cpu->reg_y);
 			cycles += 7;
-			break;
+			NEXT;
 		/* sty */
-		case 0x9f:
-			ea = ea_direct ();
-			write16 (ea, reg_y);
-			inst_tst16 (reg_y);
+		OP10 (9f)
+			ea = ea_direct (cpu);
+			write16 (cpu, ea, cpu->reg_y);
+			inst_tst16 (cpu, cpu->reg_y);
 			cycles += 6;
-			break;
-		case 0xaf:
-			ea = ea_indexed (&cycles);
-			write16 (ea, reg_y);
-			inst_tst16 (reg_y);
+			NEXT;
+		OP10 (af)
+			ea = ea_indexed (cpu, &cycles);
+			write16 (cpu, ea, cpu->reg_y);
+			inst_tst16 (cpu, cpu->reg_y);
 			cycles += 6;
-			break;
-		case 0xbf:
-			ea = ea_extended ();
-			write16 (ea, reg_y);
-			inst_tst16 (reg_y);
+			NEXT;
+		OP10 (bf)
+			ea = ea_extended (cpu);
+			write16 (cpu, ea, cpu->reg_y);
+			inst_tst16 (cpu, cpu->reg_y);
 			cycles += 7;
-			break;
+			NEXT;
 		/* lds */
-		case 0xce:
-			reg_s = pc_read16 ();
-			inst_tst16 (reg_s);
+		OP10 (ce)
+			cpu->reg_s = pc_read16 (cpu);
+			inst_tst16 (cpu, cpu->reg_s);
 			cycles += 4;
-			break;
-		case 0xde:
-			ea = ea_direct ();
-			reg_s = read16 (ea);
-			inst_tst16 (reg_s);
+			NEXT;
+		OP10 (de)
+			ea = ea_direct (cpu);
+			cpu->reg_s = read16 (cpu, ea);
+			inst_tst16 (cpu, cpu->reg_s);
 			cycles += 6;
-			break;
-		case 0xee:
-			ea = ea_indexed (&cycles);
-			reg_s = read16 (ea);
-			inst_tst16 (reg_s);
+			NEXT;
+		OP10 (ee)
+			ea = ea_indexed (cpu, &cycles);
+			cpu->reg_s = read16 (cpu, ea);
+			inst_tst16 (cpu, cpu->reg_s);
 			cycles += 6;
-			break;
-		case 0xfe:
-			ea = ea_extended ();
-			reg_s = read16 (ea);
-			inst_tst16 (reg_s);
+			NEXT;
+		OP10 (fe)
+			ea = ea_extended (cpu);
+			cpu->reg_s = read16 (cpu, ea);
+			inst_tst16 (cpu, cpu->reg_s);
 			cycles += 7;
-			break;
+			NEXT;
 		/* sts */
-		case 0xdf:
-			ea = ea_direct ();
-			write16 (ea, reg_s);
-			inst_tst16 (reg_s);
+		OP10 (df)
+			ea = ea_direct (cpu);
+			write16 (cpu, ea, cpu->reg_s);
+			inst_tst16 (cpu, cpu->reg_s);
 			cycles += 6;
-			break;
-		case 0xef:
-			ea = ea_indexed (&cycles);
-			write16 (ea, reg_s);
-			inst_tst16 (reg_s);
+			NEXT;
+		OP10 (ef)
+			ea = ea_indexed (cpu, &cycles);
+			write16 (cpu, ea, cpu->reg_s);
+			inst_tst16 (cpu, cpu->reg_s);
 			cycles += 6;
-			break;
-		case 0xff:
-			ea = ea_extended ();
-			write16 (ea, reg_s);
-			inst_tst16 (reg_s);
+			NEXT;
+		OP10 (ff)
+			ea = ea_extended (cpu);
+			write16 (cpu, ea, cpu->reg_s);
+			inst_tst16 (cpu, cpu->reg_s);
 			cycles += 7;
-			break;
+			NEXT;
 		/* swi2 */
-		case 0x3f:
-			set_cc (FLAG_E, 1);
-			inst_psh (0xff, &reg_s, reg_u, &cycles);
-		    reg_pc = read16 (0xfff4);
+		OP10 (3f)
+			set_cc (cpu, FLAG_E, 1);
+			inst_psh (cpu, 0xff, &cpu->reg_s, cpu->reg_u, &cycles);
+		    cpu->reg_pc = read16 (cpu, 0xfff4);
 			cycles += 8;
-			break;
-		default:
-			break;
+			NEXT;
+		OP10_NONE
+			NEXT;
 		}
 
-		break;
+		NEXT;
 
 	/* page 2 instructions */
 
-	case 0x11:
-		op = pc_read8 ();
+	OP (11)
+		op = pc_read8 (cpu);
 
-		switch (op) {
+		DISPATCH (page11, op) {
 		/* cmpu */
-		case 0x83:
-			inst_sub16 (reg_u, pc_read16 ());
+		OP11 (83)
+			inst_sub16 (cpu, cpu->reg_u, pc_read16 (cpu));
 			cycles += 5;
-			break;
-		case 0x93:
-			ea = ea_direct ();
-			inst_sub16 (reg_u, read16 (ea));
+			NEXT;
+		OP11 (93)
+			ea = ea_direct (cpu);
+			inst_sub16 (cpu, cpu->reg_u, read16 (cpu, ea));
 			cycles += 7;
-			break;
-		case 0xa3:
-			ea = ea_indexed (&cycles);
-			inst_sub16 (reg_u, read16 (ea));
+			NEXT;
+		OP11 (a3)
+			ea = ea_indexed (cpu, &cycles);
+			inst_sub16 (cpu, cpu->reg_u, read16 (cpu, ea));
 			cycles += 7;
-			break;
-		case 0xb3:
-			ea = ea_extended ();
-			inst_sub16 (reg_u, read16 (ea));
+			NEXT;
+		OP11 (b3)
+			ea = ea_extended (cpu);
+			inst_sub16 (cpu, cpu->reg_u, read16 (cpu, ea));
 			cycles += 8;
-			break;
+			NEXT;
 		/* cmps */
-		case 0x8c:
-			inst_sub16 (reg_s, pc_read16 ());
+		OP11 (8c)
+			inst_sub16 (cpu, cpu->reg_s, pc_read16 (cpu));
 			cycles += 5;
-			break;
-		case 0x9c:
-			ea = ea_direct ();
-			inst_sub16 (reg_s, read16 (ea));
+			NEXT;
+		OP11 (9c)
+			ea = ea_direct (cpu);
+			inst_sub16 (cpu, cpu->reg_s, read16 (cpu, ea));
 			cycles += 7;
-			break;
-		case 0xac:
-			ea = ea_indexed (&cycles);
-			inst_sub16 (reg_s, read16 (ea));
+			NEXT;
+		OP11 (ac)
+			ea = ea_indexed (cpu, &cycles);
+			inst_sub16 (cpu, cpu->reg_s, read16 (cpu, ea));
 			cycles += 7;
-			break;
-		case 0xbc:
-			ea = ea_extended ();
-			inst_sub16 (reg_s, read16 (ea));
+			NEXT;
+		OP11 (bc)
+			ea = ea_extended (cpu);
+			inst_sub16 (cpu, cpu->reg_s, read16 (cpu, ea));
 			cycles += 8;
-			break;
+			NEXT;
 		/* swi3 */
-		case 0x3f:
-			set_cc (FLAG_E, 1);
-			inst_psh (0xff, &reg_s, reg_u, &cycles);
-		    reg_pc = read16 (0xfff2);
+		OP11 (3f)
+			set_cc (cpu, FLAG_E, 1);
+			inst_psh (cpu, 0xff, &cpu->reg_s, cpu->reg_u, &cycles);
+		    cpu->reg_pc = read16 (cpu, 0xfff2);
 			cycles += 8;
-			break;
-		default:
-			break;
+			NEXT;
+		OP11_NONE
+			NEXT;
 		}
 
-		break;
+		NEXT;
 
-	default:
-		break;
+	OP_NONE
+		NEXT;
+	}
+
+next:
+	total += cycles;
+
+	if (sync != NULL) {
+		irq_i = (*sync) (cpu->user, cycles);
+
+		if (total < budget) {
+			cycles = 0;
+			goto step;
+		}
 	}
 
-	return cycles;
+	return total;
+}
+
+/* execute a single instruction or handle interrupts and return */
+
+unsigned e6809_sstep (e6809_t *cpu, unsigned irq_i, unsigned irq_f)
+{
+	return (unsigned) e6809_execute (cpu, irq_i, irq_f, 0, NULL);
+}
+
+/* execute instructions until the cycle budget is used up, keeping the rest
+ * of the system in step through sync. returns the number of cycles
+ * executed, which can overshoot the budget by part of an instruction.
+ * the firq line is not connected.
+ */
+
+long e6809_run (e6809_t *cpu, long cycles,
+				unsigned (*sync) (void *user, unsigned cycles))
+{
+	return e6809_execute (cpu, (*sync) (cpu->user, 0), 0, cycles, sync);
 }
 
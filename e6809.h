@@ -1,16 +1,77 @@
 #ifndef __E6809_H
 #define __E6809_H
 
-/* user defined read and write functions */
+/* state of one 6809. any number of them can be run side by side, each
+ * with its own memory through the read and write functions.
+ */
 
-extern unsigned char (*e6809_read8) (unsigned address);
-extern void (*e6809_write8) (unsigned address, unsigned char data);
+typedef struct e6809_type {
+	/* index registers */
 
-void e6809_reset(void);
-unsigned e6809_sstep(unsigned irq_i, unsigned irq_f);
+	unsigned reg_x;
+	unsigned reg_y;
+
+	/* user and hardware stack pointers */
+
+	unsigned reg_u;
+	unsigned reg_s;
+
+	/* program counter */
+
+	unsigned reg_pc;
+
+	/* accumulators */
+
+	unsigned reg_a;
+	unsigned reg_b;
+
+	/* direct page register */
+
+	unsigned reg_dp;
+
+	/* condition codes. n, z and h are evaluated lazily: instructions only
+	 * record the values the flags are derived from and the flags themselves
+	 * are produced when they are tested or the whole register is read
+	 * (push, tfr/exg). the n, z and h bits held in reg_cc
+	 * are stale, use get_cc ()/put_cc () to access the complete register.
+	 */
+
+	unsigned reg_cc;
+	unsigned cc_n; /* bit 7 is the n flag */
+	unsigned cc_z; /* zero when the z flag is set */
+	unsigned cc_h; /* bit 4 is the h flag */
+
+	/* flag to see if interrupts should be handled (sync/cwai). */
+
+	unsigned irq_status;
+
+	/* everything above is plain data and is saved as it is, so that a
+	 * state is a single copy. it only loads in the same build.
+	 */
+
+	/* user defined read and write functions, called with user */
+
+	void *user;
+	unsigned char (*read8) (void *user, unsigned address);
+	void (*write8) (void *user, unsigned address, unsigned char data);
+
+	/* optional map of 256 byte pages that instructions can be fetched from
+	 * directly, indexed by address >> 8. pages with a NULL entry, and all
+	 * pages if the map itself is NULL, are read through read8. the
+	 * entries are looked up on every fetch, so the map can be changed at
+	 * any time, e.g. when a bank is switched.
+	 */
+
+	unsigned char **fetch_map;
+} e6809_t;
+
+void e6809_reset(e6809_t *cpu);
+unsigned e6809_sstep(e6809_t *cpu, unsigned irq_i, unsigned irq_f);
+long e6809_run(e6809_t *cpu, long cycles,
+		unsigned (*sync)(void *user, unsigned cycles));
 
 int e6809_statesz(void);
-void e6809_serialize(char* ary);
-void e6809_deserialize(char * ary);
+void e6809_serialize(e6809_t *cpu, char* ary);
+void e6809_deserialize(e6809_t *cpu, char * ary);
 
 #endif
@@ -1,10 +1,23 @@
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
 
 #include "e8910.h"
 
-#define SOUND_FREQ   22050
-#define SOUND_SAMPLE  1024
+#define STEP_FREQ    88200   /* rate the generators are stepped at */
+#define CPU_FREQ     1500000 /* register writes are stamped in cpu cycles */
+
+/* the stepped output is resampled to the output rate with band-limited
+ * steps: every change of level adds a windowed sinc impulse at its exact
+ * position in the output, and the output is the running sum.
+ */
+#define BLIP_BITS    15
+#define BLIP_CUTOFF  0.45    /* of the output rate */
 
 /***************************************************************************
 
@@ -25,100 +38,28 @@
 #define STEP2 length
 #define STEP  2
 
-extern unsigned snd_regs[16];
-
-struct AY8910 {
-	int index;
-	int ready;
-	int lastEnable;
-	int PeriodA,PeriodB,PeriodC,PeriodN,PeriodE;
-	int CountA,CountB,CountC,CountN,CountE;
-	int RNG;
-	unsigned VolA,VolB,VolC,VolE;
-	char CountEnv;
-	unsigned char EnvelopeA,EnvelopeB,EnvelopeC;
-	unsigned char OutputA,OutputB,OutputC,OutputN;
-	unsigned char Hold,Alternate,Attack,Holding;
-	unsigned VolTable[32];
-} PSG;
+/* bits of each register that exist on the chip */
+static const unsigned char RegMask[16] = {
+	0xff, 0x0f, 0xff, 0x0f, 0xff, 0x0f, 0x1f, 0xff,
+	0x1f, 0x1f, 0x1f, 0xff, 0xff, 0x0f, 0xff, 0xff
+};
+
+/* the state is everything in front of Queue, see e8910.h */
 
 int e8910_statesz(void)
 {
-	return sizeof(unsigned) * (16 + 32 + 4) + sizeof(int) * 14 + 12;
+	return offsetof(e8910_t, Queue);
 }
 
-void e8910_serialize(char* dst)
+void e8910_serialize(e8910_t *psg, char* dst)
 {
-	memcpy(dst, &PSG.VolTable, sizeof(PSG.VolTable)); dst += sizeof(PSG.VolTable);
-	memcpy(dst, snd_regs, sizeof(snd_regs)); dst += sizeof(snd_regs);
-	memcpy(dst, &PSG.index, sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &PSG.ready, sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &PSG.PeriodA, sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &PSG.PeriodB, sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &PSG.PeriodC, sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &PSG.PeriodN, sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &PSG.PeriodE, sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &PSG.lastEnable, sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &PSG.CountA, sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &PSG.CountB, sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &PSG.CountC, sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &PSG.CountN, sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &PSG.CountE, sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &PSG.RNG, sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &PSG.VolA, sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &PSG.VolB, sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &PSG.VolC, sizeof(int)); dst += sizeof(int);
-	memcpy(dst, &PSG.VolE, sizeof(int)); dst += sizeof(int);
-
-	*dst++ = PSG.CountEnv;
-	*dst++ = PSG.EnvelopeA;
-	*dst++ = PSG.EnvelopeB;
-	*dst++ = PSG.EnvelopeC;
-	*dst++ = PSG.OutputA;
-	*dst++ = PSG.OutputB;
-	*dst++ = PSG.OutputC;
-	*dst++ = PSG.OutputN;
-	*dst++ = PSG.Hold;
-	*dst++ = PSG.Alternate;
-	*dst++ = PSG.Attack;
-	*dst++ = PSG.Holding;
+	memcpy(dst, psg, offsetof(e8910_t, Queue));
 }
 
-void e8910_deserialize ( char* dst )
+void e8910_deserialize (e8910_t *psg, char* dst )
 {
-	memcpy(&PSG.VolTable, dst, sizeof(PSG.VolTable)); dst += sizeof(PSG.VolTable);
-	memcpy(snd_regs, dst, sizeof(snd_regs)); dst += sizeof(snd_regs);
-	memcpy(&PSG.index, dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&PSG.ready, dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&PSG.PeriodA, dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&PSG.PeriodB, dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&PSG.PeriodC, dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&PSG.PeriodN, dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&PSG.PeriodE, dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&PSG.lastEnable, dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&PSG.CountA, dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&PSG.CountB, dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&PSG.CountC, dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&PSG.CountN, dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&PSG.CountE, dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&PSG.RNG, dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&PSG.VolA, dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&PSG.VolB, dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&PSG.VolC, dst, sizeof(int)); dst += sizeof(int);
-	memcpy(&PSG.VolE, dst, sizeof(int)); dst += sizeof(int);
-
-	PSG.CountEnv = *dst++;
-	PSG.EnvelopeA = *dst++;
-	PSG.EnvelopeB = *dst++;
-	PSG.EnvelopeC = *dst++;
-	PSG.OutputA = *dst++;
-	PSG.OutputB = *dst++;
-	PSG.OutputC = *dst++;
-	PSG.OutputN = *dst++;
-	PSG.Hold = *dst++;
-	PSG.Alternate = *dst++;
-	PSG.Attack = *dst++;
-	PSG.Holding = *dst;
+	memcpy(psg, dst, offsetof(e8910_t, Queue));
+	psg->Queued = 0;
 }
 
 /* register id's */
@@ -140,11 +81,11 @@ void e8910_deserialize ( char* dst )
 #define AY_PORTA	(14)
 #define AY_PORTB	(15)
 
-void e8910_write(int r, int v)
+static void psg_write(e8910_t *psg, int r, int v)
 {
     int old;
 
-    snd_regs[r] = v;
+    psg->Regs[r] = v;
 
 	/* A note about the period of tones, noise and envelope: for speed reasons,*/
 	/* we count down from the period to 0, but careful studies of the chip     */
@@ -160,65 +101,65 @@ void e8910_write(int r, int v)
 	{
 	case AY_AFINE:
 	case AY_ACOARSE:
-		snd_regs[AY_ACOARSE] &= 0x0f;
-		old = PSG.PeriodA;
-		PSG.PeriodA = (snd_regs[AY_AFINE] + 256 * snd_regs[AY_ACOARSE]) * STEP3;
-		if (PSG.PeriodA == 0) PSG.PeriodA = STEP3;
-		PSG.CountA += PSG.PeriodA - old;
-		if (PSG.CountA <= 0) PSG.CountA = 1;
+		psg->Regs[AY_ACOARSE] &= 0x0f;
+		old = psg->PeriodA;
+		psg->PeriodA = (psg->Regs[AY_AFINE] + 256 * psg->Regs[AY_ACOARSE]) * STEP3;
+		if (psg->PeriodA == 0) psg->PeriodA = STEP3;
+		psg->CountA += psg->PeriodA - old;
+		if (psg->CountA <= 0) psg->CountA = 1;
 		break;
 	case AY_BFINE:
 	case AY_BCOARSE:
-		snd_regs[AY_BCOARSE] &= 0x0f;
-		old = PSG.PeriodB;
-		PSG.PeriodB = (snd_regs[AY_BFINE] + 256 * snd_regs[AY_BCOARSE]) * STEP3;
-		if (PSG.PeriodB == 0) PSG.PeriodB = STEP3;
-		PSG.CountB += PSG.PeriodB - old;
-		if (PSG.CountB <= 0) PSG.CountB = 1;
+		psg->Regs[AY_BCOARSE] &= 0x0f;
+		old = psg->PeriodB;
+		psg->PeriodB = (psg->Regs[AY_BFINE] + 256 * psg->Regs[AY_BCOARSE]) * STEP3;
+		if (psg->PeriodB == 0) psg->PeriodB = STEP3;
+		psg->CountB += psg->PeriodB - old;
+		if (psg->CountB <= 0) psg->CountB = 1;
 		break;
 	case AY_CFINE:
 	case AY_CCOARSE:
-		snd_regs[AY_CCOARSE] &= 0x0f;
-		old = PSG.PeriodC;
-		PSG.PeriodC = (snd_regs[AY_CFINE] + 256 * snd_regs[AY_CCOARSE]) * STEP3;
-		if (PSG.PeriodC == 0) PSG.PeriodC = STEP3;
-		PSG.CountC += PSG.PeriodC - old;
-		if (PSG.CountC <= 0) PSG.CountC = 1;
+		psg->Regs[AY_CCOARSE] &= 0x0f;
+		old = psg->PeriodC;
+		psg->PeriodC = (psg->Regs[AY_CFINE] + 256 * psg->Regs[AY_CCOARSE]) * STEP3;
+		if (psg->PeriodC == 0) psg->PeriodC = STEP3;
+		psg->CountC += psg->PeriodC - old;
+		if (psg->CountC <= 0) psg->CountC = 1;
 		break;
 	case AY_NOISEPER:
-		snd_regs[AY_NOISEPER] &= 0x1f;
-		old = PSG.PeriodN;
-		PSG.PeriodN = snd_regs[AY_NOISEPER] * STEP3;
-		if (PSG.PeriodN == 0) PSG.PeriodN = STEP3;
-		PSG.CountN += PSG.PeriodN - old;
-		if (PSG.CountN <= 0) PSG.CountN = 1;
+		psg->Regs[AY_NOISEPER] &= 0x1f;
+		old = psg->PeriodN;
+		psg->PeriodN = psg->Regs[AY_NOISEPER] * STEP3;
+		if (psg->PeriodN == 0) psg->PeriodN = STEP3;
+		psg->CountN += psg->PeriodN - old;
+		if (psg->CountN <= 0) psg->CountN = 1;
 		break;
 	case AY_ENABLE:
-		PSG.lastEnable = snd_regs[AY_ENABLE];
+		psg->lastEnable = psg->Regs[AY_ENABLE];
 		break;
 	case AY_AVOL:
-		snd_regs[AY_AVOL] &= 0x1f;
-		PSG.EnvelopeA = snd_regs[AY_AVOL] & 0x10;
-		PSG.VolA = PSG.EnvelopeA ? PSG.VolE : PSG.VolTable[snd_regs[AY_AVOL] ? snd_regs[AY_AVOL]*2+1 : 0];
+		psg->Regs[AY_AVOL] &= 0x1f;
+		psg->EnvelopeA = psg->Regs[AY_AVOL] & 0x10;
+		psg->VolA = psg->EnvelopeA ? psg->VolE : psg->VolTable[psg->Regs[AY_AVOL] ? psg->Regs[AY_AVOL]*2+1 : 0];
 		break;
 	case AY_BVOL:
-		snd_regs[AY_BVOL] &= 0x1f;
-		PSG.EnvelopeB = snd_regs[AY_BVOL] & 0x10;
-		PSG.VolB = PSG.EnvelopeB ? PSG.VolE : PSG.VolTable[snd_regs[AY_BVOL] ? snd_regs[AY_BVOL]*2+1 : 0];
+		psg->Regs[AY_BVOL] &= 0x1f;
+		psg->EnvelopeB = psg->Regs[AY_BVOL] & 0x10;
+		psg->VolB = psg->EnvelopeB ? psg->VolE : psg->VolTable[psg->Regs[AY_BVOL] ? psg->Regs[AY_BVOL]*2+1 : 0];
 		break;
 	case AY_CVOL:
-		snd_regs[AY_CVOL] &= 0x1f;
-		PSG.EnvelopeC = snd_regs[AY_CVOL] & 0x10;
-		PSG.VolC = PSG.EnvelopeC ? PSG.VolE : PSG.VolTable[snd_regs[AY_CVOL] ? snd_regs[AY_CVOL]*2+1 : 0];
+		psg->Regs[AY_CVOL] &= 0x1f;
+		psg->EnvelopeC = psg->Regs[AY_CVOL] & 0x10;
+		psg->VolC = psg->EnvelopeC ? psg->VolE : psg->VolTable[psg->Regs[AY_CVOL] ? psg->Regs[AY_CVOL]*2+1 : 0];
 		break;
 	case AY_EFINE:
 	case AY_ECOARSE:
-		old = PSG.PeriodE;
-		PSG.PeriodE = ((snd_regs[AY_EFINE] + 256 * snd_regs[AY_ECOARSE])) * STEP3;
-		//if (PSG.PeriodE == 0) PSG.PeriodE = STEP3 / 2;
-		if (PSG.PeriodE == 0) PSG.PeriodE = STEP3;
-		PSG.CountE += PSG.PeriodE - old;
-		if (PSG.CountE <= 0) PSG.CountE = 1;
+		old = psg->PeriodE;
+		psg->PeriodE = ((psg->Regs[AY_EFINE] + 256 * psg->Regs[AY_ECOARSE])) * STEP3;
+		//if (psg->PeriodE == 0) psg->PeriodE = STEP3 / 2;
+		if (psg->PeriodE == 0) psg->PeriodE = STEP3;
+		psg->CountE += psg->PeriodE - old;
+		if (psg->CountE <= 0) psg->CountE = 1;
 		break;
 	case AY_ESHAPE:
 		/* envelope shapes:
@@ -247,26 +188,26 @@ void e8910_write(int r, int v)
         has twice the steps, happening twice as fast. Since the end result is
         just a smoother curve, we always use the YM2149 behaviour.
         */
-		snd_regs[AY_ESHAPE] &= 0x0f;
-		PSG.Attack = (snd_regs[AY_ESHAPE] & 0x04) ? 0x1f : 0x00;
-		if ((snd_regs[AY_ESHAPE] & 0x08) == 0)
+		psg->Regs[AY_ESHAPE] &= 0x0f;
+		psg->Attack = (psg->Regs[AY_ESHAPE] & 0x04) ? 0x1f : 0x00;
+		if ((psg->Regs[AY_ESHAPE] & 0x08) == 0)
 		{
 			/* if Continue = 0, map the shape to the equivalent one which has Continue = 1 */
-			PSG.Hold = 1;
-			PSG.Alternate = PSG.Attack;
+			psg->Hold = 1;
+			psg->Alternate = psg->Attack;
 		}
 		else
 		{
-			PSG.Hold = snd_regs[AY_ESHAPE] & 0x01;
-			PSG.Alternate = snd_regs[AY_ESHAPE] & 0x02;
+			psg->Hold = psg->Regs[AY_ESHAPE] & 0x01;
+			psg->Alternate = psg->Regs[AY_ESHAPE] & 0x02;
 		}
-		PSG.CountE = PSG.PeriodE;
-		PSG.CountEnv = 0x1f;
-		PSG.Holding = 0;
-		PSG.VolE = PSG.VolTable[PSG.CountEnv ^ PSG.Attack];
-		if (PSG.EnvelopeA) PSG.VolA = PSG.VolE;
-		if (PSG.EnvelopeB) PSG.VolB = PSG.VolE;
-		if (PSG.EnvelopeC) PSG.VolC = PSG.VolE;
+		psg->CountE = psg->PeriodE;
+		psg->CountEnv = 0x1f;
+		psg->Holding = 0;
+		psg->VolE = psg->VolTable[psg->CountEnv ^ psg->Attack];
+		if (psg->EnvelopeA) psg->VolA = psg->VolE;
+		if (psg->EnvelopeB) psg->VolB = psg->VolE;
+		if (psg->EnvelopeC) psg->VolC = psg->VolE;
 		break;
 	case AY_PORTA:
 		break;
@@ -275,22 +216,58 @@ void e8910_write(int r, int v)
 	}
 }
 
-void
-e8910_callback(void *userdata, uint8_t *stream, int length)
+void e8910_write(e8910_t *psg, int r, int v)
 {
-	int outn;
-	uint8_t* buf1 = stream;
+	psg_write(psg, r, v);
+	psg->snd_regs[r] = psg->Regs[r];
+}
 
-	(void) userdata;
+void e8910_write_at(e8910_t *psg, unsigned cycle, int r, int v)
+{
+	int i;
 
-	/* hack to prevent us from hanging when starting filtered outputs */
-	if (!PSG.ready)
+	psg->snd_regs[r] = v & RegMask[r];
+
+	if (psg->Queued == E8910_QUEUE_SIZE)
 	{
-		memset(stream, 0, length * sizeof(*stream));
-		return;
+		/* out of room, keep the order but lose the timing */
+		for (i = 0; i < psg->Queued; i++)
+			psg_write(psg, psg->Queue[i].r, psg->Queue[i].v);
+		psg->Queued = 0;
 	}
 
-  length = length * 2;
+	psg->Queue[psg->Queued].cycle = cycle;
+	psg->Queue[psg->Queued].r = r;
+	psg->Queue[psg->Queued].v = v;
+	psg->Queued++;
+}
+
+/* add a change to the level at the given step of the frame */
+
+static void blip_level(e8910_t *psg, int step, int level)
+{
+	int delta = level - psg->BlipLevel;
+	int t, i, *buf;
+	const int *kernel;
+
+	if (delta == 0)
+		return;
+
+	psg->BlipLevel = level;
+
+	t = step * psg->BlipSamples;
+	buf = psg->BlipBuf + t / psg->BlipSteps;
+	kernel = psg->BlipKernel[(t % psg->BlipSteps) * E8910_BLIP_PHASES /
+		psg->BlipSteps];
+
+	for (i = 0; i < E8910_BLIP_TAPS; i++)
+		buf[i] += delta * kernel[i];
+}
+
+static void
+psg_render(e8910_t *psg, int pos, int length)
+{
+	int outn;
 
 	/* The 8910 has three outputs, each output is the mix of one of the three */
 	/* tone generators and of the (single) noise generator. The two are mixed */
@@ -305,43 +282,43 @@ e8910_callback(void *userdata, uint8_t *stream, int length)
 	/* Setting the output to 1 is necessary because a disabled channel is locked */
 	/* into the ON state (see above); and it has no effect if the volume is 0. */
 	/* If the volume is 0, increase the counter, but don't touch the output. */
-	if (snd_regs[AY_ENABLE] & 0x01)
+	if (psg->Regs[AY_ENABLE] & 0x01)
 	{
-		if (PSG.CountA <= STEP2) PSG.CountA += STEP2;
-		PSG.OutputA = 1;
+		if (psg->CountA <= STEP2) psg->CountA += STEP2;
+		psg->OutputA = 1;
 	}
-	else if (snd_regs[AY_AVOL] == 0)
+	else if (psg->Regs[AY_AVOL] == 0)
 	{
 		/* note that I do count += length, NOT count = length + 1. You might think */
 		/* it's the same since the volume is 0, but doing the latter could cause */
 		/* interferencies when the program is rapidly modulating the volume. */
-		if (PSG.CountA <= STEP2) PSG.CountA += STEP2;
+		if (psg->CountA <= STEP2) psg->CountA += STEP2;
 	}
-	if (snd_regs[AY_ENABLE] & 0x02)
+	if (psg->Regs[AY_ENABLE] & 0x02)
 	{
-		if (PSG.CountB <= STEP2) PSG.CountB += STEP2;
-		PSG.OutputB = 1;
+		if (psg->CountB <= STEP2) psg->CountB += STEP2;
+		psg->OutputB = 1;
 	}
-	else if (snd_regs[AY_BVOL] == 0)
+	else if (psg->Regs[AY_BVOL] == 0)
 	{
-		if (PSG.CountB <= STEP2) PSG.CountB += STEP2;
+		if (psg->CountB <= STEP2) psg->CountB += STEP2;
 	}
-	if (snd_regs[AY_ENABLE] & 0x04)
+	if (psg->Regs[AY_ENABLE] & 0x04)
 	{
-		if (PSG.CountC <= STEP2) PSG.CountC += STEP2;
-		PSG.OutputC = 1;
+		if (psg->CountC <= STEP2) psg->CountC += STEP2;
+		psg->OutputC = 1;
 	}
-	else if (snd_regs[AY_CVOL] == 0)
+	else if (psg->Regs[AY_CVOL] == 0)
 	{
-		if (PSG.CountC <= STEP2) PSG.CountC += STEP2;
+		if (psg->CountC <= STEP2) psg->CountC += STEP2;
 	}
 
 	/* for the noise channel we must not touch OutputN - it's also not necessary */
 	/* since we use outn. */
-	if ((snd_regs[AY_ENABLE] & 0x38) == 0x38)	/* all off */
-		if (PSG.CountN <= STEP2) PSG.CountN += STEP2;
+	if ((psg->Regs[AY_ENABLE] & 0x38) == 0x38)	/* all off */
+		if (psg->CountN <= STEP2) psg->CountN += STEP2;
 
-	outn = (PSG.OutputN | snd_regs[AY_ENABLE]);
+	outn = (psg->OutputN | psg->Regs[AY_ENABLE]);
 
 	/* buffering loop */
 	while (length > 0)
@@ -352,19 +329,50 @@ e8910_callback(void *userdata, uint8_t *stream, int length)
 		/* in the 1 position during the sample period. */
 
 		int vola,volb,volc;
+		int run;
+
+		/* No counter reaches its edge for run steps, so the outputs stay */
+		/* put and every one of those steps mixes to the same value. Do */
+		/* them in bulk. */
+		run = (psg->CountA - 1) >> 1;
+		if ((psg->CountB - 1) >> 1 < run) run = (psg->CountB - 1) >> 1;
+		if ((psg->CountC - 1) >> 1 < run) run = (psg->CountC - 1) >> 1;
+		if ((psg->CountN - 1) >> 1 < run) run = (psg->CountN - 1) >> 1;
+		if (psg->Holding == 0 && (psg->CountE - 1) >> 1 < run) run = (psg->CountE - 1) >> 1;
+		if (run > length) run = length;
+
+		if (run > 1)
+		{
+			vola = (outn & 0x08) && psg->OutputA ? STEP : 0;
+			volb = (outn & 0x10) && psg->OutputB ? STEP : 0;
+			volc = (outn & 0x20) && psg->OutputC ? STEP : 0;
+			vol = (vola * psg->VolA + volb * psg->VolB + volc * psg->VolC) / (3 * STEP);
+			blip_level(psg, pos, vol);
+
+			psg->CountA -= run * STEP;
+			psg->CountB -= run * STEP;
+			psg->CountC -= run * STEP;
+			psg->CountN -= run * STEP;
+			if (psg->Holding == 0) psg->CountE -= run * STEP;
+
+			pos += run;
+			length -= run;
+			continue;
+		}
+
 		vola = volb = volc = 0;
 
 		do
 		{
 			int nextevent;
 
-			if (PSG.CountN < left) nextevent = PSG.CountN;
+			if (psg->CountN < left) nextevent = psg->CountN;
 			else nextevent = left;
 
 			if (outn & 0x08)
 			{
-				if (PSG.OutputA) vola += PSG.CountA;
-				PSG.CountA -= nextevent;
+				if (psg->OutputA) vola += psg->CountA;
+				psg->CountA -= nextevent;
 				/* PeriodA is the half period of the square wave. Here, in each */
 				/* loop I add PeriodA twice, so that at the end of the loop the */
 				/* square wave is in the same status (0 or 1) it was at the start. */
@@ -373,109 +381,109 @@ e8910_callback(void *userdata, uint8_t *stream, int length)
 				/* If we exit the loop in the middle, OutputA has to be inverted */
 				/* and vola incremented only if the exit status of the square */
 				/* wave is 1. */
-				while (PSG.CountA <= 0)
+				while (psg->CountA <= 0)
 				{
-					PSG.CountA += PSG.PeriodA;
-					if (PSG.CountA > 0)
+					psg->CountA += psg->PeriodA;
+					if (psg->CountA > 0)
 					{
-						PSG.OutputA ^= 1;
-						if (PSG.OutputA) vola += PSG.PeriodA;
+						psg->OutputA ^= 1;
+						if (psg->OutputA) vola += psg->PeriodA;
 						break;
 					}
-					PSG.CountA += PSG.PeriodA;
-					vola += PSG.PeriodA;
+					psg->CountA += psg->PeriodA;
+					vola += psg->PeriodA;
 				}
-				if (PSG.OutputA) vola -= PSG.CountA;
+				if (psg->OutputA) vola -= psg->CountA;
 			}
 			else
 			{
-				PSG.CountA -= nextevent;
-				while (PSG.CountA <= 0)
+				psg->CountA -= nextevent;
+				while (psg->CountA <= 0)
 				{
-					PSG.CountA += PSG.PeriodA;
-					if (PSG.CountA > 0)
+					psg->CountA += psg->PeriodA;
+					if (psg->CountA > 0)
 					{
-						PSG.OutputA ^= 1;
+						psg->OutputA ^= 1;
 						break;
 					}
-					PSG.CountA += PSG.PeriodA;
+					psg->CountA += psg->PeriodA;
 				}
 			}
 
 			if (outn & 0x10)
 			{
-				if (PSG.OutputB) volb += PSG.CountB;
-				PSG.CountB -= nextevent;
-				while (PSG.CountB <= 0)
+				if (psg->OutputB) volb += psg->CountB;
+				psg->CountB -= nextevent;
+				while (psg->CountB <= 0)
 				{
-					PSG.CountB += PSG.PeriodB;
-					if (PSG.CountB > 0)
+					psg->CountB += psg->PeriodB;
+					if (psg->CountB > 0)
 					{
-						PSG.OutputB ^= 1;
-						if (PSG.OutputB) volb += PSG.PeriodB;
+						psg->OutputB ^= 1;
+						if (psg->OutputB) volb += psg->PeriodB;
 						break;
 					}
-					PSG.CountB += PSG.PeriodB;
-					volb += PSG.PeriodB;
+					psg->CountB += psg->PeriodB;
+					volb += psg->PeriodB;
 				}
-				if (PSG.OutputB) volb -= PSG.CountB;
+				if (psg->OutputB) volb -= psg->CountB;
 			}
 			else
 			{
-				PSG.CountB -= nextevent;
-				while (PSG.CountB <= 0)
+				psg->CountB -= nextevent;
+				while (psg->CountB <= 0)
 				{
-					PSG.CountB += PSG.PeriodB;
-					if (PSG.CountB > 0)
+					psg->CountB += psg->PeriodB;
+					if (psg->CountB > 0)
 					{
-						PSG.OutputB ^= 1;
+						psg->OutputB ^= 1;
 						break;
 					}
-					PSG.CountB += PSG.PeriodB;
+					psg->CountB += psg->PeriodB;
 				}
 			}
 
 			if (outn & 0x20)
 			{
-				if (PSG.OutputC) volc += PSG.CountC;
-				PSG.CountC -= nextevent;
-				while (PSG.CountC <= 0)
+				if (psg->OutputC) volc += psg->CountC;
+				psg->CountC -= nextevent;
+				while (psg->CountC <= 0)
 				{
-					PSG.CountC += PSG.PeriodC;
-					if (PSG.CountC > 0)
+					psg->CountC += psg->PeriodC;
+					if (psg->CountC > 0)
 					{
-						PSG.OutputC ^= 1;
-						if (PSG.OutputC) volc += PSG.PeriodC;
+						psg->OutputC ^= 1;
+						if (psg->OutputC) volc += psg->PeriodC;
 						break;
 					}
-					PSG.CountC += PSG.PeriodC;
-					volc += PSG.PeriodC;
+					psg->CountC += psg->PeriodC;
+					volc += psg->PeriodC;
 				}
-				if (PSG.OutputC) volc -= PSG.CountC;
+				if (psg->OutputC) volc -= psg->CountC;
 			}
 			else
 			{
-				PSG.CountC -= nextevent;
-				while (PSG.CountC <= 0)
+				psg->CountC -= nextevent;
+				while (psg->CountC <= 0)
 				{
-					PSG.CountC += PSG.PeriodC;
-					if (PSG.CountC > 0)
+					psg->CountC += psg->PeriodC;
+					if (psg->CountC > 0)
 					{
-						PSG.OutputC ^= 1;
+						psg->OutputC ^= 1;
 						break;
 					}
-					PSG.CountC += PSG.PeriodC;
+					psg->CountC += psg->PeriodC;
 				}
 			}
 
-			PSG.CountN -= nextevent;
-			if (PSG.CountN <= 0)
+			psg->CountN -= nextevent;
+			if (psg->CountN <= 0)
 			{
 				/* Is noise output going to change? */
-				if ((PSG.RNG + 1) & 2)	/* (bit0^bit1)? */
+				if ((psg->RNG + 1) & 2)	/* (bit0^bit1)? */
 				{
-					PSG.OutputN = ~PSG.OutputN;
-					outn = (PSG.OutputN | snd_regs[AY_ENABLE]);
+					psg->OutputN = ~psg->OutputN;
+					outn = (psg->OutputN | psg->Regs[AY_ENABLE]);
 				}
 
 				/* The Random Number Generator of the 8910 is a 17-bit shift */
@@ -487,62 +495,134 @@ e8910_callback(void *userdata, uint8_t *stream, int length)
 				/* bit0, relying on the fact that after three shifts of the */
 				/* register, what now is bit3 will become bit0, and will */
 				/* invert, if necessary, bit14, which previously was bit17. */
-				if (PSG.RNG & 1) PSG.RNG ^= 0x24000; /* This version is called the "Galois configuration". */
-				PSG.RNG >>= 1;
-				PSG.CountN += PSG.PeriodN;
+				if (psg->RNG & 1) psg->RNG ^= 0x24000; /* This version is called the "Galois configuration". */
+				psg->RNG >>= 1;
+				psg->CountN += psg->PeriodN;
 			}
 
 			left -= nextevent;
 		} while (left > 0);
 
 		/* update envelope */
-		if (PSG.Holding == 0)
+		if (psg->Holding == 0)
 		{
-			PSG.CountE -= STEP;
-			if (PSG.CountE <= 0)
+			psg->CountE -= STEP;
+			if (psg->CountE <= 0)
 			{
 				do
 				{
-					PSG.CountEnv--;
-					PSG.CountE += PSG.PeriodE;
-				} while (PSG.CountE <= 0);
+					psg->CountEnv--;
+					psg->CountE += psg->PeriodE;
+				} while (psg->CountE <= 0);
 
 				/* check envelope current position */
-				if (PSG.CountEnv < 0)
+				if (psg->CountEnv < 0)
 				{
-					if (PSG.Hold)
+					if (psg->Hold)
 					{
-						if (PSG.Alternate)
-							PSG.Attack ^= 0x1f;
-						PSG.Holding = 1;
-						PSG.CountEnv = 0;
+						if (psg->Alternate)
+							psg->Attack ^= 0x1f;
+						psg->Holding = 1;
+						psg->CountEnv = 0;
 					}
 					else
 					{
 						/* if CountEnv has looped an odd number of times (usually 1), */
 						/* invert the output. */
-						if (PSG.Alternate && (PSG.CountEnv & 0x20))
- 							PSG.Attack ^= 0x1f;
+						if (psg->Alternate && (psg->CountEnv & 0x20))
+ 							psg->Attack ^= 0x1f;
 
-						PSG.CountEnv &= 0x1f;
+						psg->CountEnv &= 0x1f;
 					}
 				}
 
-				PSG.VolE = PSG.VolTable[PSG.CountEnv ^ PSG.Attack];
+				psg->VolE = psg->VolTable[psg->CountEnv ^ psg->Attack];
 				/* reload volume */
-				if (PSG.EnvelopeA) PSG.VolA = PSG.VolE;
-				if (PSG.EnvelopeB) PSG.VolB = PSG.VolE;
-				if (PSG.EnvelopeC) PSG.VolC = PSG.VolE;
+				if (psg->EnvelopeA) psg->VolA = psg->VolE;
+				if (psg->EnvelopeB) psg->VolB = psg->VolE;
+				if (psg->EnvelopeC) psg->VolC = psg->VolE;
 			}
 		}
 
-    vol = (vola * PSG.VolA + volb * PSG.VolB + volc * PSG.VolC) / (3 * STEP);
-    if (--length & 1) *(buf1++) = vol >> 8;
+    vol = (vola * psg->VolA + volb * psg->VolB + volc * psg->VolC) / (3 * STEP);
+    blip_level(psg, pos++, vol);
+    length--;
+	}
+}
+
+/* integrate the steps into output samples */
+
+static void blip_read(e8910_t *psg, int16_t *stream, int length)
+{
+	int i;
+
+	for (i = 0; i < length; i++)
+	{
+		psg->BlipSum += psg->BlipBuf[i];
+
+		/* centre the 12-bit mix around zero */
+		stream[0] = stream[1] = (int16_t)(((psg->BlipSum + (1 << (BLIP_BITS - 1))) >> BLIP_BITS) - 0x7ff);
+		stream += 2;
+	}
+
+	/* keep the tails of steps that reach into the next frame */
+	memmove(psg->BlipBuf, psg->BlipBuf + length, E8910_BLIP_TAPS * sizeof(*psg->BlipBuf));
+	memset(psg->BlipBuf + E8910_BLIP_TAPS, 0, length * sizeof(*psg->BlipBuf));
+}
+
+
+/* render the frame in pieces, applying each queued write at the step
+ * it falls on.
+ */
+void
+e8910_callback(e8910_t *psg, int16_t *stream, int length)
+{
+	int i, pos = 0;
+
+	if (length <= 0)
+		return;
+
+	/* hack to prevent us from hanging when starting filtered outputs */
+	if (!psg->ready || length > E8910_MAX_SAMPLES)
+	{
+		memset(stream, 0, length * 2 * sizeof(*stream));
+		psg->Queued = 0;
+		return;
+	}
+
+	psg->BlipSamples = length;
+	psg->BlipSteps = (int)((long)length * STEP_FREQ / psg->Rate);
+
+	for (i = 0; i < psg->Queued; i++)
+	{
+		int at = (int)(psg->Queue[i].cycle * (STEP_FREQ / 100) / (CPU_FREQ / 100));
+
+		if (at > psg->BlipSteps)
+			at = psg->BlipSteps;
+
+		if (at > pos)
+		{
+			psg_render(psg, pos, at - pos);
+			pos = at;
+		}
+
+		psg_write(psg, psg->Queue[i].r, psg->Queue[i].v);
 	}
+
+	psg->Queued = 0;
+
+	if (pos < psg->BlipSteps)
+		psg_render(psg, pos, psg->BlipSteps - pos);
+
+	blip_read(psg, stream, length);
 }
 
+void e8910_set_rate(e8910_t *psg, unsigned rate)
+{
+	psg->Rate = rate;
+}
 
-static void e8910_build_mixer_table(void)
+static void e8910_build_mixer_table(e8910_t *psg)
 {
 	int i;
 	double out;
@@ -554,23 +634,69 @@ static void e8910_build_mixer_table(void)
 	out = MAX_OUTPUT;
 	for (i = 31;i > 0;i--)
 	{
-		PSG.VolTable[i] = (unsigned)(out + 0.5);	/* round to nearest */
+		psg->VolTable[i] = (unsigned)(out + 0.5);	/* round to nearest */
 		out /= 1.188502227;	/* = 10 ^ (1.5/20) = 1.5dB */
 	}
-	PSG.VolTable[0] = 0;
+	psg->VolTable[0] = 0;
+}
+
+static void e8910_build_blip_kernel(e8910_t *psg)
+{
+	int p, i;
+
+	for (p = 0; p < E8910_BLIP_PHASES; p++)
+	{
+		double sum = 0, taps[E8910_BLIP_TAPS];
+		int total = 0, peak = 0;
+
+		/* impulse centred between the middle taps, delayed by the phase */
+		for (i = 0; i < E8910_BLIP_TAPS; i++)
+		{
+			double x = i - (E8910_BLIP_TAPS / 2 - 1) - (double)p / E8910_BLIP_PHASES;
+			double w = 0.42 + 0.5 * cos(M_PI * x / (E8910_BLIP_TAPS / 2)) +
+				0.08 * cos(2 * M_PI * x / (E8910_BLIP_TAPS / 2));
+			double arg = M_PI * 2 * BLIP_CUTOFF * x;
+
+			if (x <= -E8910_BLIP_TAPS / 2 || x >= E8910_BLIP_TAPS / 2)
+				w = 0;
+
+			taps[i] = w * (arg == 0 ? 1 : sin(arg) / arg);
+			sum += taps[i];
+		}
+
+		/* every phase must add up to exactly one step */
+		for (i = 0; i < E8910_BLIP_TAPS; i++)
+		{
+			psg->BlipKernel[p][i] = (int)floor(taps[i] / sum * (1 << BLIP_BITS) + 0.5);
+			total += psg->BlipKernel[p][i];
+			if (psg->BlipKernel[p][i] > psg->BlipKernel[p][peak])
+				peak = i;
+		}
+
+		psg->BlipKernel[p][peak] += (1 << BLIP_BITS) - total;
+	}
 }
 
-void e8910_init_sound(void)
+void e8910_init_sound(e8910_t *psg)
 {
-	PSG.RNG     = 1;
-	PSG.OutputA = 0;
-	PSG.OutputB = 0;
-	PSG.OutputC = 0;
-	PSG.OutputN = 0xff;
-	e8910_build_mixer_table();
-	PSG.ready   = 1;
+	psg->RNG     = 1;
+	psg->OutputA = 0;
+	psg->OutputB = 0;
+	psg->OutputC = 0;
+	psg->OutputN = 0xff;
+	psg->Queued = 0;
+	e8910_build_mixer_table(psg);
+	e8910_build_blip_kernel(psg);
+	memset(psg->BlipBuf, 0, sizeof(psg->BlipBuf));
+	psg->BlipLevel = 0;
+	psg->BlipSum = 0;
+	/* output at 44100hz unless another rate was set */
+	if (psg->Rate == 0)
+		psg->Rate = 44100;
+	psg->ready   = 1;
 }
 
-void e8910_done_sound(void)
+void e8910_done_sound(e8910_t *psg)
 {
+	(void) psg;
 }
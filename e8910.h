@@ -3,13 +3,75 @@
 
 #include <stdint.h>
 
-void e8910_init_sound(void);
-void e8910_done_sound(void);
-void e8910_callback(void* userdata, uint8_t* stream, int length);
-void e8910_write(int r, int v);
+/* most samples e8910_callback can render at once */
+#define E8910_MAX_SAMPLES 1024
+
+/* register writes that can be queued in one frame */
+#define E8910_QUEUE_SIZE  4096
+
+/* band-limited step kernel, see e8910.c */
+#define E8910_BLIP_PHASES 32
+#define E8910_BLIP_TAPS   16
+
+/* state of one AY-3-8910 */
+
+typedef struct e8910_type {
+	int index;
+	int ready;
+	int lastEnable;
+	int PeriodA,PeriodB,PeriodC,PeriodN,PeriodE;
+	int CountA,CountB,CountC,CountN,CountE;
+	int RNG;
+	unsigned VolA,VolB,VolC,VolE;
+	char CountEnv;
+	unsigned char EnvelopeA,EnvelopeB,EnvelopeC;
+	unsigned char OutputA,OutputB,OutputC,OutputN;
+	unsigned char Hold,Alternate,Attack,Holding;
+	unsigned VolTable[32];
+	unsigned Regs[16];     /* registers as seen by the generators */
+	unsigned snd_regs[16]; /* registers as seen by the cpu */
+
+	int BlipBuf[E8910_MAX_SAMPLES + E8910_BLIP_TAPS];
+	int BlipLevel;      /* level of the last step */
+	int BlipSum;        /* running sum of BlipBuf that was output */
+
+	/* everything above is plain data and is saved as it is, so that a
+	 * state is a single copy. states are taken between frames, when the
+	 * queue is empty and the filter tail of the last frame is at the
+	 * start of BlipBuf.
+	 */
+
+	/* register writes made during the current frame, in order */
+	struct {
+		unsigned cycle;
+		unsigned char r, v;
+	} Queue[E8910_QUEUE_SIZE];
+	int Queued;
+
+	unsigned Rate;
+	int BlipKernel[E8910_BLIP_PHASES][E8910_BLIP_TAPS];
+	int BlipSteps;      /* steps in the frame being rendered ... */
+	int BlipSamples;    /* ... and the samples they map onto */
+} e8910_t;
+
+void e8910_init_sound(e8910_t *psg);
+void e8910_done_sound(e8910_t *psg);
+
+/* render length stereo frames of signed 16-bit samples at the output
+ * rate, covering length / rate seconds of emulation.
+ */
+void e8910_callback(e8910_t *psg, int16_t* stream, int length);
+void e8910_set_rate(e8910_t *psg, unsigned rate);
+void e8910_write(e8910_t *psg, int r, int v);
+
+/* queue a register write made cycle cpu cycles into the current frame.
+ * the register reads back immediately but the generators only see it
+ * when the frame is rendered.
+ */
+void e8910_write_at(e8910_t *psg, unsigned cycle, int r, int v);
 
 int e8910_statesz(void);
-void e8910_deserialize(char* dst);
-void e8910_serialize(char* dst);
+void e8910_deserialize(e8910_t *psg, char* dst);
+void e8910_serialize(e8910_t *psg, char* dst);
 
 #endif
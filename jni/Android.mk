@@ -3,6 +3,7 @@ LOCAL_PATH := $(call my-dir)
 CORE_DIR := $(LOCAL_PATH)/..
 HAS_GPU := 1
 GLES    := 1
+HAVE_THREADS := 1
 
 include $(CORE_DIR)/Makefile.common
 
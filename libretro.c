@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,6 +15,15 @@
 #include "dots.h"
 #include "glsym/glsym.h"
 #endif
+#ifdef HAVE_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(SMOOTH_NEON) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#endif
 
 retro_log_printf_t log_cb;
 
@@ -67,10 +77,104 @@ static retro_input_poll_t poll_cb;
 static retro_input_state_t input_state_cb;
 static retro_environment_t environ_cb;
 static retro_audio_sample_t audio_cb;
+static retro_audio_sample_batch_t audio_batch_cb;
 
 static unsigned char point_size;
+static unsigned sample_rate = 44100;
+static vecx_context_t vecx;
+
+/* profiling, see vecx_stats_t. the frontend's perf counter is the clock and
+ * its time in microseconds puts a scale on the counter's ticks.
+ */
+#define PROFILE_FRAMES 250
+
+static struct retro_perf_callback perf_cb;
+static bool profile;
+static unsigned profile_frames;
+static uint64_t profile_sound_time;
+static retro_time_t profile_usec;
+
 static unsigned short framebuffer[BUFSZ];
 
+/* the software framebuffer is kept between frames and updated in tiles.
+ * every tile carries a hash of the ordered list of vectors whose bounds
+ * touch it, only tiles whose hash changed are cleared and redrawn.
+ */
+#define TILES_MAX 16
+#define TILE_MARGIN 2 /* how far a point reaches past its centre */
+
+static uint64_t tile_hash[2][TILES_MAX * TILES_MAX];
+static unsigned char tile_dirty[TILES_MAX * TILES_MAX];
+static int tile_cur;
+static int tile_shift;
+static int tiles_w, tiles_h;
+static bool tile_clip;
+static int tile_width, tile_height, tile_point_size; /* 0 if invalid */
+
+/* the tiles are drawn a band at a time, a row of them, and bands can be
+ * drawn side by side by several threads. every vector is binned into the
+ * bands its bounds touch and drawn in list order within each, so a pixel
+ * ends up as a single pass over the list would have left it.
+ */
+typedef struct sw_line
+{
+   int x0, y0, x1, y1;
+   uint16_t col;
+   unsigned char tx0, tx1; /* range of tiles touched */
+   unsigned char ty0, ty1;
+   unsigned char intensity;
+   float fx0, fy0, fx1, fy1;  /* unrounded ends, for the smooth renderer */
+} sw_line_t;
+
+typedef struct sw_clip
+{
+   int top, bottom;        /* rows of the band */
+   int tiles;              /* some tiles under the vector are clean */
+} sw_clip_t;
+
+static sw_line_t sw_lines[VECTOR_CNT];
+static unsigned short *sw_bins;  /* indices into sw_lines, band by band */
+static long sw_bins_size;
+static long sw_band_start[TILES_MAX + 1];
+static long sw_line_cnt;
+static bool sw_unbinned;          /* no memory for sw_bins, draw them all */
+static int sw_band_list[TILES_MAX]; /* bands with dirty tiles */
+
+/* the smooth renderer draws antialiased lines and adds up their light in
+ * smooth_acc, where SMOOTH_WHITE is full brightness. every render the
+ * phosphor glow in smooth_glow fades by smooth_decay/256, as one
+ * VECTREX_PDECAY period has passed, and takes on whatever is brighter in
+ * the new light. the glow is dithered into the framebuffer, so none of the
+ * 7 bits of intensity are lost.
+ */
+#define SMOOTH_WHITE  0x3fff
+#define SMOOTH_MARGIN 4 /* how far a line reaches past its rounded ends */
+
+static bool sw_smooth;
+static unsigned smooth_decay = 64;
+static float smooth_width;
+static uint16_t *smooth_acc, *smooth_glow;
+static unsigned char *smooth_rows; /* rows with light or glow in them */
+static long smooth_size;        /* pixels in each buffer, 0 if none */
+
+static void sw_smooth_free(void);
+
+#ifdef HAVE_THREADS
+#define SW_THREADS_MAX 8
+
+/* workers besides the thread calling retro_run, which draws too */
+static pthread_t sw_threads[SW_THREADS_MAX - 1];
+static int sw_thread_cnt;
+static pthread_mutex_t sw_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t sw_start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t sw_done  = PTHREAD_COND_INITIALIZER;
+static unsigned sw_generation;
+static int sw_next_band, sw_bands, sw_busy;
+static bool sw_quit;
+
+static void sw_set_threads(int threads);
+#endif
+
 #ifdef HAS_GPU
 static bool usingHWContext = false;
 
@@ -86,8 +190,29 @@ static GLuint brightnessLocation;
 static GLuint DotTextureID;
 static GLuint BloomTextureID;
 static GLuint vbo;
+static GLsizeiptr vbo_size; /* bytes allocated to vbo */
 GLfloat mvp_matrix[16];
 
+/* Instanced drawing, when the context has it. */
+#ifdef GL_APIENTRY
+#define VECX_APIENTRY GL_APIENTRY
+#else
+#define VECX_APIENTRY APIENTRY
+#endif
+
+typedef void (VECX_APIENTRY *draw_instanced_t)(GLenum, GLint, GLsizei, GLsizei);
+typedef void (VECX_APIENTRY *attrib_divisor_t)(GLuint, GLuint);
+
+static draw_instanced_t drawArraysInstanced;
+static attrib_divisor_t vertexAttribDivisor;
+static bool instanced;
+static GLuint corner_vbo;
+static GLuint cornerAttribLocation;
+static GLuint texCoordsAttribLocation;
+static GLuint endsAttribLocation;
+static GLuint offsetsAttribLocation[4];
+static GLuint colourPartsAttribLocation;
+
 typedef struct
 {
    uint32_t pos;
@@ -103,7 +228,75 @@ typedef struct
    };
 } GLVERTEX;
 
+/* pack a 16-bit vector coordinate pair into a vertex position */
+#define VECTOR_POS(x, y) ((uint32_t)(x) | (uint32_t)(y) << 16)
+
+/* Every vector is drawn as one instance of up to three quads, the start
+ * cap, the body and the end cap, laid out as in corners below. The
+ * offsets of their corners from the ends of the vector are worked out on
+ * the CPU and stored quantized, a pair in each half of a row:
+ *
+ *    row 0  start cap corners
+ *    row 1  start of the body
+ *    row 2  end of the body
+ *    row 3  end cap corners
+ *
+ * A point is a single quad in place of the start cap, with its corners
+ * in rows 0 and 1 and texture coordinates of its own.
+ */
+enum
+{
+   PART_START = 1,
+   PART_BODY  = 2,
+   PART_END   = 4,
+   PART_POINT = 8
+};
+
+typedef struct
+{
+   uint32_t pos[2];       /* start and end */
+   int8_t offsets[4][4];
+   GLubyte colour;
+   GLubyte parts;
+   uint16_t pad;
+} GLINSTANCE;
+
+typedef struct
+{
+   GLubyte end;           /* 0 at the start, 1 at the end */
+   GLubyte row;
+   GLubyte half;
+   GLubyte part;
+   GLubyte packedTexCoords;
+   GLubyte pointTexCoords;
+} GLCORNER;
+
+static const GLCORNER corners[18] =
+{
+   { 0, 0, 0, PART_START, 0x20, 0x02 },
+   { 0, 0, 1, PART_START, 0x22, 0x22 },
+   { 0, 1, 0, PART_START, 0x10, 0x00 },
+   { 0, 0, 1, PART_START, 0x22, 0x22 },
+   { 0, 1, 0, PART_START, 0x10, 0x00 },
+   { 0, 1, 1, PART_START, 0x12, 0x20 },
+
+   { 0, 1, 0, PART_BODY,  0x10, 0x10 },
+   { 0, 1, 1, PART_BODY,  0x12, 0x12 },
+   { 1, 2, 0, PART_BODY,  0x10, 0x10 },
+   { 0, 1, 1, PART_BODY,  0x12, 0x12 },
+   { 1, 2, 0, PART_BODY,  0x10, 0x10 },
+   { 1, 2, 1, PART_BODY,  0x12, 0x12 },
+
+   { 1, 2, 0, PART_END,   0x10, 0x10 },
+   { 1, 2, 1, PART_END,   0x12, 0x12 },
+   { 1, 3, 0, PART_END,   0x00, 0x00 },
+   { 1, 2, 1, PART_END,   0x12, 0x12 },
+   { 1, 3, 0, PART_END,   0x00, 0x00 },
+   { 1, 3, 1, PART_END,   0x02, 0x02 }
+};
+
 #define MAX_VECTORS 50000
+static GLINSTANCE instances[MAX_VECTORS];
 static GLVERTEX vertices[MAX_VECTORS * 18];
 
 static const float dotScale        = 1.0f;
@@ -120,23 +313,32 @@ typedef struct
 } VECX_POINT;
 
 #endif
-extern unsigned char vecx_ram[1024];
 
 /* Empty stubs */
 void retro_set_controller_port_device(unsigned port, unsigned device) {}
 void retro_cheat_reset(void) {}
 void retro_cheat_set(unsigned index, bool enabled, const char *code){}
-void retro_set_audio_sample_batch(retro_audio_sample_batch_t cb) {}
 unsigned retro_get_region(void) { return RETRO_REGION_PAL; }
 unsigned retro_api_version(void) { return RETRO_API_VERSION; }
 bool retro_load_game_special(unsigned game_type, const struct retro_game_info *info, size_t num_info) { return false; }
 
-void retro_deinit(void) { }
+void retro_deinit(void)
+{
+#ifdef HAVE_THREADS
+   sw_set_threads(1);
+#endif
+   free(sw_bins);
+   sw_bins      = NULL;
+   sw_bins_size = 0;
+   sw_unbinned  = false;
+
+   sw_smooth_free();
+}
 
 void *retro_get_memory_data(unsigned id)
 { 
    if ( id == RETRO_MEMORY_SYSTEM_RAM )
-      return vecx_ram;
+      return vecx.ram;
    return NULL; 
 }
 size_t retro_get_memory_size(unsigned id)
@@ -155,6 +357,7 @@ void retro_set_environment(retro_environment_t cb)
 
 void retro_set_video_refresh(retro_video_refresh_t cb) { video_cb = cb; }
 void retro_set_audio_sample(retro_audio_sample_t cb)   { audio_cb = cb; }
+void retro_set_audio_sample_batch(retro_audio_sample_batch_t cb) { audio_batch_cb = cb; }
 void retro_set_input_poll(retro_input_poll_t cb)       { poll_cb = cb; }
 void retro_set_input_state(retro_input_state_t cb)     { input_state_cb = cb; }
 
@@ -174,7 +377,7 @@ void retro_get_system_av_info(struct retro_system_av_info *info)
 {
    memset(info, 0, sizeof(*info));
    info->timing.fps            = 50.0;
-   info->timing.sample_rate    = 44100;
+   info->timing.sample_rate    = sample_rate;
    info->geometry.base_width   = 330;
    info->geometry.base_height  = 410;
 #if defined(_3DS) || defined(RETROFW)
@@ -253,6 +456,42 @@ static void compile_gl_program(void)
          "   gl_Position = vec4(pos, 0.0, 1.0) * mvpMatrix;\n"
          "}\n"
    };
+   /* The same, with the corners of an instance picked out as laid out in
+    * corners. A corner of a part the instance does not have collapses
+    * onto the start so that its triangles are empty. */
+   const GLchar *instancedShaderSource[] = {
+      "attribute vec4 corner;\n"
+         "attribute vec2 texCoords;\n"
+         "attribute vec4 ends;\n"
+         "attribute vec4 offsets0;\n"
+         "attribute vec4 offsets1;\n"
+         "attribute vec4 offsets2;\n"
+         "attribute vec4 offsets3;\n"
+         "attribute vec2 colourParts;\n"
+         "uniform mat4  mvpMatrix;\n"
+         "uniform float scale;\n"
+         "uniform float brightness;\n"
+
+         "varying float fragColour;\n"
+         "varying vec2 fragTexCoords;\n"
+
+         " void main()\n"
+         "{\n"
+         "   float colour = colourParts.x;\n"
+         "   float present = mod(floor(colourParts.y / corner.w), 2.0);\n"
+         "   float point = floor(colourParts.y / 8.0);\n"
+         "   vec4 row = corner.y < 0.5 ? offsets0 : corner.y < 1.5 ? offsets1 : corner.y < 2.5 ? offsets2 : offsets3;\n"
+         "   vec2 offset = mix(row.xy, row.zw, corner.z) * present;\n"
+         "   vec2 position = mix(ends.xy, ends.zw, corner.x * present);\n"
+         "   float packedTexCoords = mix(texCoords.x, texCoords.y, point);\n"
+         "   vec2 pos = position + (offset / 64.0) * scale * (colour / 255.0 + 0.5);\n"
+         "   fragColour = colour * brightness / (127.0 * 255.0);\n" 
+         "   float tx = floor(packedTexCoords * 0.0625);\n"
+         "   float ty = packedTexCoords - tx * 16.0;\n"
+         "   fragTexCoords = vec2(tx, ty) / 2.0;\n"
+         "   gl_Position = vec4(pos, 0.0, 1.0) * mvpMatrix;\n"
+         "}\n"
+   };
    const char *fragmentShaderSource[] = {
       "#ifdef GL_ES\n"
          "precision mediump float;\n"
@@ -274,7 +513,10 @@ static void compile_gl_program(void)
    GLuint vert = glCreateShader(GL_VERTEX_SHADER);
    GLuint frag = glCreateShader(GL_FRAGMENT_SHADER);
 
-   glShaderSource(vert, ARRAY_SIZE(vertexShaderSource), vertexShaderSource, 0);
+   if (instanced)
+      glShaderSource(vert, ARRAY_SIZE(instancedShaderSource), instancedShaderSource, 0);
+   else
+      glShaderSource(vert, ARRAY_SIZE(vertexShaderSource), vertexShaderSource, 0);
    glShaderSource(frag, ARRAY_SIZE(fragmentShaderSource), fragmentShaderSource, 0);
    glCompileShader(vert);
    glCompileShader(frag);
@@ -292,16 +534,90 @@ static void compile_gl_program(void)
    offsetAttribLocation          = glGetAttribLocation(ProgramID, "offset");
    colourAttribLocation          = glGetAttribLocation(ProgramID, "colour");
    packedTexCoordsAttribLocation = glGetAttribLocation(ProgramID, "packedTexCoords");
+   cornerAttribLocation          = glGetAttribLocation(ProgramID, "corner");
+   texCoordsAttribLocation       = glGetAttribLocation(ProgramID, "texCoords");
+   endsAttribLocation            = glGetAttribLocation(ProgramID, "ends");
+   offsetsAttribLocation[0]      = glGetAttribLocation(ProgramID, "offsets0");
+   offsetsAttribLocation[1]      = glGetAttribLocation(ProgramID, "offsets1");
+   offsetsAttribLocation[2]      = glGetAttribLocation(ProgramID, "offsets2");
+   offsetsAttribLocation[3]      = glGetAttribLocation(ProgramID, "offsets3");
+   colourPartsAttribLocation     = glGetAttribLocation(ProgramID, "colourParts");
    make_mvp_matrix(mvp_matrix, 0.0f-(SHIFTX*ALG_MAX_X), (ALG_MAX_Y-1)/SCALEY-(SHIFTY*ALG_MAX_Y), (ALG_MAX_X-1)/SCALEX-(SHIFTX*ALG_MAX_X), 0.0f-(SHIFTY*ALG_MAX_Y));
 }
 
+/* Instancing is core in GL 3.3 and GLES 3.0, and an extension before. */
+static void find_instancing(void)
+{
+   const char *version    = (const char *) glGetString(GL_VERSION);
+   const char *extensions = (const char *) glGetString(GL_EXTENSIONS);
+   const char *draw       = NULL;
+   const char *divisor    = NULL;
+   int major = 0, minor = 0;
+
+   drawArraysInstanced = NULL;
+   vertexAttribDivisor = NULL;
+   instanced           = false;
+
+   if (!version)
+      return;
+
+   if (!strncmp(version, "OpenGL ES ", 10))
+   {
+      sscanf(version + 10, "%d.%d", &major, &minor);
+      if (major >= 3)
+      {
+         draw    = "glDrawArraysInstanced";
+         divisor = "glVertexAttribDivisor";
+      }
+      else if (extensions && strstr(extensions, "GL_EXT_instanced_arrays"))
+      {
+         draw    = "glDrawArraysInstancedEXT";
+         divisor = "glVertexAttribDivisorEXT";
+      }
+   }
+   else
+   {
+      sscanf(version, "%d.%d", &major, &minor);
+      if (major > 3 || (major == 3 && minor >= 3))
+      {
+         draw    = "glDrawArraysInstanced";
+         divisor = "glVertexAttribDivisor";
+      }
+      else if (extensions && strstr(extensions, "GL_ARB_instanced_arrays"))
+      {
+         draw    = "glDrawArraysInstancedARB";
+         divisor = "glVertexAttribDivisorARB";
+      }
+   }
+
+   if (!draw)
+      return;
+
+   drawArraysInstanced = (draw_instanced_t) hw_render.get_proc_address(draw);
+   vertexAttribDivisor = (attrib_divisor_t) hw_render.get_proc_address(divisor);
+   instanced           = drawArraysInstanced && vertexAttribDivisor;
+
+   if (instanced)
+      log_cb(RETRO_LOG_INFO, "Drawing vectors with instancing.\n");
+}
+
 static void context_reset(void)
 {
    rglgen_resolve_symbols(hw_render.get_proc_address);
 
+   find_instancing();
    compile_gl_program();
    create_gl_image(DotWidth, DotHeight, DotImage, &DotTextureID);
    create_gl_image(BloomWidth, BloomHeight, BloomImage, &BloomTextureID);
+   glGenBuffers(1, &vbo);
+   vbo_size = 0;
+   if (instanced)
+   {
+      glGenBuffers(1, &corner_vbo);
+      glBindBuffer(GL_ARRAY_BUFFER, corner_vbo);
+      glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+   }
 #if 0
    setup_vao();
 #endif
@@ -321,7 +637,13 @@ static void context_destroy(void)
    if (vbo)
    {
       glDeleteBuffers(1, &vbo);
-      vbo = 0;
+      vbo      = 0;
+      vbo_size = 0;
+   }
+   if (corner_vbo)
+   {
+      glDeleteBuffers(1, &corner_vbo);
+      corner_vbo = 0;
    }
    if (DotTextureID)
    {
@@ -423,6 +745,48 @@ static bool set_rendering_context(bool useHardwareContext)
    return true;
 }
 
+static uint64_t profile_clock(void)
+{
+   return perf_cb.get_perf_counter();
+}
+
+static void profile_reset(void)
+{
+   memset(&vecx.stats, 0, sizeof(vecx.stats));
+   profile_frames     = 0;
+   profile_sound_time = 0;
+   profile_usec       = 0;
+}
+
+static void profile_report(void)
+{
+   const vecx_stats_t *st = &vecx.stats;
+   double n     = profile_frames;
+   double ticks = (double)st->emu_time + profile_sound_time;
+   uint64_t cpu = st->emu_time;
+
+   log_cb(RETRO_LOG_INFO,
+         "profile: %u frames, %.0f catchups (%.0f cycles stepped), "
+         "%.0f lines (%.0f%% deduplicated), %.1f renders per frame\n",
+         profile_frames, st->catchups / n, st->steps / n, st->lines / n,
+         st->lines ? 100.0 * st->lines_dedup / st->lines : 0.0,
+         st->renders / n);
+
+   if (!vecx.clock || ticks <= 0)
+      return;
+
+   /* the via time is an estimate and may come out above its share */
+   cpu = cpu > st->via_time + st->render_time ?
+      cpu - st->via_time - st->render_time : 0;
+
+   log_cb(RETRO_LOG_INFO,
+         "profile: %.0f usec per frame, cpu %.0f%%, via/analog %.0f%%, "
+         "render %.0f%%, sound %.0f%%\n",
+         (double)profile_usec / n, 100.0 * cpu / ticks,
+         100.0 * st->via_time / ticks, 100.0 * st->render_time / ticks,
+         100.0 * profile_sound_time / ticks);
+}
+
 static float get_float_variable(const char* key, float def)
 {
    struct retro_variable var;
@@ -433,10 +797,43 @@ static float get_float_variable(const char* key, float def)
    return def;
 }
 
-static void check_variables(void)
+#ifdef HAVE_THREADS
+/* the band threads only run for the software renderer */
+
+static void check_sw_threads(void)
+{
+   struct retro_variable var;
+   int threads = 1;
+
+   var.value = NULL;
+   var.key   = "vecx_sw_threads";
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      threads = atoi(var.value);
+
+      if (!strcmp(var.value, "auto"))
+      {
+         threads = 1;
+#ifdef _SC_NPROCESSORS_ONLN
+         threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+      }
+   }
+
+#ifdef HAS_GPU
+   if (usingHWContext)
+      threads = 1;
+#endif
+
+   sw_set_threads(threads);
+}
+#endif
+
+static void check_variables(bool in_run)
 {
    struct retro_variable var;
    struct retro_system_av_info av_info;
+   bool rate_changed = false;
 
 #ifdef HAS_GPU   
    var.value = NULL;
@@ -563,13 +960,83 @@ static void check_variables(void)
       }
    }
 
+   var.value = NULL;
+   var.key   = "vecx_sample_rate";
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      unsigned rate = strtoul(var.value, NULL, 0);
+
+      if ((rate == 22050 || rate == 44100 || rate == 48000) &&
+            rate != sample_rate)
+      {
+         sample_rate  = rate;
+         rate_changed = true;
+         e8910_set_rate(&vecx.psg, sample_rate);
+      }
+   }
+
+   var.value = NULL;
+   var.key   = "vecx_profile";
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      bool enable = !strcmp(var.value, "enabled");
+
+      if (enable != profile)
+      {
+         profile    = enable;
+         vecx.clock = profile && perf_cb.get_perf_counter &&
+            perf_cb.get_time_usec ? profile_clock : NULL;
+         profile_reset();
+      }
+   }
+
+#ifdef HAVE_THREADS
+   check_sw_threads();
+#endif
+
+   var.value = NULL;
+   var.key   = "vecx_sw_quality";
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      bool enable = !strcmp(var.value, "Smooth");
+
+      if (enable != sw_smooth)
+      {
+         sw_smooth = enable;
+
+         /* the glow starts out dark, the tiles over again */
+         sw_smooth_free();
+         tile_width = 0;
+      }
+   }
+
+   var.value = NULL;
+   var.key   = "vecx_sw_persistence";
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      int percent = atoi(var.value);
+
+      if (percent < 0)
+         percent = 0;
+      else if (percent > 90)
+         percent = 90;
+      smooth_decay = percent * 256 / 100;
+   }
+
    SCALEX = get_float_variable("vecx_scale_x", 1);
    SCALEY = get_float_variable("vecx_scale_y", 1);
    SHIFTX = 0.5*(1-SCALEX)+get_float_variable("vecx_shift_x", 0)/2.;
    SHIFTY = 0.5*(1-SCALEY)+get_float_variable("vecx_shift_y", 0)/2.;
 
    retro_get_system_av_info(&av_info);
-   environ_cb(RETRO_ENVIRONMENT_SET_GEOMETRY, &av_info);
+
+   /* the frontend has to reinitialise audio for a new rate, which it is
+    * only asked to do while running. before that it reads the av info.
+    */
+   if (rate_changed && in_run)
+      environ_cb(RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO, &av_info);
+   else
+      environ_cb(RETRO_ENVIRONMENT_SET_GEOMETRY, &av_info);
 }
 
 static void fallback_log(enum retro_log_level level, const char *fmt, ...)
@@ -587,7 +1054,10 @@ void retro_init(void)
 
    environ_cb(RETRO_ENVIRONMENT_SET_PERFORMANCE_LEVEL, &level);
 
-   check_variables();
+   if (!environ_cb(RETRO_ENVIRONMENT_GET_PERF_INTERFACE, &perf_cb))
+      memset(&perf_cb, 0, sizeof(perf_cb));
+
+   check_variables(false);
 }
 
 size_t retro_serialize_size(void)
@@ -597,12 +1067,12 @@ size_t retro_serialize_size(void)
 
 bool retro_serialize(void *data, size_t size)
 {
-	return vecx_serialize((char*)data, size);
+	return vecx_serialize(&vecx, (char*)data, size);
 }
 
 bool retro_unserialize(const void *data, size_t size)
 {
-	return vecx_deserialize((char*)data, size);
+	return vecx_deserialize(&vecx, (char*)data, size);
 }
 
 static unsigned char cart[65536];
@@ -647,6 +1117,14 @@ bool retro_load_game(const struct retro_game_info *info)
       option_display.visible = false;
       option_display.key = "vecx_res_multi";
       environ_cb(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY, &option_display);
+      option_display.key = "vecx_sw_quality";
+      environ_cb(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY, &option_display);
+      option_display.key = "vecx_sw_persistence";
+      environ_cb(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY, &option_display);
+#ifdef HAVE_THREADS
+      option_display.key = "vecx_sw_threads";
+      environ_cb(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY, &option_display);
+#endif
    }
    else
    {
@@ -667,10 +1145,16 @@ bool retro_load_game(const struct retro_game_info *info)
    set_rendering_context(false);
 #endif
 
+#ifdef HAVE_THREADS
+   /* the renderer may not be the one check_variables saw */
+   check_sw_threads();
+#endif
+
    environ_cb(RETRO_ENVIRONMENT_SET_INPUT_DESCRIPTORS, desc);
 
-   e8910_init_sound();
+   e8910_init_sound(&vecx.psg);
    memset(framebuffer, 0, sizeof(framebuffer));
+   tile_width = 0;
 
    /* start with a fresh BIOS copy */
    memcpy(rom, bios_data, bios_data_size);
@@ -684,10 +1168,10 @@ bool retro_load_game(const struct retro_game_info *info)
       memset(cart, 0, cart_sz);
       memcpy(cart, info->data, info->size);
       for(b = 0; b < sizeof(cart); b++)
-         set_cart(b, cart[b]);
+         set_cart(&vecx, b, cart[b]);
 
-      vecx_reset();
-      e8910_init_sound();
+      vecx_reset(&vecx);
+      e8910_init_sound(&vecx.psg);
 
       return true;
    }
@@ -700,14 +1184,14 @@ void retro_unload_game(void)
    int b;
    memset(cart, 0, sizeof(cart) / sizeof(cart[0]));
    for(b = 0; b < sizeof(cart); b++)
-      set_cart(b, 0);
-   vecx_reset();
+      set_cart(&vecx, b, 0);
+   vecx_reset(&vecx);
 }
 
 void retro_reset(void)
 {
-   vecx_reset();
-   e8910_init_sound();
+   vecx_reset(&vecx);
+   e8910_init_sound(&vecx.psg);
 }
 
 static INLINE uint16_t RGB1555(int col)
@@ -716,96 +1200,455 @@ static INLINE uint16_t RGB1555(int col)
    return col << 10 | col << 5 | col;
 }
 
-static INLINE void draw_point(int x, int y, uint16_t col)
+/* fill one row of a stamp, clipped to the screen and the band. the pixels
+ * in between are written without further checks.
+ */
+static INLINE void sw_span(int y, int x0, int x1, uint16_t col,
+      const sw_clip_t *clip)
 {
-   if (point_size == 1)
+   unsigned short *p;
+   int x;
+
+   if (y < clip->top || y >= clip->bottom)
+      return;
+   if (x0 < 0)
+      x0 = 0;
+   if (x1 >= WIDTH)
+      x1 = WIDTH - 1;
+   p = framebuffer + y * WIDTH;
+
+   if (clip->tiles)
    {
-      if (0 <= x && x < WIDTH && 0 <= y && y < HEIGHT)
-         framebuffer[ (y * WIDTH) + x ] = col;
+      /* skip the parts that lie in clean tiles */
+      const unsigned char *row = tile_dirty + (y >> tile_shift) * tiles_w;
+
+      while (x0 <= x1)
+      {
+         int end = x0 | ((1 << tile_shift) - 1);
+
+         if (end > x1)
+            end = x1;
+         if (row[x0 >> tile_shift])
+            for (x = x0; x <= end; x++)
+               p[x] = col;
+         x0 = end + 1;
+      }
+      return;
    }
-   else if (point_size == 2)
+
+   for (x = x0; x <= x1; x++)
+      p[x] = col;
+}
+
+/* the stamps draw the points x0..x1 (x0 <= x1) of row y at once. */
+
+/* point shape:
+ * X
+ */
+static INLINE void sw_stamp_1(int y, int x0, int x1, uint16_t col,
+      const sw_clip_t *clip)
+{
+   sw_span(y, x0, x1, col, clip);
+}
+
+/* point shape:
+ * .X.
+ * XXX
+ * .X.
+ */
+static INLINE void sw_stamp_2(int y, int x0, int x1, uint16_t col,
+      const sw_clip_t *clip)
+{
+   sw_span(y - 1, x0, x1, col, clip);
+   sw_span(y, x0 - 1, x1 + 1, col, clip);
+   sw_span(y + 1, x0, x1, col, clip);
+}
+
+/* point shape:
+ * .XX.
+ * XXXX
+ * XXXX
+ * .XX.
+ */
+static INLINE void sw_stamp_3(int y, int x0, int x1, uint16_t col,
+      const sw_clip_t *clip)
+{
+   sw_span(y - 1, x0, x1 + 1, col, clip);
+   sw_span(y, x0 - 1, x1 + 2, col, clip);
+   sw_span(y + 1, x0 - 1, x1 + 2, col, clip);
+   sw_span(y + 2, x0, x1 + 1, col, clip);
+}
+
+/* bresenham, one function per point shape. the points of a row are
+ * collected and stamped together when the walk moves on to the next row.
+ * the whole line is walked, but rows are only stamped near the band and
+ * the walk stops once it has left the band for good.
+ */
+#define SW_DRAW_LINE(name, stamp) \
+static void name(int x0, int y0, int x1, int y1, uint16_t col, \
+      const sw_clip_t *clip) \
+{ \
+   int dx  = abs(x1-x0), sx = x0<x1 ? 1 : -1; \
+   int dy  = abs(y1-y0), sy = y0<y1 ? 1 : -1; \
+   int err = (dx>dy ? dx : -dy) / 2, e2; \
+   int top    = clip->top - TILE_MARGIN; \
+   int bottom = clip->bottom + TILE_MARGIN; \
+   int start  = x0; \
+   if (sy > 0 ? y0 >= bottom : y0 < top) \
+      return; \
+   while(1) \
+   { \
+      int x = x0; \
+      if (x0==x1 && y0==y1) \
+      { \
+         if (top <= y0 && y0 < bottom) \
+            stamp(y0, start < x ? start : x, start < x ? x : start, \
+                  col, clip); \
+         break; \
+      } \
+      e2 = err; \
+      if (e2 >-dx) \
+      { \
+         err -= dy; \
+         x0  += sx; \
+      } \
+      if (e2 < dy) \
+      { \
+         err += dx; \
+         if (top <= y0 && y0 < bottom) \
+            stamp(y0, start < x ? start : x, start < x ? x : start, \
+                  col, clip); \
+         y0   += sy; \
+         start = x0; \
+         if (sy > 0 ? y0 >= bottom : y0 < top) \
+            break; \
+      } \
+   } \
+}
+
+SW_DRAW_LINE(draw_line_1, sw_stamp_1)
+SW_DRAW_LINE(draw_line_2, sw_stamp_2)
+SW_DRAW_LINE(draw_line_3, sw_stamp_3)
+
+/* smooth renderer */
+
+/* 4x4 ordered dither, thresholds for the bits dropped going from 11 to 5 */
+static const uint16_t smooth_dither[4][4] = {
+   {   64, 1088,  320, 1344 },
+   { 1600,  576, 1856,  832 },
+   {  448, 1472,  192, 1216 },
+   { 1984,  960, 1728,  704 }
+};
+
+static void sw_smooth_free(void)
+{
+   free(smooth_acc);
+   free(smooth_glow);
+   free(smooth_rows);
+   smooth_acc  = NULL;
+   smooth_glow = NULL;
+   smooth_rows = NULL;
+   smooth_size = 0;
+}
+
+static bool sw_smooth_alloc(void)
+{
+   long size = (long)WIDTH * HEIGHT;
+
+   if (size == smooth_size)
+      return true;
+
+   sw_smooth_free();
+   smooth_acc  = (uint16_t *) calloc(size, sizeof(uint16_t));
+   smooth_glow = (uint16_t *) calloc(size, sizeof(uint16_t));
+   smooth_rows = (unsigned char *) malloc(HEIGHT);
+   if (!smooth_acc || !smooth_glow || !smooth_rows)
    {
-      /* point shape:
-       * .X.
-       * XXX
-       * .X.
-       */
-      int pos = y * WIDTH + x;
-      if (0 <= x && x < WIDTH && 0 <= y && y < HEIGHT)
-         framebuffer[ pos ] = col;
-      if ( x > 0 )
-         framebuffer[ pos - 1 ] = col;
-      if ( x < WIDTH -1 )
-         framebuffer[ pos + 1 ] = col;
-      if ( y > 0)
-         framebuffer[ pos - WIDTH ] = col;
-      if ( y < HEIGHT - 1 )
-         framebuffer[ pos + WIDTH ] = col;
+      sw_smooth_free();
+      return false;
+   }
+
+   /* the framebuffer still has to be cleared */
+   memset(smooth_rows, 1, HEIGHT);
+
+   smooth_size = size;
+   return true;
+}
+
+static INLINE int sw_floor(float f)
+{
+   int i = (int) f;
+
+   return i - (f < i);
+}
+
+/* how much of the pixel [p, p + 1) the interval [lo, hi) covers */
+static INLINE float sw_cover(int p, float lo, float hi)
+{
+   float a = lo > p ? lo : (float) p;
+   float b = hi < p + 1 ? hi : (float) (p + 1);
+
+   return b > a ? b - a : 0.0f;
+}
+
+/* add the light of a line of smooth_width with square ends. it is walked
+ * a pixel at a time along its major axis, and every step covers the
+ * pixels across it by how much of them the line's cross section overlaps,
+ * which for a width of 1 is wu's algorithm.
+ */
+static void sw_smooth_line(const sw_line_t *l, const sw_clip_t *clip)
+{
+   float x0 = l->fx0, y0 = l->fy0, x1 = l->fx1, y1 = l->fy1, f;
+   float hw = smooth_width * 0.5f;
+   float slope = 0.0f, t = hw, level;
+   int mlo, mhi, mstride, nlo, nhi, nstride;
+   int c, c0, c1, steep;
+
+   if (l->intensity == 0)
+      return;
+   level = (l->intensity > 127 ? 127 : l->intensity) *
+      (SMOOTH_WHITE / 127.0f);
+
+   /* walk along x, with the axes swapped for steep lines */
+   steep = fabsf(y1 - y0) > fabsf(x1 - x0);
+   if (steep)
+   {
+      f = x0; x0 = y0; y0 = f;
+      f = x1; x1 = y1; y1 = f;
+      mlo     = clip->top;
+      mhi     = clip->bottom;
+      mstride = WIDTH;
+      nlo     = 0;
+      nhi     = WIDTH;
+      nstride = 1;
    }
    else
    {
-      int dy, posy;
-      /* point shape: 
-       * .XX.
-       * XXXX
-       * XXXX
-       * .XX.
-       */
+      mlo     = 0;
+      mhi     = WIDTH;
+      mstride = 1;
+      nlo     = clip->top;
+      nhi     = clip->bottom;
+      nstride = WIDTH;
+   }
+
+   if (x0 > x1)
+   {
+      f = x0; x0 = x1; x1 = f;
+      f = y0; y0 = y1; y1 = f;
+   }
 
-      x--;
-      y--;
+   if (x1 > x0)
+   {
+      float dx = x1 - x0, dy = y1 - y0;
+
+      slope = dy / dx;
+      /* the cross section, measured along the minor axis */
+      t = hw * sqrtf(dx * dx + dy * dy) / dx;
+   }
+
+   c0 = sw_floor(x0 - hw);
+   c1 = sw_floor(x1 + hw);
 
-      posy = y * WIDTH;
+   /* only step through the part that can reach the band */
+   if (slope != 0.0f)
+   {
+      float a = x0 + (nlo - t - y0) / slope;
+      float b = x0 + (nhi + t - y0) / slope;
 
-      for (dy = 0 ; dy < 4 ; dy++, posy += WIDTH)
+      if (a > b)
       {
-         int y1 = y + dy;
+         f = a; a = b; b = f;
+      }
+      if (c0 < sw_floor(a - hw) - 1)
+         c0 = sw_floor(a - hw) - 1;
+      if (c1 > sw_floor(b + hw) + 1)
+         c1 = sw_floor(b + hw) + 1;
+   }
 
-         if (0 <= y1 && y1 < HEIGHT)
-         {
-            int dx;
-            for (dx = 0 ; dx < 4 ; dx++)
-            {
-               int x1 = x + dx;
-               if (0 <= x1 && x1 < WIDTH && ( dx % 3 != 0 || dy % 3 != 0))
-                  framebuffer[ posy + x1 ] = col;
-            }
-         }
+   if (c0 < mlo)
+      c0 = mlo;
+   if (c1 >= mhi)
+      c1 = mhi - 1;
+
+   for (c = c0; c <= c1; c++)
+   {
+      float m = c + 0.5f;
+      float w = sw_cover(c, x0 - hw, x1 + hw) * level;
+      float lo, hi;
+      int r, r0, r1;
+
+      /* past the ends the cross section is the end's */
+      if (m < x0)
+         m = x0;
+      else if (m > x1)
+         m = x1;
+
+      lo = y0 + slope * (m - x0) - t;
+      hi = lo + 2.0f * t;
+      r0 = sw_floor(lo);
+      r1 = sw_floor(hi);
+      if (r0 < nlo)
+         r0 = nlo;
+      if (r1 >= nhi)
+         r1 = nhi - 1;
+      if (r0 > r1)
+         continue;
+
+      if (steep)
+         smooth_rows[c] = 1;
+      else
+         memset(smooth_rows + r0, 1, r1 - r0 + 1);
+
+      for (r = r0; r <= r1; r++)
+      {
+         uint16_t *p = smooth_acc + c * mstride + r * nstride;
+         unsigned v  = *p + (unsigned) (sw_cover(r, lo, hi) * w + 0.5f);
+
+         *p = v > 0xffff ? 0xffff : v;
       }
    }
 }
 
-static INLINE void draw_line(
-      unsigned x0, unsigned y0,
-      unsigned x1, unsigned y1, uint16_t col)
+/* fade the glow of a row, let the new light in and dither the result to
+ * 5 bits. the light is used up, leaving the row clear for the next render.
+ * returns whether anything still glows. the neon version is only built
+ * with SMOOTH_NEON defined, until it has been run on arm hardware.
+ */
+static bool sw_smooth_row(uint16_t *acc, uint16_t *glow,
+      unsigned short *out, int n, const uint16_t *dither)
 {
-   int dx  = abs((int)x1-(int)x0), sx = x0<x1 ? 1 : -1;
-   int dy  = abs((int)y1-(int)y0), sy = y0<y1 ? 1 : -1; 
-   int err = (dx>dy ? dx : -dy) / 2, e2;
+   unsigned lit = 0;
+   int x = 0;
+
+#if defined(__SSE2__)
+   __m128i decay = _mm_set1_epi16((short) (smooth_decay << 8));
+   __m128i white = _mm_set1_epi16(SMOOTH_WHITE);
+   __m128i zero  = _mm_setzero_si128();
+   __m128i dith  = _mm_setr_epi16(dither[0], dither[1], dither[2], dither[3],
+         dither[0], dither[1], dither[2], dither[3]);
+   __m128i any   = zero;
+
+   for (; x + 8 <= n; x += 8)
+   {
+      __m128i a = _mm_loadu_si128((const __m128i *) (acc + x));
+      __m128i g = _mm_loadu_si128((const __m128i *) (glow + x));
+
+      /* g * decay / 256, then max(a, g) and min(g, white) */
+      g = _mm_mulhi_epu16(g, decay);
+      g = _mm_add_epi16(g, _mm_subs_epu16(a, g));
+      _mm_storeu_si128((__m128i *) (glow + x), g);
+      _mm_storeu_si128((__m128i *) (acc + x), zero);
+      any = _mm_or_si128(any, g);
+
+      g = _mm_sub_epi16(g, _mm_subs_epu16(g, white));
+      g = _mm_mullo_epi16(_mm_srli_epi16(g, 3), _mm_set1_epi16(31));
+      g = _mm_srli_epi16(_mm_add_epi16(g, dith), 11);
+      _mm_storeu_si128((__m128i *) (out + x),
+            _mm_mullo_epi16(g, _mm_set1_epi16(0x421)));
+   }
 
-   while(1)
+   lit = _mm_movemask_epi8(_mm_cmpeq_epi16(any, zero)) != 0xffff;
+#elif defined(SMOOTH_NEON) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+   uint16x4_t decay = vdup_n_u16(smooth_decay);
+   uint16x8_t white = vdupq_n_u16(SMOOTH_WHITE);
+   uint16x8_t zero  = vdupq_n_u16(0);
+   uint16x4_t d4    = vld1_u16(dither);
+   uint16x8_t dith  = vcombine_u16(d4, d4);
+   uint16x8_t any   = zero;
+
+   for (; x + 8 <= n; x += 8)
    {
-      draw_point(x0, y0, col);
-      if (x0==x1 && y0==y1)
-         break;
-      e2 = err;
-      if (e2 >-dx)
-      {
-         err -= dy;
-         x0  += sx;
-      }
-      if (e2 < dy)
-      {
-         err += dx;
-         y0  += sy;
-      }
+      uint16x8_t a = vld1q_u16(acc + x);
+      uint16x8_t g = vld1q_u16(glow + x);
+
+      g = vcombine_u16(
+            vshrn_n_u32(vmull_u16(vget_low_u16(g), decay), 8),
+            vshrn_n_u32(vmull_u16(vget_high_u16(g), decay), 8));
+      g = vmaxq_u16(g, a);
+      vst1q_u16(glow + x, g);
+      vst1q_u16(acc + x, zero);
+      any = vorrq_u16(any, g);
+
+      g = vminq_u16(g, white);
+      g = vmulq_n_u16(vshrq_n_u16(g, 3), 31);
+      g = vshrq_n_u16(vaddq_u16(g, dith), 11);
+      vst1q_u16(out + x, vmulq_n_u16(g, 0x421));
+   }
+
+   lit = (vgetq_lane_u64(vreinterpretq_u64_u16(any), 0) |
+         vgetq_lane_u64(vreinterpretq_u64_u16(any), 1)) != 0;
+#endif
+
+   for (; x < n; x++)
+   {
+      unsigned g = glow[x] * smooth_decay >> 8;
+
+      if (acc[x] > g)
+         g = acc[x];
+      glow[x] = g;
+      acc[x]  = 0;
+      lit    |= g;
+
+      if (g > SMOOTH_WHITE)
+         g = SMOOTH_WHITE;
+      out[x] = (((g >> 3) * 31 + dither[x & 3]) >> 11) * 0x421;
+   }
+
+   return lit != 0;
+}
+
+/* the lines sw_bin put in a band, or all of them when it could not */
+
+static INLINE void sw_band_range(int band, long *first, long *last)
+{
+   *first = sw_unbinned ? 0 : sw_band_start[band];
+   *last  = sw_unbinned ? sw_line_cnt : sw_band_start[band + 1];
+}
+
+static INLINE const sw_line_t *sw_band_line(long k)
+{
+   return &sw_lines[sw_unbinned ? k : sw_bins[k]];
+}
+
+static void sw_smooth_band(int band, const sw_clip_t *clip)
+{
+   long k, first, last;
+   int y;
+
+   sw_band_range(band, &first, &last);
+
+   for (k = first; k < last; k++)
+   {
+      const sw_line_t *l = sw_band_line(k);
+
+      if (band >= l->ty0 && band <= l->ty1)
+         sw_smooth_line(l, clip);
+   }
+
+   /* dark rows have been put out dark already */
+   for (y = clip->top; y < clip->bottom; y++)
+   {
+      if (smooth_rows[y])
+         smooth_rows[y] = sw_smooth_row(smooth_acc + y * WIDTH,
+               smooth_glow + y * WIDTH, framebuffer + y * WIDTH, WIDTH,
+               smooth_dither[y & 3]);
    }
 }
 
 #ifdef HAS_GPU
-static inline uint32_t make_all(float dx, float dy, int8_t col, uint8_t tc)
+static inline int8_t quantize(float d)
 {
-   return (((int8_t)(dx*64.0f+0.5f)) & 0xff) | (((int8_t)(dy*64.0f+0.5f) & 0xff) << 8) | ((col << 16)&0xff0000) | (tc << 24);
+   return (int8_t)(d*64.0f+0.5f);
+}
+
+/* Set a row of offsets, the corners at (dx0, dy0) and (dx1, dy1). */
+static inline void set_offsets(int8_t *o, float dx0, float dy0, float dx1, float dy1)
+{
+   o[0] = quantize(dx0);
+   o[1] = quantize(dy0);
+   o[2] = quantize(dx1);
+   o[3] = quantize(dy1);
 }
 
 static inline float dot2d(VECX_POINT a, VECX_POINT b)
@@ -835,43 +1678,543 @@ static void intersection_point(VECX_POINT *res,
       res->y = (a1 * c2 - a2 * c1) / determinant;
    }
 }
+
+/* Without instancing the vertex shader sees every corner of every
+ * instance as a vertex of its own. Parts an instance does not have are
+ * left out. */
+static GLint expand_instances(GLVERTEX *v, const GLINSTANCE *in, GLint count)
+{
+   GLint i, num_verts = 0;
+   int k;
+
+   for (i = 0; i < count; i++, in++)
+   {
+      for (k = 0; k < 18; k++)
+      {
+         const GLCORNER *c = &corners[k];
+         const int8_t *o   = in->offsets[c->row] + 2 * c->half;
+
+         if (!(in->parts & c->part))
+            continue;
+
+         v[num_verts].pos             = in->pos[c->end];
+         v[num_verts].offsets         = (uint8_t) o[0] | (uint8_t) o[1] << 8;
+         v[num_verts].colour          = in->colour;
+         v[num_verts].packedTexCoords = (in->parts & PART_POINT) ? c->pointTexCoords : c->packedTexCoords;
+         num_verts++;
+      }
+   }
+
+   return num_verts;
+}
+
+/* Upload this frame's data to vbo, once for both passes. Respecifying
+ * the storage first orphans the buffer the previous frame may still be
+ * drawing from, so the driver hands out fresh memory instead of
+ * stalling. It only grows, so the same size is asked for every frame and
+ * the old storage can be recycled. */
+static void stream_data(const void *data, GLsizeiptr size)
+{
+   glBindBuffer(GL_ARRAY_BUFFER, vbo);
+   if (size > vbo_size)
+   {
+      vbo_size = 2 * size;
+      if (vbo_size > (GLsizeiptr) sizeof(vertices))
+         vbo_size = sizeof(vertices);
+   }
+   glBufferData(GL_ARRAY_BUFFER, vbo_size, NULL, GL_STREAM_DRAW);
+   glBufferSubData(GL_ARRAY_BUFFER, 0, size, data);
+}
+
+static void bind_instances(GLint count)
+{
+   int k;
+
+   glBindBuffer(GL_ARRAY_BUFFER, corner_vbo);
+   glVertexAttribPointer(cornerAttribLocation, 4, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(GLCORNER), (const GLvoid *) offsetof(GLCORNER, end));
+   glEnableVertexAttribArray(cornerAttribLocation);
+   glVertexAttribPointer(texCoordsAttribLocation, 2, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(GLCORNER), (const GLvoid *) offsetof(GLCORNER, packedTexCoords));
+   glEnableVertexAttribArray(texCoordsAttribLocation);
+
+   stream_data(instances, count * sizeof(GLINSTANCE));
+
+   glVertexAttribPointer(endsAttribLocation, 4, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(GLINSTANCE), (const GLvoid *) offsetof(GLINSTANCE, pos));
+   glEnableVertexAttribArray(endsAttribLocation);
+   vertexAttribDivisor(endsAttribLocation, 1);
+   for (k = 0; k < 4; k++)
+   {
+      glVertexAttribPointer(offsetsAttribLocation[k], 4, GL_BYTE, GL_FALSE, sizeof(GLINSTANCE), (const GLvoid *) (offsetof(GLINSTANCE, offsets) + 4 * k));
+      glEnableVertexAttribArray(offsetsAttribLocation[k]);
+      vertexAttribDivisor(offsetsAttribLocation[k], 1);
+   }
+   glVertexAttribPointer(colourPartsAttribLocation, 2, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(GLINSTANCE), (const GLvoid *) offsetof(GLINSTANCE, colour));
+   glEnableVertexAttribArray(colourPartsAttribLocation);
+   vertexAttribDivisor(colourPartsAttribLocation, 1);
+}
+
+static void unbind_instances(void)
+{
+   int k;
+
+   /* The divisors are left as the frontend expects them, at 0. */
+   vertexAttribDivisor(endsAttribLocation, 0);
+   vertexAttribDivisor(colourPartsAttribLocation, 0);
+   glDisableVertexAttribArray(cornerAttribLocation);
+   glDisableVertexAttribArray(texCoordsAttribLocation);
+   glDisableVertexAttribArray(endsAttribLocation);
+   glDisableVertexAttribArray(colourPartsAttribLocation);
+   for (k = 0; k < 4; k++)
+   {
+      vertexAttribDivisor(offsetsAttribLocation[k], 0);
+      glDisableVertexAttribArray(offsetsAttribLocation[k]);
+   }
+}
+
+static void bind_vertices(GLint count)
+{
+   stream_data(vertices, count * sizeof(GLVERTEX));
+
+   glVertexAttribPointer(positionAttribLocation, 2, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(GLVERTEX), (const GLvoid *) offsetof(GLVERTEX, pos));
+   glEnableVertexAttribArray(positionAttribLocation);
+   glVertexAttribPointer(offsetAttribLocation, 2, GL_BYTE, GL_FALSE, sizeof(GLVERTEX), (const GLvoid *) offsetof(GLVERTEX, offsets));
+   glEnableVertexAttribArray(offsetAttribLocation);
+   glVertexAttribPointer(colourAttribLocation, 1, GL_BYTE, GL_FALSE, sizeof(GLVERTEX), (const GLvoid *) offsetof(GLVERTEX, colour));
+   glEnableVertexAttribArray(colourAttribLocation);
+   glVertexAttribPointer(packedTexCoordsAttribLocation, 1, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(GLVERTEX), (const GLvoid *) offsetof(GLVERTEX, packedTexCoords));
+   glEnableVertexAttribArray(packedTexCoordsAttribLocation);
+}
+
+static void unbind_vertices(void)
+{
+   glDisableVertexAttribArray(positionAttribLocation);
+   glDisableVertexAttribArray(colourAttribLocation);
+   glDisableVertexAttribArray(offsetAttribLocation);
+   glDisableVertexAttribArray(packedTexCoordsAttribLocation);
+}
+
+/* count is of instances if instanced, otherwise of vertices */
+static void draw_vectors(GLint count)
+{
+   if (instanced)
+      drawArraysInstanced(GL_TRIANGLES, 0, ARRAY_SIZE(corners), count);
+   else
+      glDrawArrays(GL_TRIANGLES, 0, count);
+}
+#endif
+
+/* screen position of a vector */
+
+static INLINE void sw_vector(const vector_t *v,
+      int *x0, int *y0, int *x1, int *y1)
+{
+   *x0 = (unsigned)(((float)v->x0 / (float)ALG_MAX_X * SCALEX + SHIFTX) * (float)WIDTH);
+   *x1 = (unsigned)(((float)v->x1 / (float)ALG_MAX_X * SCALEX + SHIFTX) * (float)WIDTH);
+   *y0 = (unsigned)(((float)v->y0 / (float)ALG_MAX_Y * SCALEY + SHIFTY) * (float)HEIGHT);
+   *y1 = (unsigned)(((float)v->y1 / (float)ALG_MAX_Y * SCALEY + SHIFTY) * (float)HEIGHT);
+}
+
+/* the same without rounding to pixels */
+static INLINE void sw_subpixel(const vector_t *v, sw_line_t *l)
+{
+   l->fx0 = ((float)v->x0 / (float)ALG_MAX_X * SCALEX + SHIFTX) * (float)WIDTH;
+   l->fx1 = ((float)v->x1 / (float)ALG_MAX_X * SCALEX + SHIFTX) * (float)WIDTH;
+   l->fy0 = ((float)v->y0 / (float)ALG_MAX_Y * SCALEY + SHIFTY) * (float)HEIGHT;
+   l->fy1 = ((float)v->y1 / (float)ALG_MAX_Y * SCALEY + SHIFTY) * (float)HEIGHT;
+}
+
+/* range of tiles a vector can draw into, reaching margin pixels past its
+ * ends. returns false if it is entirely off screen.
+ */
+
+static int sw_tx0, sw_ty0, sw_tx1, sw_ty1;
+
+static INLINE bool sw_tiles(int x0, int y0, int x1, int y1, int margin)
+{
+   int xmin = (x0 < x1 ? x0 : x1) - margin;
+   int xmax = (x0 < x1 ? x1 : x0) + margin;
+   int ymin = (y0 < y1 ? y0 : y1) - margin;
+   int ymax = (y0 < y1 ? y1 : y0) + margin;
+
+   if (xmax < 0 || ymax < 0 || xmin >= WIDTH || ymin >= HEIGHT)
+      return false;
+
+   sw_tx0 = xmin < 0 ? 0 : xmin >> tile_shift;
+   sw_ty0 = ymin < 0 ? 0 : ymin >> tile_shift;
+   sw_tx1 = (xmax >= WIDTH ? WIDTH - 1 : xmax) >> tile_shift;
+   sw_ty1 = (ymax >= HEIGHT ? HEIGHT - 1 : ymax) >> tile_shift;
+
+   return true;
+}
+
+/* sort the lines into bins by band, and list the bands to draw */
+
+static void sw_bin(long lines)
+{
+   long fill[TILES_MAX];
+   long i, total;
+   int ty;
+
+   memset(sw_band_start, 0, sizeof(sw_band_start));
+
+   for (i = 0; i < lines; i++)
+      for (ty = sw_lines[i].ty0; ty <= sw_lines[i].ty1; ty++)
+         sw_band_start[ty + 1]++;
+
+   for (ty = 0; ty < tiles_h; ty++)
+   {
+      fill[ty] = sw_band_start[ty];
+      sw_band_start[ty + 1] += sw_band_start[ty];
+   }
+
+   total = sw_band_start[tiles_h];
+
+   sw_line_cnt = lines;
+
+   if (total > sw_bins_size)
+   {
+      unsigned short *bins = (unsigned short *) realloc(sw_bins,
+            total * 2 * sizeof(*sw_bins));
+
+      /* sw_bins is still good for fewer lines, try again next frame */
+      if (!bins)
+      {
+         if (!sw_unbinned)
+            log_cb(RETRO_LOG_ERROR, "Out of memory for the line bins, drawing every line in every band.\n");
+         sw_unbinned = true;
+         return;
+      }
+
+      sw_bins      = bins;
+      sw_bins_size = total * 2;
+   }
+
+   sw_unbinned = false;
+
+   for (i = 0; i < lines; i++)
+      for (ty = sw_lines[i].ty0; ty <= sw_lines[i].ty1; ty++)
+         sw_bins[fill[ty]++] = (unsigned short) i;
+}
+
+static void sw_draw_band(int band)
+{
+   unsigned char *row = tile_dirty + band * tiles_w;
+   sw_clip_t clip;
+   long k, first, last;
+   int y, t;
+
+   clip.top    = band << tile_shift;
+   clip.bottom = clip.top + (1 << tile_shift);
+   if (clip.bottom > HEIGHT)
+      clip.bottom = HEIGHT;
+
+   if (sw_smooth)
+   {
+      sw_smooth_band(band, &clip);
+      return;
+   }
+
+   /* clear the dirty tiles */
+   for (y = clip.top; y < clip.bottom; y++)
+   {
+      for (t = 0; t < tiles_w; t++)
+      {
+         int x = t << tile_shift;
+         int w = 1 << tile_shift;
+
+         if (!row[t])
+            continue;
+         if (x + w > WIDTH)
+            w = WIDTH - x;
+         memset(framebuffer + y * WIDTH + x, 0,
+               w * sizeof(unsigned short));
+      }
+   }
+
+   /* rasterize the lines of the band */
+   sw_band_range(band, &first, &last);
+
+   for (k = first; k < last; k++)
+   {
+      const sw_line_t *l = sw_band_line(k);
+
+      if (band < l->ty0 || band > l->ty1)
+         continue;
+
+      clip.tiles = 0;
+      if (tile_clip)
+      {
+         int tx, touched = 0;
+
+         for (tx = l->tx0; tx <= l->tx1; tx++)
+         {
+            if (row[tx])
+               touched = 1;
+            else
+               clip.tiles = 1;
+         }
+
+         if (!touched)
+            continue;
+      }
+
+      if (point_size == 1)
+         draw_line_1(l->x0, l->y0, l->x1, l->y1, l->col, &clip);
+      else if (point_size == 2)
+         draw_line_2(l->x0, l->y0, l->x1, l->y1, l->col, &clip);
+      else
+         draw_line_3(l->x0, l->y0, l->x1, l->y1, l->col, &clip);
+   }
+}
+
+#ifdef HAVE_THREADS
+static void *sw_worker(void *arg)
+{
+   unsigned seen;
+
+   pthread_mutex_lock(&sw_lock);
+   seen = sw_generation;
+
+   for (;;)
+   {
+      while (seen == sw_generation && !sw_quit)
+         pthread_cond_wait(&sw_start, &sw_lock);
+
+      if (sw_quit)
+         break;
+
+      seen = sw_generation;
+      sw_busy++;
+
+      while (sw_next_band < sw_bands)
+      {
+         int band = sw_band_list[sw_next_band++];
+
+         pthread_mutex_unlock(&sw_lock);
+         sw_draw_band(band);
+         pthread_mutex_lock(&sw_lock);
+      }
+
+      if (--sw_busy == 0)
+         pthread_cond_signal(&sw_done);
+   }
+
+   pthread_mutex_unlock(&sw_lock);
+
+   return NULL;
+}
+
+/* threads drawing the bands, counting the caller */
+
+static void sw_set_threads(int threads)
+{
+   int i;
+
+   if (threads > SW_THREADS_MAX)
+      threads = SW_THREADS_MAX;
+   if (threads < 1)
+      threads = 1;
+   if (threads - 1 == sw_thread_cnt)
+      return;
+
+   pthread_mutex_lock(&sw_lock);
+   sw_quit = true;
+   pthread_cond_broadcast(&sw_start);
+   pthread_mutex_unlock(&sw_lock);
+
+   for (i = 0; i < sw_thread_cnt; i++)
+      pthread_join(sw_threads[i], NULL);
+
+   sw_quit       = false;
+   sw_thread_cnt = 0;
+
+   /* with fewer workers than asked for the caller draws the rest */
+   for (i = 0; i < threads - 1; i++)
+   {
+      if (pthread_create(&sw_threads[i], NULL, sw_worker, NULL) != 0)
+         break;
+      sw_thread_cnt++;
+   }
+}
 #endif
 
-void osint_render(void)
+static void sw_draw(void)
+{
+   int band, bands = 0;
+
+   for (band = 0; band < tiles_h; band++)
+   {
+      int t;
+
+      for (t = 0; t < tiles_w; t++)
+         if (tile_dirty[band * tiles_w + t])
+            break;
+
+      if (t < tiles_w)
+         sw_band_list[bands++] = band;
+   }
+
+#ifdef HAVE_THREADS
+   if (sw_thread_cnt > 0 && bands > 1)
+   {
+      pthread_mutex_lock(&sw_lock);
+      sw_next_band = 0;
+      sw_bands     = bands;
+      sw_generation++;
+      pthread_cond_broadcast(&sw_start);
+
+      while (sw_next_band < sw_bands)
+      {
+         band = sw_band_list[sw_next_band++];
+
+         pthread_mutex_unlock(&sw_lock);
+         sw_draw_band(band);
+         pthread_mutex_lock(&sw_lock);
+      }
+
+      while (sw_busy > 0)
+         pthread_cond_wait(&sw_done, &sw_lock);
+      pthread_mutex_unlock(&sw_lock);
+
+      return;
+   }
+#endif
+
+   for (band = 0; band < bands; band++)
+      sw_draw_band(sw_band_list[band]);
+}
+
+void osint_render(vecx_context_t *vc)
 {
 #ifdef HAS_GPU    
    if (!usingHWContext)
 #endif        
    {
-      int i;
+      int i, t, tiles, dirty = 0, margin = TILE_MARGIN;
+      long lines = 0;
+      uint64_t *hash, *prev;
+
+      if (sw_smooth)
+      {
+         if (sw_smooth_alloc())
+         {
+            margin       = SMOOTH_MARGIN;
+            smooth_width = point_size;
+         }
+         else
+         {
+            log_cb(RETRO_LOG_ERROR, "Out of memory for the smooth renderer, using the standard one.\n");
+            sw_smooth = false;
+         }
+      }
+
+      if (WIDTH != tile_width || HEIGHT != tile_height ||
+            point_size != tile_point_size)
+      {
+         /* pick the smallest tiles that cover the screen in the grid */
+         tile_shift = 5;
+         while ((WIDTH - 1) >> tile_shift >= TILES_MAX ||
+               (HEIGHT - 1) >> tile_shift >= TILES_MAX)
+            tile_shift++;
+
+         tiles_w = ((WIDTH - 1) >> tile_shift) + 1;
+         tiles_h = ((HEIGHT - 1) >> tile_shift) + 1;
+
+         /* the old contents are laid out differently */
+         tile_width = 0;
+      }
 
-      memset(framebuffer, 0, BUFSZ * sizeof(unsigned short));
+      tiles = tiles_w * tiles_h;
+      hash  = tile_hash[tile_cur];
+      prev  = tile_hash[tile_cur ^ 1];
+      tile_cur ^= 1;
 
-      /* rasterize list of vectors */
-      for (i = 0; i < vector_draw_cnt; i++)
+      memset(hash, 0, tiles * sizeof(uint64_t));
+
+      /* hash the vectors into every tile their bounds touch */
+      for (i = 0; i < vc->vector_draw_cnt; i++)
       {
-         unsigned x0, x1, y0, y1;
-         unsigned char intensity = vectors_draw[i].color;
+         int x0, x1, y0, y1, tx, ty;
+         uint64_t h;
+         unsigned char intensity = vc->vectors_draw[i].color;
+         sw_line_t *l;
 
          if (intensity == 128)
             continue;
 
-         x0 = ((float)vectors_draw[i].x0 / (float)ALG_MAX_X * SCALEX + SHIFTX) * (float)WIDTH;
-         x1 = ((float)vectors_draw[i].x1 / (float)ALG_MAX_X * SCALEX + SHIFTX) * (float)WIDTH;
-         y0 = ((float)vectors_draw[i].y0 / (float)ALG_MAX_Y * SCALEY + SHIFTY) * (float)HEIGHT;
-         y1 = ((float)vectors_draw[i].y1 / (float)ALG_MAX_Y * SCALEY + SHIFTY) * (float)HEIGHT;
+         sw_vector(&vc->vectors_draw[i], &x0, &y0, &x1, &y1);
 
-         if (x0 - x1 == 0 && y0 - y1 == 0)
-            draw_point(x0, y0, RGB1555(intensity));
-         else
-            draw_line(x0, y0, x1, y1, RGB1555(intensity));
+         h  = (uint64_t)(uint16_t)x0 << 48 | (uint64_t)(uint16_t)y0 << 32 |
+            (uint64_t)(uint16_t)x1 << 16 | (uint16_t)y1;
+         h ^= (uint64_t)RGB1555(intensity) * 0x9e3779b97f4a7c15ULL;
+         h *= 0xff51afd7ed558ccdULL;
+         h ^= h >> 32;
+
+         if (!sw_tiles(x0, y0, x1, y1, margin))
+            continue;
+
+         for (ty = sw_ty0; ty <= sw_ty1; ty++)
+            for (tx = sw_tx0; tx <= sw_tx1; tx++)
+            {
+               t = ty * tiles_w + tx;
+               hash[t] = (hash[t] ^ h) * 0x100000001b3ULL;
+            }
+
+         l      = &sw_lines[lines++];
+         l->x0  = x0;
+         l->y0  = y0;
+         l->x1  = x1;
+         l->y1  = y1;
+         l->col = RGB1555(intensity);
+         l->tx0 = sw_tx0;
+         l->tx1 = sw_tx1;
+         l->ty0 = sw_ty0;
+         l->ty1 = sw_ty1;
+
+         if (sw_smooth)
+         {
+            l->intensity = intensity;
+            sw_subpixel(&vc->vectors_draw[i], l);
+         }
+      }
+
+      if (sw_smooth)
+      {
+         /* all of the glow changes, and the tiles have to be drawn
+          * over again once the standard renderer is back
+          */
+         memset(tile_dirty, 1, tiles);
+         tile_clip  = false;
+         tile_width = 0;
+
+         sw_bin(lines);
+         sw_draw();
+         return;
       }
+
+      for (t = 0; t < tiles; t++)
+      {
+         tile_dirty[t] = hash[t] != prev[t] || !tile_width;
+         dirty += tile_dirty[t];
+      }
+
+      tile_width      = WIDTH;
+      tile_height     = HEIGHT;
+      tile_point_size = point_size;
+
+      if (dirty == 0)
+         return;
+
+      tile_clip = dirty < tiles;
+
+      sw_bin(lines);
+      sw_draw();
    }
 #ifdef HAS_GPU    
    else
    {
       int i;
-      GLint num_verts = 0;
+      GLint num_instances = 0;
+      GLint count;
       int continuing = 0;
 
       int colour = 0;
@@ -904,96 +2247,78 @@ void osint_render(void)
 
       glUseProgram(ProgramID);
       glUniformMatrix4fv(mvpMatrixLocation, 1, GL_FALSE, mvp_matrix);
-      glVertexAttribPointer(positionAttribLocation, 2, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(GLVERTEX), &(vertices[0].pos));
-      glEnableVertexAttribArray(positionAttribLocation);
-      glVertexAttribPointer(offsetAttribLocation, 2, GL_BYTE, GL_FALSE, sizeof(GLVERTEX), &(vertices[0].offsets));
-      glEnableVertexAttribArray(offsetAttribLocation);
-      glVertexAttribPointer(colourAttribLocation, 1, GL_BYTE, GL_FALSE, sizeof(GLVERTEX), &(vertices[0].colour));
-      glEnableVertexAttribArray(colourAttribLocation);
-      glVertexAttribPointer(packedTexCoordsAttribLocation, 1, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(GLVERTEX), &(vertices[0].packedTexCoords));
-      glEnableVertexAttribArray(packedTexCoordsAttribLocation);
-
-      for (i = 0; i < vector_draw_cnt; i++)
+
+      for (i = 0; i < vc->vector_draw_cnt; i++)
       {
-         colour = vectors_draw[i].color;
+         GLINSTANCE *in = &instances[num_instances];
+
+         colour = vc->vectors_draw[i].color;
          if (colour == 0 || colour > 127)
             continue;
 
+         in->colour = colour;
+
          /* Is this vector a point? */
-         if (vectors_draw[i].x0 == vectors_draw[i].x1 && vectors_draw[i].y0 == vectors_draw[i].y1
+         if (vc->vectors_draw[i].x0 == vc->vectors_draw[i].x1 && vc->vectors_draw[i].y0 == vc->vectors_draw[i].y1
                /* That isn't joining two lines. */
-               && (vectors_draw[i].x0 != vectors_draw[i-1].x1 || vectors_draw[i].x1 != vectors_draw[i+1].x0 ||
-                  vectors_draw[i].y0 != vectors_draw[i-1].y1 || vectors_draw[i].y1 != vectors_draw[i+1].y0))
+               && (vc->vectors_draw[i].x0 != vc->vectors_draw[i-1].x1 || vc->vectors_draw[i].x1 != vc->vectors_draw[i+1].x0 ||
+                  vc->vectors_draw[i].y0 != vc->vectors_draw[i-1].y1 || vc->vectors_draw[i].y1 != vc->vectors_draw[i+1].y0))
 #if 0
-            if (vectors_draw[i].p0 == vectors_draw[i].p1
-                  && (vectors_draw[i].p0 != vectors_draw[i-1].p1 || vectors_draw[i].p1 != vectors_draw[i+1].p0))
+            if (vc->vectors_draw[i].p0 == vc->vectors_draw[i].p1
+                  && (vc->vectors_draw[i].p0 != vc->vectors_draw[i-1].p1 || vc->vectors_draw[i].p1 != vc->vectors_draw[i+1].p0))
 #endif
             {
-               vertices[num_verts].pos = vectors_draw[i].x0 | vectors_draw[i].y0 << 16;
-               vertices[num_verts].rest = make_all(-dotScale, dotScale, colour, 0x02);
-               num_verts++;
-               vertices[num_verts].pos = vectors_draw[i].x0 | vectors_draw[i].y0 << 16;
-               vertices[num_verts].rest = make_all(dotScale, dotScale, colour, 0x22);
-               num_verts++;
-               vertices[num_verts].pos = vectors_draw[i].x0 | vectors_draw[i].y0 << 16;
-               vertices[num_verts].rest = make_all(-dotScale, -dotScale, colour, 0x00);
-               num_verts++;
-               vertices[num_verts] = vertices[num_verts-2];
-               num_verts++;
-               vertices[num_verts] = vertices[num_verts-2];
-               num_verts++;
-               vertices[num_verts].pos = vectors_draw[i].x0 | vectors_draw[i].y0 << 16;
-               vertices[num_verts].rest = make_all(dotScale, -dotScale, colour, 0x20);
-               num_verts++;
+               in->pos[0] = VECTOR_POS(vc->vectors_draw[i].x0, vc->vectors_draw[i].y0);
+               in->pos[1] = in->pos[0];
+               set_offsets(in->offsets[0], -dotScale, dotScale, dotScale, dotScale);
+               set_offsets(in->offsets[1], -dotScale, -dotScale, dotScale, -dotScale);
+               in->parts = PART_START | PART_POINT;
+               num_instances++;
 
                continuing = 0;
 
                continue;               /* Loop round to the next vector. */
             }
 
+         in->parts = PART_BODY;
+
          /* Draw end cap if we are not continuing the line */
          if (!continuing)
          {
-            dx = vectors_draw[i].x1 - vectors_draw[i].x0;
-            dy = vectors_draw[i].y1 - vectors_draw[i].y0; 
+            dx = vc->vectors_draw[i].x1 - vc->vectors_draw[i].x0;
+            dy = vc->vectors_draw[i].y1 - vc->vectors_draw[i].y0; 
             float length = sqrt(dx*dx+dy*dy);
             dx /= length;
             dy /= length;
 
-            vertices[num_verts].pos = vectors_draw[i].x0 | vectors_draw[i].y0 << 16;
-            vertices[num_verts].rest = make_all((-dy-dx), (dx-dy), colour, 0x20);
-            num_verts++;
-            vertices[num_verts].pos = vectors_draw[i].x0 | vectors_draw[i].y0 << 16;
-            vertices[num_verts].rest = make_all((dy-dx), (-dx-dy), colour, 0x22);
-            num_verts++;
-            vertices[num_verts].pos = vectors_draw[i].x0 | vectors_draw[i].y0 << 16;
-            vertices[num_verts].rest = make_all(-dy, dx, colour, 0x10);
-            num_verts++;
-            vertices[num_verts] = vertices[num_verts-2];
-            num_verts++;
-            vertices[num_verts] = vertices[num_verts-2];
-            num_verts++;
-            vertices[num_verts].pos = vectors_draw[i].x0 | vectors_draw[i].y0 << 16;
-            vertices[num_verts].rest = make_all(dy, -dx, colour, 0x12);
-            num_verts++;
+            in->parts |= PART_START;
+            in->pos[0] = VECTOR_POS(vc->vectors_draw[i].x0, vc->vectors_draw[i].y0);
+            set_offsets(in->offsets[0], (-dy-dx), (dx-dy), (dy-dx), (-dx-dy));
+            set_offsets(in->offsets[1], -dy, dx, dy, -dx);
+         }
+         else
+         {
+            /* The body starts where that of the last line ended. */
+            in->pos[0] = in[-1].pos[1];
+            memcpy(in->offsets[1], in[-1].offsets[2], sizeof(in->offsets[1]));
          }
 
          float nextDx = dx;
          float nextDy = dy;
 
          /* Are we contiguous with the next vector? */
-         if (i < vector_draw_cnt-1 &&                                                                        /* We are not the last vector... */
+         if (i < vc->vector_draw_cnt-1 &&                                                                        /* We are not the last vector... */
 #if 0
-               (vectors_draw[i].p1 == vectors_draw[i+1].p0) &&
-               (vectors_draw[i+1].p0 != vectors_draw[i+1].p1))
+               (vc->vectors_draw[i].p1 == vc->vectors_draw[i+1].p0) &&
+               (vc->vectors_draw[i+1].p0 != vc->vectors_draw[i+1].p1))
 #endif
-            (vectors_draw[i].x1 == vectors_draw[i+1].x0 && vectors_draw[i].y1 == vectors_draw[i+1].y0) &&   /* ...are connected to next vector... */
-               (vectors_draw[i+1].x0 != vectors_draw[i+1].x1 || vectors_draw[i+1].y0 != vectors_draw[i+1].y1)) /* ...and the next vector isn't a point. */
+            (vc->vectors_draw[i].x1 == vc->vectors_draw[i+1].x0 && vc->vectors_draw[i].y1 == vc->vectors_draw[i+1].y0) &&   /* ...are connected to next vector... */
+               (vc->vectors_draw[i+1].x0 != vc->vectors_draw[i+1].x1 || vc->vectors_draw[i+1].y0 != vc->vectors_draw[i+1].y1)) /* ...and the next vector isn't a point. */
                {
                   float dot;
                   VECX_POINT this_vec, next_vec;
-                  float localNextDx = vectors_draw[i+1].x1 - vectors_draw[i+1].x0;
-                  float localNextDy = vectors_draw[i+1].y1 - vectors_draw[i+1].y0; 
+                  float localNextDx = vc->vectors_draw[i+1].x1 - vc->vectors_draw[i+1].x0;
+                  float localNextDy = vc->vectors_draw[i+1].y1 - vc->vectors_draw[i+1].y0; 
                   float length      = sqrt(localNextDx*localNextDx+localNextDy*localNextDy);
                   localNextDx      /= length;
                   localNextDy      /= length;
@@ -1006,8 +2331,8 @@ void osint_render(void)
 
                   if (dot > 0.99f)   /* If (nearly) parallel. */
                   {
-                     vectors_draw[i].x1 = (vectors_draw[i].x1 + vectors_draw[i+1].x0) / 2;
-                     vectors_draw[i].y1 = (vectors_draw[i].y1 + vectors_draw[i+1].y0) / 2;
+                     vc->vectors_draw[i].x1 = (vc->vectors_draw[i].x1 + vc->vectors_draw[i+1].x0) / 2;
+                     vc->vectors_draw[i].y1 = (vc->vectors_draw[i].y1 + vc->vectors_draw[i+1].y0) / 2;
                      nextDx = (dx + localNextDx) / 2.0f;
                      nextDy = (dy + localNextDy) / 2.0f;
 
@@ -1018,23 +2343,23 @@ void osint_render(void)
                   else if (dot >= 0.0f)   /* If change in angle is less than or equal to 90 degrees. */
                   {
                      VECX_POINT p0, p1;
-                     VECX_POINT a = {vectors_draw[i].x0-dy, vectors_draw[i].y0+dx};
-                     VECX_POINT b = {vectors_draw[i].x1-dy, vectors_draw[i].y1+dx};
-                     VECX_POINT c = {vectors_draw[i+1].x0-localNextDy, vectors_draw[i+1].y0+localNextDx};
-                     VECX_POINT d = {vectors_draw[i+1].x1-localNextDy, vectors_draw[i+1].y1+localNextDx};
+                     VECX_POINT a = {vc->vectors_draw[i].x0-dy, vc->vectors_draw[i].y0+dx};
+                     VECX_POINT b = {vc->vectors_draw[i].x1-dy, vc->vectors_draw[i].y1+dx};
+                     VECX_POINT c = {vc->vectors_draw[i+1].x0-localNextDy, vc->vectors_draw[i+1].y0+localNextDx};
+                     VECX_POINT d = {vc->vectors_draw[i+1].x1-localNextDy, vc->vectors_draw[i+1].y1+localNextDx};
 
-                     VECX_POINT a1 = {vectors_draw[i].x0+dy, vectors_draw[i].y0-dx};
-                     VECX_POINT b1 = {vectors_draw[i].x1+dy, vectors_draw[i].y1-dx};
-                     VECX_POINT c1 = {vectors_draw[i+1].x0+localNextDy, vectors_draw[i+1].y0-localNextDx};
-                     VECX_POINT d1 = {vectors_draw[i+1].x1+localNextDy, vectors_draw[i+1].y1-localNextDx};
+                     VECX_POINT a1 = {vc->vectors_draw[i].x0+dy, vc->vectors_draw[i].y0-dx};
+                     VECX_POINT b1 = {vc->vectors_draw[i].x1+dy, vc->vectors_draw[i].y1-dx};
+                     VECX_POINT c1 = {vc->vectors_draw[i+1].x0+localNextDy, vc->vectors_draw[i+1].y0-localNextDx};
+                     VECX_POINT d1 = {vc->vectors_draw[i+1].x1+localNextDy, vc->vectors_draw[i+1].y1-localNextDx};
 
                      intersection_point(&p0, a, b, c, d);
                      intersection_point(&p1, a1, b1, c1, d1);
 
-                     vectors_draw[i].x1   = (p0.x + p1.x) / 2.0f;
-                     vectors_draw[i+1].x0 = vectors_draw[i].x1;
-                     vectors_draw[i].y1   = (p0.y + p1.y) / 2.0f;
-                     vectors_draw[i+1].y0 = vectors_draw[i].y1;
+                     vc->vectors_draw[i].x1   = (long)((p0.x + p1.x) / 2.0f);
+                     vc->vectors_draw[i+1].x0 = vc->vectors_draw[i].x1;
+                     vc->vectors_draw[i].y1   = (long)((p0.y + p1.y) / 2.0f);
+                     vc->vectors_draw[i+1].y0 = vc->vectors_draw[i].y1;
                      nextDy               = ((p1.x - p0.x) / 2.0f);
                      nextDx               = -((p1.y - p0.y) / 2.0f);
 
@@ -1048,51 +2373,28 @@ void osint_render(void)
          else
             continuing = 0;
 
-         /* The previous two vertices are the first two we 
-          * need for the next line.
-          * This applies whether they were part of the 
-          * last line or the end cap of this line.
-          */
-         vertices[num_verts] = vertices[num_verts-2];
-         vertices[num_verts].colour = colour;
-         num_verts++;
-         vertices[num_verts] = vertices[num_verts-2];
-         vertices[num_verts].colour = colour;
-         num_verts++;
-
-         vertices[num_verts].pos = vectors_draw[i].x1 | vectors_draw[i].y1 << 16;
-         vertices[num_verts].rest = make_all(-nextDy, nextDx, colour, 0x10);
-         num_verts++;
-         vertices[num_verts] = vertices[num_verts-2];
-         vertices[num_verts].colour = colour;
-         num_verts++;
-         vertices[num_verts] = vertices[num_verts-2];
-         vertices[num_verts].colour = colour;
-         num_verts++;
-         vertices[num_verts].pos = vectors_draw[i].x1 | vectors_draw[i].y1 << 16;
-         vertices[num_verts].rest = make_all(nextDy, -nextDx, colour, 0x12);
-         num_verts++;
+         in->pos[1] = VECTOR_POS(vc->vectors_draw[i].x1, vc->vectors_draw[i].y1);
+         set_offsets(in->offsets[2], -nextDy, nextDx, nextDy, -nextDx);
 
          if (!continuing)
          {
             /* And now the end cap. */
-            vertices[num_verts]        = vertices[num_verts-2];
-            vertices[num_verts].colour = colour;
-            num_verts++;
-            vertices[num_verts]        = vertices[num_verts-2];
-            vertices[num_verts].colour = colour;
-            num_verts++;
-            vertices[num_verts].pos    = vectors_draw[i].x1 | vectors_draw[i].y1 << 16;
-            vertices[num_verts].rest   = make_all((-nextDy+nextDx), (nextDx+nextDy), colour, 0x00);
-            num_verts++;
-            vertices[num_verts]        = vertices[num_verts-2];
-            num_verts++;
-            vertices[num_verts]        = vertices[num_verts-2];
-            num_verts++;
-            vertices[num_verts].pos    = vectors_draw[i].x1 | vectors_draw[i].y1 << 16;
-            vertices[num_verts].rest   = make_all((nextDy+nextDx), (-nextDx+nextDy), colour, 0x02);
-            num_verts++;
+            in->parts |= PART_END;
+            set_offsets(in->offsets[3], (-nextDy+nextDx), (nextDx+nextDy), (nextDy+nextDx), (-nextDx+nextDy));
          }
+
+         num_instances++;
+      }
+
+      if (instanced)
+      {
+         count = num_instances;
+         bind_instances(count);
+      }
+      else
+      {
+         count = expand_instances(vertices, instances, num_instances);
+         bind_vertices(count);
       }
 
       /* Draw the blooming lines if enabled. */
@@ -1106,7 +2408,7 @@ void osint_render(void)
          glUniform1f(brightnessLocation, bloomBrightness);
          glBlendEquation(GL_FUNC_ADD);
          glBlendFunc(GL_ONE_MINUS_DST_ALPHA, GL_ONE);
-         glDrawArrays(GL_TRIANGLES, 0, num_verts);
+         draw_vectors(count);
       }
 
       /* Draw the lines. */
@@ -1117,12 +2419,13 @@ void osint_render(void)
       glUniform1f(scaleLocation, lineWidth);
       glUniform1f(brightnessLocation, lineBrightness);
       glBlendFunc(GL_ONE, GL_ONE);
-      glDrawArrays(GL_TRIANGLES, 0, num_verts);
+      draw_vectors(count);
 
-      glDisableVertexAttribArray(positionAttribLocation);
-      glDisableVertexAttribArray(colourAttribLocation);
-      glDisableVertexAttribArray(offsetAttribLocation);
-      glDisableVertexAttribArray(packedTexCoordsAttribLocation);
+      if (instanced)
+         unbind_instances();
+      else
+         unbind_vertices();
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
 
       glUseProgram(0);
 
@@ -1144,11 +2447,12 @@ void osint_render(void)
 
 void retro_run(void)
 {
-   int i, ret;
+   int ret;
    bool updated = false;
-   uint8_t buffer[882];
+   int16_t buffer[E8910_MAX_SAMPLES * 2];
+   int frames = sample_rate / 50;
+   retro_time_t start = vecx.clock ? perf_cb.get_time_usec() : 0;
    /* Emulator states */
-   extern unsigned snd_regs[16];
 
    /* poll input and update states;
       buttons (snd_regs[14], 4 buttons/pl => 4 bits starting from LSB, |= for rel. &= ~ for push)
@@ -1158,98 +2462,102 @@ void retro_run(void)
    /* Player 1 */
 
 
-   alg_jch0 = input_state_cb(0, RETRO_DEVICE_ANALOG, RETRO_DEVICE_INDEX_ANALOG_LEFT, RETRO_DEVICE_ID_ANALOG_X) / 256 + 128;
-   alg_jch1 = input_state_cb(0, RETRO_DEVICE_ANALOG, RETRO_DEVICE_INDEX_ANALOG_LEFT, RETRO_DEVICE_ID_ANALOG_Y) / 256 + 128;
+   vecx.alg_jch0 = input_state_cb(0, RETRO_DEVICE_ANALOG, RETRO_DEVICE_INDEX_ANALOG_LEFT, RETRO_DEVICE_ID_ANALOG_X) / 256 + 128;
+   vecx.alg_jch1 = input_state_cb(0, RETRO_DEVICE_ANALOG, RETRO_DEVICE_INDEX_ANALOG_LEFT, RETRO_DEVICE_ID_ANALOG_Y) / 256 + 128;
 
-   if (alg_jch0 == 128)
+   if (vecx.alg_jch0 == 128)
    {
       if (input_state_cb(0, RETRO_DEVICE_JOYPAD, 0,
                RETRO_DEVICE_ID_JOYPAD_LEFT))
-         alg_jch0 = 0x00;
+         vecx.alg_jch0 = 0x00;
       else if (input_state_cb(0, RETRO_DEVICE_JOYPAD, 0,
                RETRO_DEVICE_ID_JOYPAD_RIGHT))
-         alg_jch0 = 0xff;
+         vecx.alg_jch0 = 0xff;
    }
 
-   if (alg_jch1 == 128)
+   if (vecx.alg_jch1 == 128)
    {
       if (input_state_cb(0, RETRO_DEVICE_JOYPAD, 0,
                RETRO_DEVICE_ID_JOYPAD_UP))
-         alg_jch1 = 0xff;
+         vecx.alg_jch1 = 0xff;
       else if (input_state_cb(0, RETRO_DEVICE_JOYPAD, 0,
                RETRO_DEVICE_ID_JOYPAD_DOWN ))
-         alg_jch1 = 0x00;
+         vecx.alg_jch1 = 0x00;
    }
 
    if (input_state_cb(0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_A ))
-      snd_regs[14] &= ~1;
+      vecx.psg.snd_regs[14] &= ~1;
    else
-      snd_regs[14] |= 1;
+      vecx.psg.snd_regs[14] |= 1;
 
    if (input_state_cb(0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_B ))
-      snd_regs[14] &= ~2;
+      vecx.psg.snd_regs[14] &= ~2;
    else
-      snd_regs[14] |= 2;
+      vecx.psg.snd_regs[14] |= 2;
 
    if (input_state_cb(0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_X ))
-      snd_regs[14] &= ~4;
+      vecx.psg.snd_regs[14] &= ~4;
    else
-      snd_regs[14] |= 4;
+      vecx.psg.snd_regs[14] |= 4;
 
    if (input_state_cb(0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_Y ))
-      snd_regs[14] &= ~8;
+      vecx.psg.snd_regs[14] &= ~8;
    else
-      snd_regs[14] |= 8;
+      vecx.psg.snd_regs[14] |= 8;
 
    /* Player 2 */
-   alg_jch2 = input_state_cb(1, RETRO_DEVICE_ANALOG,
+   vecx.alg_jch2 = input_state_cb(1, RETRO_DEVICE_ANALOG,
          RETRO_DEVICE_INDEX_ANALOG_LEFT, RETRO_DEVICE_ID_ANALOG_X) / 256 + 128;
-   alg_jch3 = input_state_cb(1, RETRO_DEVICE_ANALOG,
+   vecx.alg_jch3 = input_state_cb(1, RETRO_DEVICE_ANALOG,
          RETRO_DEVICE_INDEX_ANALOG_LEFT, RETRO_DEVICE_ID_ANALOG_Y) / 256 + 128;
 
-   if (alg_jch2 == 128 && alg_jch3 == 128)
+   if (vecx.alg_jch2 == 128 && vecx.alg_jch3 == 128)
    {
       if (input_state_cb(1, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_LEFT ))
-         alg_jch2 = 0x00;
+         vecx.alg_jch2 = 0x00;
       else if (input_state_cb(1, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_RIGHT))
-         alg_jch2 = 0xff;
+         vecx.alg_jch2 = 0xff;
 
       if (input_state_cb(1, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_UP   ))
-         alg_jch3 = 0xff;
+         vecx.alg_jch3 = 0xff;
       else if (input_state_cb(1, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_DOWN ))
-         alg_jch3 = 0x00;
+         vecx.alg_jch3 = 0x00;
    }
 
    if (input_state_cb(1, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_A ))
-      snd_regs[14] &= ~16;
+      vecx.psg.snd_regs[14] &= ~16;
    else
-      snd_regs[14] |= 16;
+      vecx.psg.snd_regs[14] |= 16;
 
    if (input_state_cb(1, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_B ))
-      snd_regs[14] &= ~32;
+      vecx.psg.snd_regs[14] &= ~32;
    else
-      snd_regs[14] |= 32;
+      vecx.psg.snd_regs[14] |= 32;
 
    if (input_state_cb(1, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_X ))
-      snd_regs[14] &= ~64;
+      vecx.psg.snd_regs[14] &= ~64;
    else
-      snd_regs[14] |= 64;
+      vecx.psg.snd_regs[14] |= 64;
 
    if (input_state_cb(1, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_Y ))
-      snd_regs[14] &= ~128;
+      vecx.psg.snd_regs[14] &= ~128;
    else
-      snd_regs[14] |= 128;
+      vecx.psg.snd_regs[14] |= 128;
 
-   ret = vecx_emu(30000); /* 1500000 / 1000 * 20 */
+   ret = vecx_emu(&vecx, 30000); /* 1500000 / 1000 * 20 */
    (void)ret;
 
-   e8910_callback(NULL, buffer, 882);
-
-   for (i = 0; i < 882; i++)
+   if (vecx.clock)
    {
-      short convs = (buffer[i] << 8) - 0x7ff;
-      audio_cb(convs, convs);
+      uint64_t sound = profile_clock();
+
+      e8910_callback(&vecx.psg, buffer, frames);
+      profile_sound_time += profile_clock() - sound;
    }
+   else
+      e8910_callback(&vecx.psg, buffer, frames);
+
+   audio_batch_cb(buffer, frames);
 
 #ifdef HAS_GPU	
    if (usingHWContext)
@@ -1258,6 +2566,18 @@ void retro_run(void)
 #endif        
       video_cb(framebuffer, WIDTH, HEIGHT, WIDTH * sizeof(unsigned short));
 
+   if (profile)
+   {
+      if (vecx.clock)
+         profile_usec += perf_cb.get_time_usec() - start;
+
+      if (++profile_frames == PROFILE_FRAMES)
+      {
+         profile_report();
+         profile_reset();
+      }
+   }
+
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE, &updated) && updated)
-      check_variables();
+      check_variables(true);
 }
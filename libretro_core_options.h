@@ -53,6 +53,72 @@ struct retro_core_option_definition option_defs_us[] = {
       },
       "1"
    },
+#ifdef HAVE_THREADS
+   {
+      "vecx_sw_threads",
+      "Software Renderer Threads",
+      "Threads drawing the picture in the software renderer, each taking a band of the screen at a time. Helps at the higher resolution multipliers. 'auto' uses one per processor.",
+      {
+         { "1",    NULL },
+         { "2",    NULL },
+         { "3",    NULL },
+         { "4",    NULL },
+         { "6",    NULL },
+         { "8",    NULL },
+         { "auto", NULL },
+         { NULL, NULL },
+      },
+      "1"
+   },
+#endif
+   {
+      "vecx_sw_quality",
+      "Software Renderer Quality",
+      "'Smooth' draws antialiased lines at their exact position and brightness, adding up where they cross, and lets them fade out on the phosphor. It costs several times as much as 'Standard'.",
+      {
+         { "Standard", NULL },
+         { "Smooth",   NULL },
+         { NULL, NULL },
+      },
+      "Standard"
+   },
+   {
+      "vecx_sw_persistence",
+      "Phosphor Persistence",
+      "How much of its brightness a line keeps after each 1/30 s the beam has not drawn it again, in the 'Smooth' software renderer. Higher values leave longer trails behind moving objects.",
+      {
+         { "0%",  NULL },
+         { "25%", NULL },
+         { "50%", NULL },
+         { "75%", NULL },
+         { "90%", NULL },
+         { NULL, NULL },
+      },
+      "25%"
+   },
+   {
+      "vecx_sample_rate",
+      "Audio Sample Rate",
+      "Rate the sound chip output is synthesised at. Matching the output device avoids resampling in the frontend.",
+      {
+         { "22050", NULL },
+         { "44100", NULL },
+         { "48000", NULL },
+         { NULL, NULL },
+      },
+      "44100"
+   },
+   {
+      "vecx_profile",
+      "Profiling",
+      "Log where the time of each frame goes, and what the emulation was busy with, every 5 seconds. Reading the timers costs a little time itself.",
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
 #ifdef HAS_GPU   
    {
        "vecx_res_hw",
@@ -1,6 +1,8 @@
 #ifndef __OSINT_H
 #define __OSINT_H
 
-void osint_render (void);
+struct vecx_context;
+
+void osint_render (struct vecx_context *vc);
 
 #endif
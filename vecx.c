@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 
 #include "e6809.h"
@@ -17,271 +18,216 @@
 
 enum
 {
-   VECTREX_PDECAY	 = 30,      /* phosphor decay rate */
-
    /* number of 6809 cycles before a frame redraw */
 
    FCYCLES_INIT    = VECTREX_MHZ / VECTREX_PDECAY,
 
-   /* max number of possible vectors that maybe on the screen at one time.
-    * one only needs VECTREX_MHZ / VECTREX_PDECAY but we need to also store
-    * deleted vectors in a single table
+   /* there are thousands of catchups a frame, too many to read a clock
+    * around each. only one in this many is timed and stands for the rest.
     */
 
-   VECTOR_CNT		 = VECTREX_MHZ / VECTREX_PDECAY,
-
-   VECTOR_HASH     = 65521
+   PROFILE_STRIDE  = 64
 };
 
-
 unsigned char rom[8192];
-unsigned char cart[65536];
-unsigned char vecx_ram[1024];
-
-unsigned newbankswitchOffset = 0;
-unsigned bankswitchOffset    = 0;
-char big                     = 0;
-
-unsigned bankswitchstate = BS_0;
-
-/* the via 6522 registers */
-
-static unsigned via_ora;
-static unsigned via_orb;
-static unsigned via_ddra;
-static unsigned via_ddrb;
-static unsigned via_t1on;  /* is timer 1 on? */
-static unsigned via_t1int; /* are timer 1 interrupts allowed? */
-static unsigned via_t1c;
-static unsigned via_t1ll;
-static unsigned via_t1lh;
-static unsigned via_t1pb7; /* timer 1 controlled version of pb7 */
-static unsigned via_t2on;  /* is timer 2 on? */
-static unsigned via_t2int; /* are timer 2 interrupts allowed? */
-static unsigned via_t2c;
-static unsigned via_t2ll;
-static unsigned via_sr;
-static unsigned via_srb;   /* number of bits shifted so far */
-static unsigned via_src;   /* shift counter */
-static unsigned via_srclk;
-static unsigned via_acr;
-static unsigned via_pcr;
-static unsigned via_ifr;
-static unsigned via_ier;
-static unsigned via_ca2;
-static unsigned via_cb2h;  /* basic handshake version of cb2 */
-static unsigned via_cb2s;  /* version of cb2 controlled by the shift register */
-
-/* analog devices */
-
-static unsigned alg_rsh;  /* zero ref sample and hold */
-static unsigned alg_xsh;  /* x sample and hold */
-static unsigned alg_ysh;  /* y sample and hold */
-static unsigned alg_zsh;  /* z sample and hold */
-unsigned alg_jch0;		  /* joystick direction channel 0 */
-unsigned alg_jch1;		  /* joystick direction channel 1 */
-unsigned alg_jch2;		  /* joystick direction channel 2 */
-unsigned alg_jch3;		  /* joystick direction channel 3 */
-static unsigned alg_jsh;  /* joystick sample and hold */
-
-static unsigned alg_compare;
-
-static long alg_dx;     /* delta x */
-static long alg_dy;     /* delta y */
-static long alg_curr_x; /* current x position */
-static long alg_curr_y; /* current y position */
-
-static unsigned alg_vectoring; /* are we drawing a vector right now? */
-static long alg_vector_x0;
-static long alg_vector_y0;
-static long alg_vector_x1;
-static long alg_vector_y1;
-static long alg_vector_dx;
-static long alg_vector_dy;
-static unsigned char alg_vector_color;
-
-long vector_draw_cnt;
-long vector_erse_cnt;
-static vector_t vectors_set[2 * VECTOR_CNT];
-vector_t *vectors_draw;
-vector_t *vectors_erse;
-
-static long vector_hash[VECTOR_HASH];
-
-static long fcycles;
-
-static unsigned snd_select;
-unsigned snd_regs[16];
-
-unsigned char get_cart(unsigned pos)
+
+static void vecx_catchup (vecx_context_t *vc);
+static void map_cart (vecx_context_t *vc);
+
+static einline unsigned vector_key (long x0, long y0, long x1, long y1)
 {
-   return cart[ (pos + bankswitchOffset) % 65536];
+   unsigned key;
+
+   key = (unsigned) x0;
+   key = key * 31 + (unsigned) y0;
+   key = key * 31 + (unsigned) x1;
+   key = key * 31 + (unsigned) y1;
+
+   return ((key * 2654435761u) >> 16) & (VECTOR_HASH - 1);
 }
 
-void set_cart(unsigned pos, unsigned char data)
+static void vector_hash_reset (vecx_context_t *vc)
+{
+   memset(vc->vector_hash_set, 0, sizeof(vc->vector_hash_set));
+
+   vc->vector_hash_draw = vc->vector_hash_set[0];
+   vc->vector_hash_erse = vc->vector_hash_set[1];
+
+   /* stamp 0 marks a never used slot */
+   vc->vector_draw_gen = 2;
+   vc->vector_erse_gen = 1;
+}
+
+/* the draw list became the erase list */
+
+static void vector_hash_swap (vecx_context_t *vc)
+{
+   vector_slot_t *tmp = vc->vector_hash_erse;
+
+   vc->vector_hash_erse = vc->vector_hash_draw;
+   vc->vector_hash_draw = tmp;
+
+   vc->vector_erse_gen = vc->vector_draw_gen++;
+
+   if (vc->vector_draw_gen == 0)
+   {
+      unsigned i;
+
+      /* the stamps are about to be reused, free every slot that is not
+       * part of the erase list.
+       */
+
+      for (i = 0; i < VECTOR_HASH; i++)
+      {
+         if (vc->vector_hash_erse[i].gen != vc->vector_erse_gen)
+            vc->vector_hash_erse[i].gen = 0;
+      }
+
+      memset(vc->vector_hash_draw, 0, VECTOR_HASH * sizeof(vector_slot_t));
+      vc->vector_draw_gen = 1;
+   }
+}
+
+/* refill the dedup tables after the draw list was loaded. two swaps give
+ * both tables a stamp that is not in use, which frees every slot.
+ */
+
+static void vector_hash_load (vecx_context_t *vc)
+{
+   long i;
+
+   vector_hash_swap (vc);
+   vector_hash_swap (vc);
+
+   for (i = 0; i < vc->vector_draw_cnt; i++)
+   {
+      const vector_t *v = vc->vectors_draw + i;
+      unsigned slot = vector_key (v->x0, v->y0, v->x1, v->y1);
+
+      while (vc->vector_hash_draw[slot].gen == vc->vector_draw_gen)
+         slot = (slot + 1) & (VECTOR_HASH - 1);
+
+      vc->vector_hash_draw[slot].gen = vc->vector_draw_gen;
+      vc->vector_hash_draw[slot].index = (unsigned short) i;
+   }
+}
+
+unsigned char get_cart(vecx_context_t *vc, unsigned pos)
+{
+   return vc->cart[ (pos + vc->bankswitchOffset) % 65536];
+}
+
+void set_cart(vecx_context_t *vc, unsigned pos, unsigned char data)
 {
    if(pos == 32768 && data != 0) // 64k carts should have data at this offset
-      big = 1;
-   cart[(pos)%65536] = data; 
+      vc->big = 1;
+   vc->cart[(pos)%65536] = data; 
 }
 
+/* a state is a header followed by the cpu, the psg and the rest of the
+ * machine state, each copied as they are, and then the part of the draw
+ * list drawn so far. the copies tie it to the build that saved it, which
+ * the header checks for.
+ */
+
+#define STATE_VERSION 2
+
+/* the machine state in vecx_context_t, see vecx.h */
+#define STATE_BEGIN   offsetof (vecx_context_t, ram)
+#define STATE_END     offsetof (vecx_context_t, cart)
+
+typedef struct state_header_type {
+   char magic[4];
+   uint32_t version;
+   uint32_t size; /* of the whole state, changes with the layout */
+} state_header_t;
+
+static const char state_magic[4] = { 'V', 'E', 'C', 'X' };
+
 int vecx_statesz(void)
 {
-   return 1025 + (sizeof(unsigned) * 37) + (sizeof(long) * 12) +
-      e6809_statesz() + e8910_statesz();
+   return sizeof(state_header_t) + e6809_statesz() + e8910_statesz() +
+      (STATE_END - STATE_BEGIN) + VECTOR_CNT * sizeof(vector_t);
 }
 
-/* hide all the ugly at the bottom.
- * usual bit of tedium, should really do htons as well,
- * along with the usual reinventing of C99 stdint */
-int vecx_serialize(char* dst, int size)
+int vecx_serialize(vecx_context_t *vc, char* dst, int size)
 {
+   state_header_t header;
+   size_t used;
+
    if (size < vecx_statesz())
       return 0;
 
-   e6809_serialize(dst);
+   memcpy(header.magic, state_magic, sizeof(header.magic));
+   header.version = STATE_VERSION;
+   header.size = vecx_statesz();
+
+   memcpy(dst, &header, sizeof(header));
+   dst += sizeof(header);
+
+   e6809_serialize(&vc->cpu, dst);
    dst += e6809_statesz();
-   e8910_serialize(dst);
+   e8910_serialize(&vc->psg, dst);
    dst += e8910_statesz();
 
-   memcpy(dst, vecx_ram, 1024);
-   dst += 1024;
-
-   memcpy(dst, &snd_select, sizeof(int));
-   dst += sizeof(int); 
-   memcpy(dst, &via_ora,    sizeof(int));
-   dst += sizeof(int);
-   memcpy(dst, &via_orb,    sizeof(int));
-   dst += sizeof(int);
-   memcpy(dst, &via_ddra,   sizeof(int));
-   dst += sizeof(int);
-   memcpy(dst, &via_ddrb,   sizeof(int));
-   dst += sizeof(int);
-   memcpy(dst, &via_t1on,   sizeof(int));
-   dst += sizeof(int);
-   memcpy(dst, &via_t1int,  sizeof(int));
-   dst += sizeof(int);
-   memcpy(dst, &via_t1c,    sizeof(int));
-   dst += sizeof(int);
-   memcpy(dst, &via_t1ll,   sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &via_t1lh,   sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &via_t1pb7,  sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &via_t2on,   sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &via_t2int,  sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &via_t2c,    sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &via_t2ll,   sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &via_t2ll,   sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &via_sr,     sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &via_srb,    sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &via_src,    sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &via_srclk,  sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &via_acr,    sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &via_pcr,    sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &via_ifr,    sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &via_ier,    sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &via_ca2,    sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &via_cb2h,   sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &via_cb2s,   sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &alg_rsh,    sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &alg_rsh,    sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &alg_xsh,    sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &alg_ysh,    sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &alg_zsh,    sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &alg_jch0,   sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &alg_jch1,   sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &alg_jch2,   sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &alg_jch3,   sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &alg_jsh,    sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &alg_compare, sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &alg_vectoring, sizeof(int)); dst += sizeof(int);
-   memcpy(dst, &alg_curr_x,    sizeof(long)); dst += sizeof(long);
-   memcpy(dst, &alg_curr_y,    sizeof(long)); dst += sizeof(long);
-   memcpy(dst, &alg_vector_x0, sizeof(long)); dst += sizeof(long);
-   memcpy(dst, &alg_vector_y0, sizeof(long)); dst += sizeof(long);
-   memcpy(dst, &alg_vector_x1, sizeof(long)); dst += sizeof(long);
-   memcpy(dst, &alg_vector_y1, sizeof(long)); dst += sizeof(long);
-   memcpy(dst, &alg_vector_dx, sizeof(long)); dst += sizeof(long);
-   memcpy(dst, &alg_vector_dy, sizeof(long)); dst += sizeof(long);
-   memcpy(dst, &vector_draw_cnt, sizeof(long)); dst += sizeof(long);
-   memcpy(dst, &vector_erse_cnt, sizeof(long)); dst += sizeof(long);
-   *dst = alg_vector_color;
+   memcpy(dst, (char *) vc + STATE_BEGIN, STATE_END - STATE_BEGIN);
+   dst += STATE_END - STATE_BEGIN;
+
+   /* the rest of the list is cleared so that equal states save equal */
+   used = vc->vector_draw_cnt * sizeof(vector_t);
+   memcpy(dst, vc->vectors_draw, used);
+   memset(dst + used, 0, VECTOR_CNT * sizeof(vector_t) - used);
 
    return 1;
 }
 
-int vecx_deserialize(char* dst, int size)
+int vecx_deserialize(vecx_context_t *vc, char* dst, int size)
 {
+   state_header_t header;
+   char *state;
+   long cnt;
+
    if (size < vecx_statesz())
       return 0;
 
-   e6809_deserialize(dst);
-   dst += e6809_statesz();
-   e8910_deserialize(dst);
-   dst += e8910_statesz();
+   memcpy(&header, dst, sizeof(header));
+
+   if (memcmp(header.magic, state_magic, sizeof(header.magic)) != 0 ||
+         header.version != STATE_VERSION || header.size != (uint32_t) vecx_statesz())
+      return 0;
 
-   memcpy(vecx_ram, dst, 1024);
-   dst += 1024;
-
-   memcpy(&snd_select,dst,  sizeof(int));
-   dst += sizeof(int);
-   memcpy(&via_ora,   dst,  sizeof(int));
-   dst += sizeof(int);
-   memcpy(&via_orb,   dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_ddra,  dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_ddrb,  dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_t1on,  dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_t1int, dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_t1c,   dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_t1ll,  dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_t1lh,  dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_t1pb7, dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_t2on,  dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_t2int, dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_t2c,   dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_t2ll,  dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_t2ll,  dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_sr,    dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_srb,   dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_src,   dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_srclk, dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_acr,   dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_pcr,   dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_ifr,   dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_ier,   dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_ca2,   dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_cb2h,  dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&via_cb2s,  dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&alg_rsh,   dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&alg_rsh,   dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&alg_xsh,   dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&alg_ysh,   dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&alg_zsh,   dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&alg_jch0,  dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&alg_jch1,  dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&alg_jch2,  dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&alg_jch3,  dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&alg_jsh,   dst,  sizeof(int)); dst += sizeof(int);
-   memcpy(&alg_compare, dst,sizeof(int)); dst += sizeof(int);
-   memcpy(&alg_vectoring, dst, sizeof(int)); dst += sizeof(int);
-   memcpy(&alg_curr_x, dst, sizeof(long)); dst += sizeof(long);
-   memcpy(&alg_curr_y, dst, sizeof(long)); dst += sizeof(long);
-   memcpy(&alg_vector_x0, dst, sizeof(long)); dst += sizeof(long);
-   memcpy(&alg_vector_y0, dst, sizeof(long)); dst += sizeof(long);
-   memcpy(&alg_vector_x1, dst, sizeof(long)); dst += sizeof(long);
-   memcpy(&alg_vector_y1, dst, sizeof(long)); dst += sizeof(long);
-   memcpy(&alg_vector_dx, dst, sizeof(long)); dst += sizeof(long);
-   memcpy(&alg_vector_dy, dst, sizeof(long)); dst += sizeof(long);
-   memcpy(&vector_draw_cnt, dst, sizeof(long)); dst += sizeof(long);
-   memcpy(&vector_erse_cnt, dst, sizeof(long)); dst += sizeof(long);
-   alg_vector_color = *dst;
+   dst += sizeof(header);
+   state = dst + e6809_statesz() + e8910_statesz();
+
+   /* check the list before anything is overwritten */
+   memcpy(&cnt, state + offsetof (vecx_context_t, vector_draw_cnt) -
+         STATE_BEGIN, sizeof(cnt));
+
+   if (cnt < 0 || cnt > VECTOR_CNT)
+      return 0;
+
+   e6809_deserialize(&vc->cpu, dst);
+   e8910_deserialize(&vc->psg, dst + e6809_statesz());
+
+   memcpy((char *) vc + STATE_BEGIN, state, STATE_END - STATE_BEGIN);
+   state += STATE_END - STATE_BEGIN;
+
+   memcpy(vc->vectors_draw, state, cnt * sizeof(vector_t));
+   vector_hash_load (vc);
+
+   /* the quiet window belongs to the old state */
+   vc->via_lag = 0;
+   vc->via_window = 0;
+
+   map_cart (vc);
 
    return 1;
 }
 
 /* update the snd chips internal registers when via_ora/via_orb changes */
-static einline void snd_update(void)
+static einline void snd_update(vecx_context_t *vc)
 {
-   switch (via_orb & 0x18)
+   switch (vc->via_orb & 0x18)
    {
       case 0x00:
          /* the sound chip is disabled */
@@ -291,18 +237,15 @@ static einline void snd_update(void)
          break;
       case 0x10:
          /* the sound chip is recieving data */
-         if (snd_select != 14)
-         {
-            snd_regs[snd_select] = via_ora;
-            e8910_write(snd_select, via_ora);
-         }
+         if (vc->snd_select != 14)
+            e8910_write_at(&vc->psg, vc->snd_cycle, vc->snd_select, vc->via_ora);
 
          break;
       case 0x18:
          /* the sound chip is latching an address */
 
-         if ((via_ora & 0xf0) == 0x00)
-            snd_select = via_ora & 0x0f;
+         if ((vc->via_ora & 0xf0) == 0x00)
+            vc->snd_select = vc->via_ora & 0x0f;
 
          break;
    }
@@ -310,571 +253,635 @@ static einline void snd_update(void)
 
 /* update the various analog values when orb is written. */
 
-static einline void alg_update (void)
+static einline void alg_update (vecx_context_t *vc)
 {
-   switch (via_orb & 0x06)
+   switch (vc->via_orb & 0x06)
    {
       case 0x00:
-         alg_jsh = alg_jch0;
+         vc->alg_jsh = vc->alg_jch0;
 
          /* demultiplexor is on */
-         if ((via_orb & 0x01) == 0x00)
-            alg_ysh = alg_xsh;
+         if ((vc->via_orb & 0x01) == 0x00)
+            vc->alg_ysh = vc->alg_xsh;
 
          break;
       case 0x02:
-         alg_jsh = alg_jch1;
+         vc->alg_jsh = vc->alg_jch1;
 
          /* demultiplexor is on */
-         if ((via_orb & 0x01) == 0x00)
-            alg_rsh = alg_xsh;
+         if ((vc->via_orb & 0x01) == 0x00)
+            vc->alg_rsh = vc->alg_xsh;
 
          break;
       case 0x04:
-         alg_jsh = alg_jch2;
+         vc->alg_jsh = vc->alg_jch2;
 
-         if ((via_orb & 0x01) == 0x00)
+         if ((vc->via_orb & 0x01) == 0x00)
          {
             /* demultiplexor is on */
 
-            if (alg_xsh > 0x80)
-               alg_zsh = alg_xsh - 0x80;
+            if (vc->alg_xsh > 0x80)
+               vc->alg_zsh = vc->alg_xsh - 0x80;
             else
-               alg_zsh = 0;
+               vc->alg_zsh = 0;
          }
 
          break;
       case 0x06:
          /* sound output line */
-         alg_jsh = alg_jch3;
+         vc->alg_jsh = vc->alg_jch3;
          break;
    }
 
    /* compare the current joystick direction with a reference */
 
-   if (alg_jsh > alg_xsh)
-      alg_compare = 0x20;
+   if (vc->alg_jsh > vc->alg_xsh)
+      vc->alg_compare = 0x20;
    else
-      alg_compare = 0;
+      vc->alg_compare = 0;
 
    /* compute the new "deltas" */
 
-   alg_dx = (long) alg_xsh - (long) alg_rsh;
-   alg_dy = (long) alg_rsh - (long) alg_ysh;
+   vc->alg_dx = (long) vc->alg_xsh - (long) vc->alg_rsh;
+   vc->alg_dy = (long) vc->alg_rsh - (long) vc->alg_ysh;
 }
 
 /* update IRQ and bit-7 of the ifr register after making an adjustment to
  * ifr.
  */
 
-static einline void int_update (void)
+static einline void int_update (vecx_context_t *vc)
 {
-   if ((via_ifr & 0x7f) & (via_ier & 0x7f))
-      via_ifr |= 0x80;
+   if ((vc->via_ifr & 0x7f) & (vc->via_ier & 0x7f))
+      vc->via_ifr |= 0x80;
    else
-      via_ifr &= 0x7f;
+      vc->via_ifr &= 0x7f;
+}
+
+/* point the cartridge pages at the current bank */
+
+static void map_cart (vecx_context_t *vc)
+{
+   unsigned page;
+
+   for (page = 0x00; page < 0x80; page++)
+      vc->read_map[page] = vc->cart + ((vc->bankswitchOffset + (page << 8)) % 65536);
 }
 
-unsigned char read8 (unsigned address)
+static void map_init (vecx_context_t *vc)
 {
-   unsigned char data = 0;
+   unsigned page;
+
+   memset(vc->page_ff, 0xff, sizeof(vc->page_ff));
+   memset(vc->page_00, 0x00, sizeof(vc->page_00));
 
-   /* rom */
-   if ((address & 0xe000) == 0xe000)
-      data = rom[address & 0x1fff];
-   else if ((address & 0xe000) == 0xc000)
+   for (page = 0x00; page < 0x100; page++)
    {
-      /* ram */
-      if (address & 0x800)
-         data = vecx_ram[address & 0x3ff];
-      else if (address & 0x1000)
+      unsigned address = page << 8;
+
+      vc->write_map[page] = vc->page_sink;
+
+      if ((address & 0xe000) == 0xe000)
+         vc->read_map[page] = rom + (address & 0x1fff); /* rom */
+      else if ((address & 0xe000) == 0xc000)
       {
-         /* io */
+         /* ram and io are selected by address bits 11 and 12. it is
+          * possible for both to be written at the same time.
+          */
 
-         switch (address & 0xf)
-         {
-            case 0x0:
-               /* compare signal is an input so the value does not come from
-                * via_orb.
-                */
-               /* timer 1 has control of bit 7 */
-               if (via_acr & 0x80)
-                  data = (unsigned char) ((via_orb & 0x5f) | via_t1pb7 | alg_compare);
-               else /* bit 7 is being driven by via_orb */
-                  data = (unsigned char) ((via_orb & 0xdf) | alg_compare);
-
-               break;
-            case 0x1:
-               /* register 1 also performs handshakes if necessary */
-
-               /* if ca2 is in pulse mode or handshake mode, then it
-                * goes low whenever ira is read.
-                */
-               if ((via_pcr & 0x0e) == 0x08)
-                  via_ca2 = 0;
-
-               /* fall through */
-
-            case 0xf:
-               /* the snd chip is driving port a */
-               if ((via_orb & 0x18) == 0x08)
-                  data = (unsigned char) snd_regs[snd_select];
-               else
-                  data = (unsigned char) via_ora;
-
-               break;
-            case 0x2:
-               data = (unsigned char) via_ddrb;
-               break;
-            case 0x3:
-               data = (unsigned char) via_ddra;
-               break;
-            case 0x4:
-               /* T1 low order counter */
-
-               data      = (unsigned char) via_t1c;
-               via_ifr  &= 0xbf; /* remove timer 1 interrupt flag */
-
-               via_t1on  = 0; /* timer 1 is stopped */
-               via_t1int = 0;
-               via_t1pb7 = 0x80;
-
-               int_update();
-
-               break;
-            case 0x5:
-               /* T1 high order counter */
-               data = (unsigned char) (via_t1c >> 8);
-               break;
-            case 0x6:
-               /* T1 low order latch */
-               data = (unsigned char) via_t1ll;
-               break;
-            case 0x7:
-               /* T1 high order latch */
-               data = (unsigned char) via_t1lh;
-               break;
-            case 0x8:
-               /* T2 low order counter */
-               data      = (unsigned char) via_t2c;
-               via_ifr  &= 0xdf; /* remove timer 2 interrupt flag */
-
-               via_t2on  = 0; /* timer 2 is stopped */
-               via_t2int = 0;
-
-               int_update ();
-
-               break;
-            case 0x9:
-               /* T2 high order counter */
-               data = (unsigned char) (via_t2c >> 8);
-               break;
-            case 0xa:
-               data      = (unsigned char) via_sr;
-               via_ifr  &= 0xfb; /* remove shift register interrupt flag */
-               via_srb   = 0;
-               via_srclk = 1;
-
-               int_update ();
-
-               break;
-            case 0xb:
-               data = (unsigned char) via_acr;
-               break;
-            case 0xc:
-               data = (unsigned char) via_pcr;
-               break;
-            case 0xd:
-               /* interrupt flag register */
-
-               data = (unsigned char) via_ifr;
-               break;
-            case 0xe:
-               /* interrupt enable register */
-
-               data = (unsigned char) (via_ier | 0x80);
-               break;
-         }
+         if (address & 0x800)
+            vc->read_map[page] = vc->ram + (address & 0x3ff);
+         else if (address & 0x1000)
+            vc->read_map[page] = NULL;
+         else
+            vc->read_map[page] = vc->page_00;
+
+         if (address & 0x1000)
+            vc->write_map[page] = NULL;
+         else if (address & 0x800)
+            vc->write_map[page] = vc->ram + (address & 0x3ff);
       }
+      else
+         vc->read_map[page] = vc->page_ff;
+   }
+
+   map_cart (vc);
+}
+
+static unsigned char io_read8 (vecx_context_t *vc, unsigned address)
+{
+   unsigned char data = 0;
+
+   switch (address & 0xf)
+   {
+      case 0x0:
+         /* compare signal is an input so the value does not come from
+          * via_orb.
+          */
+         /* timer 1 has control of bit 7 */
+         if (vc->via_acr & 0x80)
+            data = (unsigned char) ((vc->via_orb & 0x5f) | vc->via_t1pb7 |
+                  vc->alg_compare);
+         else /* bit 7 is being driven by via_orb */
+            data = (unsigned char) ((vc->via_orb & 0xdf) | vc->alg_compare);
+
+         break;
+      case 0x1:
+         /* register 1 also performs handshakes if necessary */
+
+         /* if ca2 is in pulse mode or handshake mode, then it
+          * goes low whenever ira is read.
+          */
+         if ((vc->via_pcr & 0x0e) == 0x08)
+            vc->via_ca2 = 0;
+
+         /* fall through */
+
+      case 0xf:
+         /* the snd chip is driving port a */
+         if ((vc->via_orb & 0x18) == 0x08)
+            data = (unsigned char) vc->psg.snd_regs[vc->snd_select];
+         else
+            data = (unsigned char) vc->via_ora;
+
+         break;
+      case 0x2:
+         data = (unsigned char) vc->via_ddrb;
+         break;
+      case 0x3:
+         data = (unsigned char) vc->via_ddra;
+         break;
+      case 0x4:
+         /* T1 low order counter */
+
+         data      = (unsigned char) vc->via_t1c;
+         vc->via_ifr  &= 0xbf; /* remove timer 1 interrupt flag */
+
+         vc->via_t1on  = 0; /* timer 1 is stopped */
+         vc->via_t1int = 0;
+         vc->via_t1pb7 = 0x80;
+
+         int_update(vc);
+
+         break;
+      case 0x5:
+         /* T1 high order counter */
+         data = (unsigned char) (vc->via_t1c >> 8);
+         break;
+      case 0x6:
+         /* T1 low order latch */
+         data = (unsigned char) vc->via_t1ll;
+         break;
+      case 0x7:
+         /* T1 high order latch */
+         data = (unsigned char) vc->via_t1lh;
+         break;
+      case 0x8:
+         /* T2 low order counter */
+         data      = (unsigned char) vc->via_t2c;
+         vc->via_ifr  &= 0xdf; /* remove timer 2 interrupt flag */
+
+         vc->via_t2on  = 0; /* timer 2 is stopped */
+         vc->via_t2int = 0;
+
+         int_update (vc);
+
+         break;
+      case 0x9:
+         /* T2 high order counter */
+         data = (unsigned char) (vc->via_t2c >> 8);
+         break;
+      case 0xa:
+         data      = (unsigned char) vc->via_sr;
+         vc->via_ifr  &= 0xfb; /* remove shift register interrupt flag */
+         vc->via_srb   = 0;
+         vc->via_srclk = 1;
+
+         int_update (vc);
+
+         break;
+      case 0xb:
+         data = (unsigned char) vc->via_acr;
+         break;
+      case 0xc:
+         data = (unsigned char) vc->via_pcr;
+         break;
+      case 0xd:
+         /* interrupt flag register */
+
+         data = (unsigned char) vc->via_ifr;
+         break;
+      case 0xe:
+         /* interrupt enable register */
+
+         data = (unsigned char) (vc->via_ier | 0x80);
+         break;
    }
-   else if (address < 0x8000) /* cartridge */
-      data = get_cart(address);
-   else
-      data = 0xff;
 
    return data;
 }
 
-void write8 (unsigned address, unsigned char data)
+static unsigned char read8 (void *user, unsigned address)
 {
-   /* rom */
-	if ((address & 0xe000) == 0xe000) { }
-	else if ((address & 0xe000) == 0xc000)
+   vecx_context_t *vc = (vecx_context_t *) user;
+   const unsigned char *page = vc->read_map[address >> 8];
+   unsigned char data;
+
+   if (page)
+      return page[address & 0xff];
+
+   vecx_catchup (vc);
+   data = io_read8 (vc, address);
+   vc->via_window = 0;
+
+   return data;
+}
+
+static void io_write8 (vecx_context_t *vc, unsigned address, unsigned char data)
+{
+   /* it is possible for both ram and io to be written at the same! */
+
+   if (address & 0x800)
+      vc->ram[address & 0x3ff] = data;
+
+   switch (address & 0xf)
    {
-      /* it is possible for both ram and io to be written at the same! */
+      case 0x0:
+         if(vc->bankswitchstate == BS_2)
+         {
+            if (data == 1)
+               vc->bankswitchstate = BS_3;
+            else
+               vc->bankswitchstate = BS_0;
+         }
+         else
+            vc->bankswitchstate = BS_0;
+         vc->via_orb = data;
 
-      if (address & 0x800)
-         vecx_ram[address & 0x3ff] = data;
+         snd_update (vc);
+         alg_update (vc);
 
-      if (address & 0x1000)
-      {
-         switch (address & 0xf)
+         /* if cb2 is in pulse mode or handshake mode, then it
+          * goes low whenever orb is written.
+          */
+         if ((vc->via_pcr & 0xe0) == 0x80)
+            vc->via_cb2h = 0;
+
+         break;
+      case 0x1:
+         /* register 1 also performs handshakes if necessary */
+
+         if(vc->bankswitchstate == BS_3)
          {
-            case 0x0:
-               if(bankswitchstate == BS_2)
-               {
-                  if (data == 1)
-                     bankswitchstate = BS_3;
-                  else
-                     bankswitchstate = BS_0;
-               }
-               else
-                  bankswitchstate = BS_0;
-               via_orb = data;
-
-               snd_update ();
-               alg_update ();
-
-               /* if cb2 is in pulse mode or handshake mode, then it
-                * goes low whenever orb is written.
-                */
-               if ((via_pcr & 0xe0) == 0x80)
-                  via_cb2h = 0;
-
-               break;
-            case 0x1:
-               /* register 1 also performs handshakes if necessary */
-
-               if(bankswitchstate == BS_3)
-               {
-                  if (data == 0)
-                     bankswitchstate = BS_4;
-                  else
-                     bankswitchstate = BS_0;
-               }
-               else
-                  bankswitchstate = BS_0;
-
-               /* if ca2 is in pulse mode or handshake mode, then it
-                * goes low whenever ora is written.
-                */
-               if ((via_pcr & 0x0e) == 0x08)
-                  via_ca2 = 0;
-
-               /* fall through */
-
-            case 0xf:
-               via_ora = data;
-
-               snd_update ();
-
-               /* output of port a feeds directly into the dac which then
-                * feeds the x axis sample and hold.
-                */
-
-               alg_xsh = data ^ 0x80;
-
-               alg_update ();
-
-               break;
-            case 0x2:
-               via_ddrb = data;
-               bankswitchstate = BS_1;
-               if(!big || (data & 0x40))
-                  newbankswitchOffset = 0;
-               else
-                  newbankswitchOffset = 32768;
-               break;
-            case 0x3:
-               via_ddra = data;
-               if(bankswitchstate == BS_1)
-                  bankswitchstate = BS_2;
-               else
-                  bankswitchstate = BS_0;
-               break;
-            case 0x4:
-               /* T1 low order counter */
-
-               if(bankswitchstate == BS_5)
-               {
-                  bankswitchOffset = newbankswitchOffset;
-                  bankswitchstate = BS_0;
-               }
-               via_t1ll = data;
-
-               break;
-            case 0x5:
-               /* T1 high order counter */
-
-               via_t1lh = data;
-               via_t1c = (via_t1lh << 8) | via_t1ll;
-               via_ifr &= 0xbf; /* remove timer 1 interrupt flag */
-
-               via_t1on = 1; /* timer 1 starts running */
-               via_t1int = 1;
-               via_t1pb7 = 0;
-
-               int_update ();
-
-               break;
-            case 0x6:
-               /* T1 low order latch */
-
-               via_t1ll = data;
-               break;
-            case 0x7:
-               /* T1 high order latch */
-
-               via_t1lh = data;
-               break;
-            case 0x8:
-               /* T2 low order latch */
-
-               via_t2ll = data;
-               break;
-            case 0x9:
-               /* T2 high order latch/counter */
-
-               via_t2c = (data << 8) | via_t2ll;
-               via_ifr &= 0xdf;
-
-               via_t2on = 1; /* timer 2 starts running */
-               via_t2int = 1;
-
-               int_update ();
-
-               break;
-            case 0xa:
-               via_sr = data;
-               via_ifr &= 0xfb; /* remove shift register interrupt flag */
-               via_srb = 0;
-               via_srclk = 1;
-
-               int_update ();
-
-               break;
-            case 0xb:
-               via_acr = data;
-               if(bankswitchstate == BS_4)
-               {
-                  if (data == 0x98)
-                     bankswitchstate = BS_5;
-                  else
-                     bankswitchstate = BS_0;
-               }
-               else
-                  bankswitchstate = BS_0;
-               break;
-            case 0xc:
-               via_pcr = data;
-
-               /* ca2 is outputting low */
-               if ((via_pcr & 0x0e) == 0x0c)
-                  via_ca2 = 0;
-               else
-               {
-                  /* ca2 is disabled or in pulse mode or is
-                   * outputting high.
-                   */
-                  via_ca2 = 1;
-               }
-
-               /* cb2 is outputting low */
-               if ((via_pcr & 0xe0) == 0xc0)
-                  via_cb2h = 0;
-               else
-               {
-                  /* cb2 is disabled or is in pulse mode or is
-                   * outputting high.
-                   */
-                  via_cb2h = 1;
-               }
-
-               break;
-            case 0xd:
-               /* interrupt flag register */
-
-               via_ifr &= ~(data & 0x7f);
-               int_update ();
-
-               break;
-            case 0xe:
-               /* interrupt enable register */
-
-               if (data & 0x80)
-                  via_ier |= data & 0x7f;
-               else
-                  via_ier &= ~(data & 0x7f);
-
-               int_update ();
-
-               break;
+            if (data == 0)
+               vc->bankswitchstate = BS_4;
+            else
+               vc->bankswitchstate = BS_0;
          }
-      }
+         else
+            vc->bankswitchstate = BS_0;
+
+         /* if ca2 is in pulse mode or handshake mode, then it
+          * goes low whenever ora is written.
+          */
+         if ((vc->via_pcr & 0x0e) == 0x08)
+            vc->via_ca2 = 0;
+
+         /* fall through */
+
+      case 0xf:
+         vc->via_ora = data;
+
+         snd_update (vc);
+
+         /* output of port a feeds directly into the dac which then
+          * feeds the x axis sample and hold.
+          */
+
+         vc->alg_xsh = data ^ 0x80;
+
+         alg_update (vc);
+
+         break;
+      case 0x2:
+         vc->via_ddrb = data;
+         vc->bankswitchstate = BS_1;
+         if(!vc->big || (data & 0x40))
+            vc->newbankswitchOffset = 0;
+         else
+            vc->newbankswitchOffset = 32768;
+         break;
+      case 0x3:
+         vc->via_ddra = data;
+         if(vc->bankswitchstate == BS_1)
+            vc->bankswitchstate = BS_2;
+         else
+            vc->bankswitchstate = BS_0;
+         break;
+      case 0x4:
+         /* T1 low order counter */
+
+         if(vc->bankswitchstate == BS_5)
+         {
+            vc->bankswitchOffset = vc->newbankswitchOffset;
+            vc->bankswitchstate = BS_0;
+            map_cart (vc);
+         }
+         vc->via_t1ll = data;
+
+         break;
+      case 0x5:
+         /* T1 high order counter */
+
+         vc->via_t1lh = data;
+         vc->via_t1c = (vc->via_t1lh << 8) | vc->via_t1ll;
+         vc->via_ifr &= 0xbf; /* remove timer 1 interrupt flag */
+
+         vc->via_t1on = 1; /* timer 1 starts running */
+         vc->via_t1int = 1;
+         vc->via_t1pb7 = 0;
+
+         int_update (vc);
+
+         break;
+      case 0x6:
+         /* T1 low order latch */
+
+         vc->via_t1ll = data;
+         break;
+      case 0x7:
+         /* T1 high order latch */
+
+         vc->via_t1lh = data;
+         break;
+      case 0x8:
+         /* T2 low order latch */
+
+         vc->via_t2ll = data;
+         break;
+      case 0x9:
+         /* T2 high order latch/counter */
+
+         vc->via_t2c = (data << 8) | vc->via_t2ll;
+         vc->via_ifr &= 0xdf;
+
+         vc->via_t2on = 1; /* timer 2 starts running */
+         vc->via_t2int = 1;
+
+         int_update (vc);
+
+         break;
+      case 0xa:
+         vc->via_sr = data;
+         vc->via_ifr &= 0xfb; /* remove shift register interrupt flag */
+         vc->via_srb = 0;
+         vc->via_srclk = 1;
+
+         int_update (vc);
+
+         break;
+      case 0xb:
+         vc->via_acr = data;
+         if(vc->bankswitchstate == BS_4)
+         {
+            if (data == 0x98)
+               vc->bankswitchstate = BS_5;
+            else
+               vc->bankswitchstate = BS_0;
+         }
+         else
+            vc->bankswitchstate = BS_0;
+         break;
+      case 0xc:
+         vc->via_pcr = data;
+
+         /* ca2 is outputting low */
+         if ((vc->via_pcr & 0x0e) == 0x0c)
+            vc->via_ca2 = 0;
+         else
+         {
+            /* ca2 is disabled or in pulse mode or is
+             * outputting high.
+             */
+            vc->via_ca2 = 1;
+         }
+
+         /* cb2 is outputting low */
+         if ((vc->via_pcr & 0xe0) == 0xc0)
+            vc->via_cb2h = 0;
+         else
+         {
+            /* cb2 is disabled or is in pulse mode or is
+             * outputting high.
+             */
+            vc->via_cb2h = 1;
+         }
+
+         break;
+      case 0xd:
+         /* interrupt flag register */
+
+         vc->via_ifr &= ~(data & 0x7f);
+         int_update (vc);
+
+         break;
+      case 0xe:
+         /* interrupt enable register */
+
+         if (data & 0x80)
+            vc->via_ier |= data & 0x7f;
+         else
+            vc->via_ier &= ~(data & 0x7f);
+
+         int_update (vc);
+
+         break;
+   }
+}
+
+static void write8 (void *user, unsigned address, unsigned char data)
+{
+   vecx_context_t *vc = (vecx_context_t *) user;
+   unsigned char *page = vc->write_map[address >> 8];
+
+   if (page)
+      page[address & 0xff] = data;
+   else
+   {
+      vecx_catchup (vc);
+      io_write8 (vc, address, data);
+      vc->via_window = 0;
    }
-   else if (address < 0x8000) { } /* cartridge */
 }
 
-void vecx_reset (void)
+void vecx_reset (vecx_context_t *vc)
 {
 	unsigned r;
 
 	/* ram */
 
 	for (r = 0; r < 1024; r++)
-		vecx_ram[r] = r & 0xff;
+		vc->ram[r] = r & 0xff;
 
 	for (r = 0; r < 16; r++)
    {
-		snd_regs[r] = 0;
-		e8910_write(r, 0);
+		vc->psg.snd_regs[r] = 0;
+		e8910_write(&vc->psg, r, 0);
 	}
 
 	/* input buttons */
 
-	snd_regs[14] = 0xff;
-	e8910_write(14, 0xff);
-
-	snd_select = 0;
-
-	via_ora = 0;
-	via_orb = 0;
-	via_ddra = 0;
-	via_ddrb = 0;
-	via_t1on = 0;
-	via_t1int = 0;
-	via_t1c = 0;
-	via_t1ll = 0;
-	via_t1lh = 0;
-	via_t1pb7 = 0x80;
-	via_t2on = 0;
-	via_t2int = 0;
-	via_t2c = 0;
-	via_t2ll = 0;
-	via_sr = 0;
-	via_srb = 8;
-	via_src = 0;
-	via_srclk = 0;
-	via_acr = 0;
-	via_pcr = 0;
-	via_ifr = 0;
-	via_ier = 0;
-	via_ca2 = 1;
-	via_cb2h = 1;
-	via_cb2s = 0;
-
-	alg_rsh = 128;
-	alg_xsh = 128;
-	alg_ysh = 128;
-	alg_zsh = 0;
-	alg_jch0 = 128;
-	alg_jch1 = 128;
-	alg_jch2 = 128;
-	alg_jch3 = 128;
-	alg_jsh = 128;
-
-	alg_compare = 0; /* check this */
-
-	alg_dx = 0;
-	alg_dy = 0;
-	alg_curr_x = ALG_MAX_X / 2;
-	alg_curr_y = ALG_MAX_Y / 2;
-
-	alg_vectoring = 0;
-
-	vector_draw_cnt = 0;
-	vector_erse_cnt = 0;
-	vectors_draw = vectors_set;
-	vectors_erse = vectors_set + VECTOR_CNT;
-
-	fcycles = FCYCLES_INIT;
-
-	e6809_read8 = read8;
-	e6809_write8 = write8;
-
-	e6809_reset ();
+	vc->psg.snd_regs[14] = 0xff;
+	e8910_write(&vc->psg, 14, 0xff);
+
+	vc->snd_select = 0;
+
+	vc->via_ora = 0;
+	vc->via_orb = 0;
+	vc->via_ddra = 0;
+	vc->via_ddrb = 0;
+	vc->via_t1on = 0;
+	vc->via_t1int = 0;
+	vc->via_t1c = 0;
+	vc->via_t1ll = 0;
+	vc->via_t1lh = 0;
+	vc->via_t1pb7 = 0x80;
+	vc->via_t2on = 0;
+	vc->via_t2int = 0;
+	vc->via_t2c = 0;
+	vc->via_t2ll = 0;
+	vc->via_sr = 0;
+	vc->via_srb = 8;
+	vc->via_src = 0;
+	vc->via_srclk = 0;
+	vc->via_acr = 0;
+	vc->via_pcr = 0;
+	vc->via_ifr = 0;
+	vc->via_ier = 0;
+	vc->via_ca2 = 1;
+	vc->via_cb2h = 1;
+	vc->via_cb2s = 0;
+
+	vc->alg_rsh = 128;
+	vc->alg_xsh = 128;
+	vc->alg_ysh = 128;
+	vc->alg_zsh = 0;
+	vc->alg_jch0 = 128;
+	vc->alg_jch1 = 128;
+	vc->alg_jch2 = 128;
+	vc->alg_jch3 = 128;
+	vc->alg_jsh = 128;
+
+	vc->alg_compare = 0; /* check this */
+
+	vc->alg_dx = 0;
+	vc->alg_dy = 0;
+	vc->alg_curr_x = ALG_MAX_X / 2;
+	vc->alg_curr_y = ALG_MAX_Y / 2;
+
+	vc->alg_vectoring = 0;
+
+	vc->vector_draw_cnt = 0;
+	vc->vector_erse_cnt = 0;
+	vc->vectors_draw = vc->vectors_set;
+	vc->vectors_erse = vc->vectors_set + VECTOR_CNT;
+	vector_hash_reset (vc);
+
+	vc->fcycles = FCYCLES_INIT;
+
+	vc->via_lag = 0;
+	vc->via_window = 0;
+
+	map_init (vc);
+
+	vc->cpu.user = vc;
+	vc->cpu.read8 = read8;
+	vc->cpu.write8 = write8;
+	vc->cpu.fetch_map = vc->read_map;
+
+	e6809_reset (&vc->cpu);
 }
 
 /* perform a single cycle worth of via emulation.
  * via_sstep0 is the first postion of the emulation.
  */
 
-static einline void via_sstep0 (void)
+static einline void via_sstep0 (vecx_context_t *vc)
 {
 	unsigned t2shift;
 
-	if (via_t1on)
+	if (vc->via_t1on)
    {
-      via_t1c--;
+      vc->via_t1c--;
 
-      if ((via_t1c & 0xffff) == 0xffff)
+      if ((vc->via_t1c & 0xffff) == 0xffff)
       {
          /* counter just rolled over */
 
-         if (via_acr & 0x40)
+         if (vc->via_acr & 0x40)
          {
             /* continuous interrupt mode */
 
-            via_ifr |= 0x40;
-            int_update ();
-            via_t1pb7 = 0x80 - via_t1pb7;
+            vc->via_ifr |= 0x40;
+            int_update (vc);
+            vc->via_t1pb7 = 0x80 - vc->via_t1pb7;
 
             /* reload counter */
 
-            via_t1c = (via_t1lh << 8) | via_t1ll;
+            vc->via_t1c = (vc->via_t1lh << 8) | vc->via_t1ll;
          }
          else
          {
             /* one shot mode */
 
-            if (via_t1int)
+            if (vc->via_t1int)
             {
-               via_ifr |= 0x40;
-               int_update ();
-               via_t1pb7 = 0x80;
-               via_t1int = 0;
+               vc->via_ifr |= 0x40;
+               int_update (vc);
+               vc->via_t1pb7 = 0x80;
+               vc->via_t1int = 0;
             }
          }
       }
    }
 
-	if (via_t2on && (via_acr & 0x20) == 0x00)
+	if (vc->via_t2on && (vc->via_acr & 0x20) == 0x00)
    {
-		via_t2c--;
+		vc->via_t2c--;
 
-		if ((via_t2c & 0xffff) == 0xffff)
+		if ((vc->via_t2c & 0xffff) == 0xffff)
       {
 			/* one shot mode */
 
-			if (via_t2int)
+			if (vc->via_t2int)
          {
-				via_ifr |= 0x20;
-				int_update ();
-				via_t2int = 0;
+				vc->via_ifr |= 0x20;
+				int_update (vc);
+				vc->via_t2int = 0;
 			}
 		}
 	}
 
 	/* shift counter */
 
-	via_src--;
+	vc->via_src--;
 
-	if ((via_src & 0xff) == 0xff) {
-		via_src = via_t2ll;
+	if ((vc->via_src & 0xff) == 0xff) {
+		vc->via_src = vc->via_t2ll;
 
-		if (via_srclk) {
+		if (vc->via_srclk) {
 			t2shift = 1;
-			via_srclk = 0;
+			vc->via_srclk = 0;
 		} else {
 			t2shift = 0;
-			via_srclk = 1;
+			vc->via_srclk = 1;
 		}
 	} else {
 		t2shift = 0;
 	}
 
-	if (via_srb < 8) {
-		switch (via_acr & 0x1c) {
+	if (vc->via_srb < 8) {
+		switch (vc->via_acr & 0x1c) {
 		case 0x00:
 			/* disabled */
 			break;
@@ -884,16 +891,16 @@ static einline void via_sstep0 (void)
 			if (t2shift) {
 				/* shifting in 0s since cb2 is always an output */
 
-				via_sr <<= 1;
-				via_srb++;
+				vc->via_sr <<= 1;
+				vc->via_srb++;
 			}
 
 			break;
 		case 0x08:
 			/* shift in under system clk control */
 
-			via_sr <<= 1;
-			via_srb++;
+			vc->via_sr <<= 1;
+			vc->via_srb++;
 
 			break;
 		case 0x0c:
@@ -903,10 +910,10 @@ static einline void via_sstep0 (void)
 			/* shift out under t2 control (free run) */
 
 			if (t2shift) {
-				via_cb2s = (via_sr >> 7) & 1;
+				vc->via_cb2s = (vc->via_sr >> 7) & 1;
 
-				via_sr <<= 1;
-				via_sr |= via_cb2s;
+				vc->via_sr <<= 1;
+				vc->via_sr |= vc->via_cb2s;
 			}
 
 			break;
@@ -914,22 +921,22 @@ static einline void via_sstep0 (void)
 			/* shift out under t2 control */
 
 			if (t2shift) {
-				via_cb2s = (via_sr >> 7) & 1;
+				vc->via_cb2s = (vc->via_sr >> 7) & 1;
 
-				via_sr <<= 1;
-				via_sr |= via_cb2s;
-				via_srb++;
+				vc->via_sr <<= 1;
+				vc->via_sr |= vc->via_cb2s;
+				vc->via_srb++;
 			}
 
 			break;
 		case 0x18:
 			/* shift out under system clock control */
 
-			via_cb2s = (via_sr >> 7) & 1;
+			vc->via_cb2s = (vc->via_sr >> 7) & 1;
 
-			via_sr <<= 1;
-			via_sr |= via_cb2s;
-			via_srb++;
+			vc->via_sr <<= 1;
+			vc->via_sr |= vc->via_cb2s;
+			vc->via_srb++;
 
 			break;
 		case 0x1c:
@@ -937,111 +944,118 @@ static einline void via_sstep0 (void)
 			break;
 		}
 
-		if (via_srb == 8) {
-			via_ifr |= 0x04;
-			int_update ();
+		if (vc->via_srb == 8) {
+			vc->via_ifr |= 0x04;
+			int_update (vc);
 		}
 	}
 }
 
 /* perform the second part of the via emulation */
 
-static einline void via_sstep1 (void)
+static einline void via_sstep1 (vecx_context_t *vc)
 {
    /* if ca2 is in pulse mode, then make sure
     * it gets restored to '1' after the pulse.
     */
-   if ((via_pcr & 0x0e) == 0x0a)
-      via_ca2 = 1;
+   if ((vc->via_pcr & 0x0e) == 0x0a)
+      vc->via_ca2 = 1;
 
    /* if cb2 is in pulse mode, then make sure
     * it gets restored to '1' after the pulse.
     */
-   if ((via_pcr & 0xe0) == 0xa0)
-      via_cb2h = 1;
+   if ((vc->via_pcr & 0xe0) == 0xa0)
+      vc->via_cb2h = 1;
 }
 
-static einline void alg_addline(
+static einline void alg_addline(vecx_context_t *vc,
       long x0, long y0,
       long x1, long y1, unsigned char color)
 {
-   unsigned long key;
-   long index;
+   unsigned key = vector_key (x0, y0, x1, y1);
+   unsigned slot;
+   vector_t *v;
 
-   key = (unsigned long) x0;
-   key = key * 31 + (unsigned long) y0;
-   key = key * 31 + (unsigned long) x1;
-   key = key * 31 + (unsigned long) y1;
-   key %= VECTOR_HASH;
+   vc->stats.lines++;
 
    /* first check if the line to be drawn is in the current draw list.
     * if it is, then it is not added again.
     */
 
-   index = vector_hash[key];
-
-   if (index >= 0 && index < vector_draw_cnt &&
-         x0 == vectors_draw[index].x0 &&
-         y0 == vectors_draw[index].y0 &&
-         x1 == vectors_draw[index].x1 &&
-         y1 == vectors_draw[index].y1) {
-      vectors_draw[index].color = color;
-   } else {
-      /* missed on the draw list, now check if the line to be drawn is in
-       * the erase list ... if it is, "invalidate" it on the erase list.
-       */
+   for (slot = key; vc->vector_hash_draw[slot].gen == vc->vector_draw_gen;
+         slot = (slot + 1) & (VECTOR_HASH - 1))
+   {
+      v = vc->vectors_draw + vc->vector_hash_draw[slot].index;
 
-      if (index >= 0 && index < vector_erse_cnt &&
-            x0 == vectors_erse[index].x0 &&
-            y0 == vectors_erse[index].y0 &&
-            x1 == vectors_erse[index].x1 &&
-            y1 == vectors_erse[index].y1) {
-         vectors_erse[index].color = VECTREX_COLORS;
+      if (x0 == v->x0 && y0 == v->y0 && x1 == v->x1 && y1 == v->y1)
+      {
+         v->color = color;
+         vc->stats.lines_dedup++;
+         return;
       }
+   }
+
+   /* missed on the draw list, now check if the line to be drawn is in
+    * the erase list ... if it is, "invalidate" it on the erase list.
+    */
+
+   vc->vector_hash_draw[slot].gen = vc->vector_draw_gen;
+   vc->vector_hash_draw[slot].index = (unsigned short) vc->vector_draw_cnt;
+
+   for (slot = key; vc->vector_hash_erse[slot].gen == vc->vector_erse_gen;
+         slot = (slot + 1) & (VECTOR_HASH - 1))
+   {
+      v = vc->vectors_erse + vc->vector_hash_erse[slot].index;
 
-      vectors_draw[vector_draw_cnt].x0 = x0;
-      vectors_draw[vector_draw_cnt].y0 = y0;
-      vectors_draw[vector_draw_cnt].x1 = x1;
-      vectors_draw[vector_draw_cnt].y1 = y1;
-      vectors_draw[vector_draw_cnt].color = color;
-      vector_hash[key] = vector_draw_cnt;
-      vector_draw_cnt++;
+      if (x0 == v->x0 && y0 == v->y0 && x1 == v->x1 && y1 == v->y1)
+      {
+         v->color = VECTREX_COLORS;
+         break;
+      }
    }
+
+   v = vc->vectors_draw + vc->vector_draw_cnt;
+   v->x0 = (unsigned short) x0;
+   v->y0 = (unsigned short) y0;
+   v->x1 = (unsigned short) x1;
+   v->y1 = (unsigned short) y1;
+   v->color = color;
+   vc->vector_draw_cnt++;
 }
 
 /* perform a single cycle worth of analog emulation */
 
-static einline void alg_sstep (void)
+static einline void alg_sstep (vecx_context_t *vc)
 {
    long sig_dx, sig_dy;
    unsigned sig_ramp;
    unsigned sig_blank;
 
-   if ((via_acr & 0x10) == 0x10)
-      sig_blank = via_cb2s;
+   if ((vc->via_acr & 0x10) == 0x10)
+      sig_blank = vc->via_cb2s;
    else
-      sig_blank = via_cb2h;
+      sig_blank = vc->via_cb2h;
 
-   if (via_ca2 == 0)
+   if (vc->via_ca2 == 0)
    {
       /* need to force the current point to the 'orgin' so just
        * calculate distance to origin and use that as dx,dy.
        */
 
-      sig_dx = ALG_MAX_X / 2 - alg_curr_x;
-      sig_dy = ALG_MAX_Y / 2 - alg_curr_y;
+      sig_dx = ALG_MAX_X / 2 - vc->alg_curr_x;
+      sig_dy = ALG_MAX_Y / 2 - vc->alg_curr_y;
    }
    else
    {
-      if (via_acr & 0x80)
-         sig_ramp = via_t1pb7;
+      if (vc->via_acr & 0x80)
+         sig_ramp = vc->via_t1pb7;
       else
-         sig_ramp = via_orb & 0x80;
+         sig_ramp = vc->via_orb & 0x80;
 
       if (sig_ramp == 0)
       {
-         sig_dx = alg_dx;
-         sig_dy = alg_dy;
+         sig_dx = vc->alg_dx;
+         sig_dy = vc->alg_dy;
       }
       else
       {
@@ -1050,22 +1064,22 @@ static einline void alg_sstep (void)
       }
    }
 
-   if (alg_vectoring == 0)
+   if (vc->alg_vectoring == 0)
    {
       if (sig_blank == 1 &&
-            alg_curr_x >= 0 && alg_curr_x < ALG_MAX_X &&
-            alg_curr_y >= 0 && alg_curr_y < ALG_MAX_Y) {
+            vc->alg_curr_x >= 0 && vc->alg_curr_x < ALG_MAX_X &&
+            vc->alg_curr_y >= 0 && vc->alg_curr_y < ALG_MAX_Y) {
 
          /* start a new vector */
 
-         alg_vectoring = 1;
-         alg_vector_x0 = alg_curr_x;
-         alg_vector_y0 = alg_curr_y;
-         alg_vector_x1 = alg_curr_x;
-         alg_vector_y1 = alg_curr_y;
-         alg_vector_dx = sig_dx;
-         alg_vector_dy = sig_dy;
-         alg_vector_color = (unsigned char) alg_zsh;
+         vc->alg_vectoring = 1;
+         vc->alg_vector_x0 = vc->alg_curr_x;
+         vc->alg_vector_y0 = vc->alg_curr_y;
+         vc->alg_vector_x1 = vc->alg_curr_x;
+         vc->alg_vector_y1 = vc->alg_curr_y;
+         vc->alg_vector_dx = sig_dx;
+         vc->alg_vector_dy = sig_dy;
+         vc->alg_vector_color = (unsigned char) vc->alg_zsh;
       }
    }
    else
@@ -1078,99 +1092,372 @@ static einline void alg_sstep (void)
           * new line.
           */
 
-         alg_vectoring = 0;
+         vc->alg_vectoring = 0;
 
-         alg_addline (alg_vector_x0, alg_vector_y0,
-               alg_vector_x1, alg_vector_y1,
-               alg_vector_color);
+         alg_addline (vc, vc->alg_vector_x0, vc->alg_vector_y0,
+               vc->alg_vector_x1, vc->alg_vector_y1,
+               vc->alg_vector_color);
       }
-      else if (sig_dx != alg_vector_dx ||
-            sig_dy != alg_vector_dy ||
-            (unsigned char) alg_zsh != alg_vector_color)
+      else if (sig_dx != vc->alg_vector_dx ||
+            sig_dy != vc->alg_vector_dy ||
+            (unsigned char) vc->alg_zsh != vc->alg_vector_color)
       {
          /* the parameters of the vectoring processing has changed.
           * so end the current line.
           */
 
-         alg_addline (alg_vector_x0, alg_vector_y0,
-               alg_vector_x1, alg_vector_y1,
-               alg_vector_color);
+         alg_addline (vc, vc->alg_vector_x0, vc->alg_vector_y0,
+               vc->alg_vector_x1, vc->alg_vector_y1,
+               vc->alg_vector_color);
 
          /* we continue vectoring with a new set of parameters if the
           * current point is not out of limits.
           */
 
-         if (alg_curr_x >= 0 && alg_curr_x < ALG_MAX_X &&
-               alg_curr_y >= 0 && alg_curr_y < ALG_MAX_Y)
+         if (vc->alg_curr_x >= 0 && vc->alg_curr_x < ALG_MAX_X &&
+               vc->alg_curr_y >= 0 && vc->alg_curr_y < ALG_MAX_Y)
          {
-            alg_vector_x0 = alg_curr_x;
-            alg_vector_y0 = alg_curr_y;
-            alg_vector_x1 = alg_curr_x;
-            alg_vector_y1 = alg_curr_y;
-            alg_vector_dx = sig_dx;
-            alg_vector_dy = sig_dy;
-            alg_vector_color = (unsigned char) alg_zsh;
+            vc->alg_vector_x0 = vc->alg_curr_x;
+            vc->alg_vector_y0 = vc->alg_curr_y;
+            vc->alg_vector_x1 = vc->alg_curr_x;
+            vc->alg_vector_y1 = vc->alg_curr_y;
+            vc->alg_vector_dx = sig_dx;
+            vc->alg_vector_dy = sig_dy;
+            vc->alg_vector_color = (unsigned char) vc->alg_zsh;
          }
          else
-            alg_vectoring = 0;
+            vc->alg_vectoring = 0;
       }
    }
 
-   alg_curr_x += sig_dx;
-   alg_curr_y += sig_dy;
+   vc->alg_curr_x += sig_dx;
+   vc->alg_curr_y += sig_dy;
 
-   if (alg_vectoring == 1 &&
-         alg_curr_x >= 0 && alg_curr_x < ALG_MAX_X &&
-         alg_curr_y >= 0 && alg_curr_y < ALG_MAX_Y)
+   if (vc->alg_vectoring == 1 &&
+         vc->alg_curr_x >= 0 && vc->alg_curr_x < ALG_MAX_X &&
+         vc->alg_curr_y >= 0 && vc->alg_curr_y < ALG_MAX_Y)
    {
       /* we're vectoring ... current point is still within limits so
        * extend the current vector.
        */
 
-      alg_vector_x1 = alg_curr_x;
-      alg_vector_y1 = alg_curr_y;
+      vc->alg_vector_x1 = vc->alg_curr_x;
+      vc->alg_vector_y1 = vc->alg_curr_y;
    }
 }
 
-int vecx_emu (long cycles)
+/* advance the analog devices by a number of cycles during which none of
+ * the via outputs driving them change. the integrators move in a straight
+ * line so the common cases (beam moving blanked, beam extending the vector
+ * being drawn) are computed in closed form. anything else, such as a
+ * vector starting or leaving the screen, is stepped a cycle at a time.
+ */
+
+static einline void alg_sspan (vecx_context_t *vc, unsigned cycles)
 {
-   unsigned c, icycles;
-   int ret = 0;
+   long sig_dx, sig_dy;
+   long end_x, end_y;
+   unsigned sig_blank;
+
+   if ((vc->via_acr & 0x10) == 0x10)
+      sig_blank = vc->via_cb2s;
+   else
+      sig_blank = vc->via_cb2h;
+
+   if (vc->via_ca2 == 0)
+   {
+      /* integrators are being zeroed, the distance to the origin changes
+       * every cycle so there is no closed form.
+       */
+
+      while (cycles-- > 0)
+         alg_sstep (vc);
+
+      return;
+   }
+
+   if (((vc->via_acr & 0x80) ? vc->via_t1pb7 : (vc->via_orb & 0x80)) == 0)
+   {
+      sig_dx = vc->alg_dx;
+      sig_dy = vc->alg_dy;
+   }
+   else
+   {
+      sig_dx = 0;
+      sig_dy = 0;
+   }
+
+   while (cycles > 0)
+   {
+      if (vc->alg_vectoring == 0 && sig_blank == 0)
+      {
+         /* blanked beam, just move it */
+
+         vc->alg_curr_x += sig_dx * (long) cycles;
+         vc->alg_curr_y += sig_dy * (long) cycles;
+
+         return;
+      }
+
+      if (vc->alg_vectoring == 1 && sig_blank == 1 &&
+            sig_dx == vc->alg_vector_dx && sig_dy == vc->alg_vector_dy &&
+            (unsigned char) vc->alg_zsh == vc->alg_vector_color)
+      {
+         /* extending the current vector. the screen is convex so if the
+          * first and last points of the span are within limits, so are
+          * all the ones in between.
+          */
+
+         end_x = vc->alg_curr_x + sig_dx * (long) cycles;
+         end_y = vc->alg_curr_y + sig_dy * (long) cycles;
+
+         if (end_x >= 0 && end_x < ALG_MAX_X &&
+               end_y >= 0 && end_y < ALG_MAX_Y &&
+               vc->alg_curr_x + sig_dx >= 0 && vc->alg_curr_x + sig_dx < ALG_MAX_X &&
+               vc->alg_curr_y + sig_dy >= 0 && vc->alg_curr_y + sig_dy < ALG_MAX_Y)
+         {
+            vc->alg_curr_x = end_x;
+            vc->alg_curr_y = end_y;
+            vc->alg_vector_x1 = end_x;
+            vc->alg_vector_y1 = end_y;
+
+            return;
+         }
+      }
+
+      alg_sstep (vc);
+      cycles--;
+   }
+}
+
+/* number of cycles from now that can be emulated in bulk, that is without
+ * any via event (timer interrupt, pb7 toggle, shift register clock or
+ * ca2/cb2 pulse) happening. returns 0 if the next cycle must be stepped.
+ */
+
+static einline unsigned via_quiet (vecx_context_t *vc, unsigned cycles)
+{
+   unsigned n = cycles;
+
+   /* a pulse on ca2 or cb2 is about to be restored */
+   if ((vc->via_pcr & 0x0e) == 0x0a && vc->via_ca2 == 0)
+      return 0;
+
+   if ((vc->via_pcr & 0xe0) == 0xa0 && vc->via_cb2h == 0)
+      return 0;
+
+   /* shift register is running */
+   if (vc->via_srb < 8 && (vc->via_acr & 0x1c) != 0x00 &&
+         (vc->via_acr & 0x0c) != 0x0c)
+      return 0;
+
+   /* the rollover happens on the cycle after the counter reaches 0 */
+   if (vc->via_t1on && ((vc->via_acr & 0x40) || vc->via_t1int))
+   {
+      if ((vc->via_t1c & 0xffff) < n)
+         n = vc->via_t1c & 0xffff;
+   }
+
+   if (vc->via_t2on && (vc->via_acr & 0x20) == 0x00 && vc->via_t2int)
+   {
+      if ((vc->via_t2c & 0xffff) < n)
+         n = vc->via_t2c & 0xffff;
+   }
+
+   return n;
+}
+
+/* advance the via by a number of cycles known to be quiet */
+
+static einline void via_sstepn (vecx_context_t *vc, unsigned cycles)
+{
+   unsigned first, period, rest;
+
+   if (vc->via_t1on)
+      vc->via_t1c -= cycles;
+
+   if (vc->via_t2on && (vc->via_acr & 0x20) == 0x00)
+      vc->via_t2c -= cycles;
+
+   /* shift counter, reloaded from the t2 low latch every time it
+    * rolls over.
+    */
+
+   first = (vc->via_src & 0xff) + 1;
+
+   if (cycles < first)
+      vc->via_src -= cycles;
+   else
+   {
+      period = (vc->via_t2ll & 0xff) + 1;
+      rest   = cycles - first;
+
+      vc->via_src = vc->via_t2ll - rest % period;
+
+      if ((rest / period) % 2 == 0)
+         vc->via_srclk = !vc->via_srclk;
+   }
+}
+
+/* bring the via and analog devices up to date with the cpu */
+
+static void vecx_advance (vecx_context_t *vc)
+{
+   unsigned cycles = vc->via_lag;
+
+   vc->snd_cycle += cycles;
 
    while (cycles > 0)
    {
-      icycles = e6809_sstep (via_ifr & 0x80, 0);
+      unsigned quiet = via_quiet (vc, cycles);
 
-      for (c = 0; c < icycles; c++)
+      if (quiet > 0)
+      {
+         via_sstepn (vc, quiet);
+         alg_sspan (vc, quiet);
+         cycles -= quiet;
+      }
+      else
       {
-         via_sstep0 ();
-         alg_sstep ();
-         via_sstep1 ();
+         via_sstep0 (vc);
+         alg_sstep (vc);
+         via_sstep1 (vc);
+         cycles--;
+         vc->stats.steps++;
       }
+   }
 
-      cycles -= (long) icycles;
+   vc->via_lag = 0;
+   vc->via_window = via_quiet (vc, 0x10000);
+}
 
-      fcycles -= (long) icycles;
+static void vecx_catchup (vecx_context_t *vc)
+{
+   uint64_t start, time;
+
+   vc->stats.catchups++;
+
+   if (!vc->clock || vc->stats.catchups % PROFILE_STRIDE != 0)
+   {
+      vecx_advance (vc);
+      return;
+   }
 
-      if (fcycles < 0)
+   start = vc->clock ();
+   vecx_advance (vc);
+   time = vc->clock () - start;
+
+   /* a catchup often takes less time than reading the clock */
+   if (time > vc->clock_bias)
+      vc->stats.via_time += (time - vc->clock_bias) * PROFILE_STRIDE;
+}
+
+static void vecx_render (vecx_context_t *vc)
+{
+   uint64_t start;
+
+   vc->stats.renders++;
+
+   if (!vc->clock)
+   {
+      osint_render (vc);
+      return;
+   }
+
+   start = vc->clock ();
+   osint_render (vc);
+   vc->stats.render_time += vc->clock () - start;
+}
+
+/* account for an instruction and return the state of the irq line.
+ * the irq line cannot change while the devices are inside their quiet
+ * window so they are left behind until it runs out.
+ */
+
+static unsigned vecx_sync (void *user, unsigned cycles)
+{
+   vecx_context_t *vc = (vecx_context_t *) user;
+
+   vc->via_lag += cycles;
+
+   if (vc->via_lag >= vc->via_window)
+      vecx_catchup (vc);
+
+   return vc->via_ifr & 0x80;
+}
+
+int vecx_emu (vecx_context_t *vc, long cycles)
+{
+   long budget, icycles;
+   uint64_t start = 0;
+   int ret = 0;
+
+   vc->snd_cycle = 0;
+   vc->stats.emus++;
+
+   if (vc->clock)
+   {
+      int i;
+
+      /* the cost of reading the clock, the shortest time it can measure */
+      vc->clock_bias = ~(uint64_t) 0;
+
+      for (i = 0; i < 8; i++)
+      {
+         uint64_t time;
+
+         start = vc->clock ();
+         time = vc->clock () - start;
+
+         if (time < vc->clock_bias)
+            vc->clock_bias = time;
+      }
+
+      start = vc->clock ();
+   }
+
+   while (cycles > 0)
+   {
+      /* stop at the end of the frame so it can be redrawn */
+
+      budget = cycles;
+
+      if (budget > vc->fcycles + 1)
+         budget = vc->fcycles + 1;
+
+      icycles = e6809_run (&vc->cpu, budget, vecx_sync);
+      vecx_catchup (vc);
+
+      cycles -= icycles;
+      vc->stats.cycles += icycles;
+
+      vc->fcycles -= icycles;
+
+      if (vc->fcycles < 0)
       {
          vector_t *tmp;
 
-         fcycles += FCYCLES_INIT;
-         osint_render ();
+         vc->fcycles += FCYCLES_INIT;
+         vecx_render (vc);
          ret = 1;
 
          /* everything that was drawn during this pass now now enters
           * the erase list for the next pass.
           */
 
-         vector_erse_cnt = vector_draw_cnt;
-         vector_draw_cnt = 0;
+         vc->vector_erse_cnt = vc->vector_draw_cnt;
+         vc->vector_draw_cnt = 0;
+
+         tmp = vc->vectors_erse;
+         vc->vectors_erse = vc->vectors_draw;
+         vc->vectors_draw = tmp;
 
-         tmp = vectors_erse;
-         vectors_erse = vectors_draw;
-         vectors_draw = tmp;
+         vector_hash_swap (vc);
       }
    }
+
+   if (vc->clock)
+      vc->stats.emu_time += vc->clock () - start;
+
    return ret;
 }
@@ -1,17 +1,40 @@
 #ifndef __VECX_H
 #define __VECX_H
 
+#include <stdint.h>
+
+#include "e6809.h"
+#include "e8910.h"
+
 enum {
 	VECTREX_MHZ		= 1500000, /* speed of the vectrex being emulated */
 	VECTREX_COLORS  = 128,     /* number of possible colors ... grayscale */
+	VECTREX_PDECAY	= 30,      /* phosphor decay rate */
 
 	ALG_MAX_X		= 33000,
-	ALG_MAX_Y		= 41000
+	ALG_MAX_Y		= 41000,
+
+	/* max number of possible vectors that maybe on the screen at one time.
+	 * one only needs VECTREX_MHZ / VECTREX_PDECAY but we need to also store
+	 * deleted vectors in a single table
+	 */
+
+	VECTOR_CNT		= VECTREX_MHZ / VECTREX_PDECAY,
+
+	/* size of a vector dedup table. must be a power of two larger than
+	 * VECTOR_CNT so that a free slot can always be found.
+	 */
+
+	VECTOR_HASH     = 65536
 };
 
+/* coordinates are within [0, ALG_MAX_X) and [0, ALG_MAX_Y) so they are
+ * stored in 16 bits, keeping an entry at 10 bytes.
+ */
+
 typedef struct vector_type {
-	long x0, y0; /* start coordinate */
-	long x1, y1; /* end coordinate */
+	unsigned short x0, y0; /* start coordinate */
+	unsigned short x1, y1; /* end coordinate */
 
 	/* color [0, VECTREX_COLORS - 1], if color = VECTREX_COLORS, then this is
 	 * an invalid entry and must be ignored.
@@ -19,26 +42,179 @@ typedef struct vector_type {
 	unsigned char color;
 } vector_t;
 
-extern unsigned char rom[8192];
-extern unsigned char get_cart(unsigned pos);
-extern void set_cart(unsigned pos, unsigned char data);
+/* dedup tables for the draw and erase lists. a slot belongs to its list
+ * only if it carries the generation stamp of that list, anything else is
+ * free. the tables swap along with the lists so they never need to be
+ * cleared, and no slot expires while its list is in use.
+ */
+
+typedef struct vector_slot_type {
+	unsigned short gen;
+	unsigned short index;
+} vector_slot_t;
+
+/* profile of the emulation, summed over vecx_emu calls until the caller
+ * clears it. the counts are always kept, the times only while the context
+ * has a clock, in whatever units that ticks in.
+ */
+
+typedef struct vecx_stats_type {
+	unsigned long emus;        /* vecx_emu calls */
+	unsigned long cycles;      /* cpu cycles run */
+	unsigned long catchups;    /* times the via and analog caught up */
+	unsigned long steps;       /* ... and cycles they stepped one by one */
+	unsigned long lines;       /* alg_addline calls */
+	unsigned long lines_dedup; /* ... for lines already on the draw list */
+	unsigned long renders;     /* osint_render calls */
+
+	uint64_t emu_time;    /* all of vecx_emu */
+	uint64_t via_time;    /* via and analog, part of emu_time, sampled */
+	uint64_t render_time; /* osint_render, part of emu_time */
+} vecx_stats_t;
+
+/* everything one emulated vectrex is made of. contexts are independent of
+ * each other so any number of them can run at once, one per thread. a
+ * context points into itself and must not be copied once it is reset.
+ */
+
+typedef struct vecx_context {
+	e6809_t cpu;
+	e8910_t psg;
+
+	/* the rest of the machine state. it runs from ram to snd_select and is
+	 * plain data that is saved as it is, new state belongs in there too.
+	 */
+
+	unsigned char ram[1024];
+
+	unsigned newbankswitchOffset;
+	unsigned bankswitchOffset;
+	unsigned bankswitchstate;
+
+	/* the via 6522 registers */
+
+	unsigned via_ora;
+	unsigned via_orb;
+	unsigned via_ddra;
+	unsigned via_ddrb;
+	unsigned via_t1on;  /* is timer 1 on? */
+	unsigned via_t1int; /* are timer 1 interrupts allowed? */
+	unsigned via_t1c;
+	unsigned via_t1ll;
+	unsigned via_t1lh;
+	unsigned via_t1pb7; /* timer 1 controlled version of pb7 */
+	unsigned via_t2on;  /* is timer 2 on? */
+	unsigned via_t2int; /* are timer 2 interrupts allowed? */
+	unsigned via_t2c;
+	unsigned via_t2ll;
+	unsigned via_sr;
+	unsigned via_srb;   /* number of bits shifted so far */
+	unsigned via_src;   /* shift counter */
+	unsigned via_srclk;
+	unsigned via_acr;
+	unsigned via_pcr;
+	unsigned via_ifr;
+	unsigned via_ier;
+	unsigned via_ca2;
+	unsigned via_cb2h;  /* basic handshake version of cb2 */
+	unsigned via_cb2s;  /* version of cb2 controlled by the shift register */
+
+	/* analog devices */
+
+	unsigned alg_rsh;  /* zero ref sample and hold */
+	unsigned alg_xsh;  /* x sample and hold */
+	unsigned alg_ysh;  /* y sample and hold */
+	unsigned alg_zsh;  /* z sample and hold */
+	unsigned alg_jch0; /* joystick direction channel 0 */
+	unsigned alg_jch1; /* joystick direction channel 1 */
+	unsigned alg_jch2; /* joystick direction channel 2 */
+	unsigned alg_jch3; /* joystick direction channel 3 */
+	unsigned alg_jsh;  /* joystick sample and hold */
+
+	unsigned alg_compare;
 
-extern unsigned snd_regs[16];
-extern unsigned alg_jch0;
-extern unsigned alg_jch1;
-extern unsigned alg_jch2;
-extern unsigned alg_jch3;
+	long alg_dx;     /* delta x */
+	long alg_dy;     /* delta y */
+	long alg_curr_x; /* current x position */
+	long alg_curr_y; /* current y position */
+
+	unsigned alg_vectoring; /* are we drawing a vector right now? */
+	long alg_vector_x0;
+	long alg_vector_y0;
+	long alg_vector_x1;
+	long alg_vector_y1;
+	long alg_vector_dx;
+	long alg_vector_dy;
+	unsigned char alg_vector_color;
+
+	long vector_draw_cnt;
+	long vector_erse_cnt;
+
+	long fcycles;
+
+	unsigned snd_select;
+
+	/* the cartridge, and what is rebuilt from the state when it is loaded.
+	 * the vector lists are an exception, the part of the draw list drawn
+	 * so far is saved separately.
+	 */
+
+	unsigned char cart[65536];
+	char big;
+
+	vector_t vectors_set[2 * VECTOR_CNT];
+
+	vector_t *vectors_draw;
+	vector_t *vectors_erse;
+
+	vector_slot_t vector_hash_set[2][VECTOR_HASH];
+	vector_slot_t *vector_hash_draw;
+	vector_slot_t *vector_hash_erse;
+	unsigned short vector_draw_gen;
+	unsigned short vector_erse_gen;
+
+	/* the via and analog devices are only brought up to date with the cpu
+	 * when it accesses io or when via_window cycles have passed, which is
+	 * as long as they can run without an event the cpu could observe.
+	 */
+
+	unsigned via_lag;
+	unsigned via_window;
+
+	unsigned snd_cycle; /* cycles the devices have run in this vecx_emu */
+
+	/* memory map, one entry per 256 byte page. reads and writes to a page
+	 * with a NULL entry go through the io handlers.
+	 */
+
+	unsigned char *read_map[256];
+	unsigned char *write_map[256];
+
+	unsigned char page_ff[256];   /* unmapped space reads as 0xff */
+	unsigned char page_00[256];   /* ... except next to ram and io */
+	unsigned char page_sink[256]; /* writes to rom or unmapped space */
+
+	/* profiling, left alone by vecx_reset. the times are only taken
+	 * while clock is set.
+	 */
+
+	vecx_stats_t stats;
+	uint64_t (*clock) (void);
+	uint64_t clock_bias;
+} vecx_context_t;
+
+/* the bios is shared by all contexts */
+
+extern unsigned char rom[8192];
 
-extern long vector_draw_cnt;
-extern long vector_erse_cnt;
-extern vector_t *vectors_draw;
-extern vector_t *vectors_erse;
+extern unsigned char get_cart(vecx_context_t *vc, unsigned pos);
+extern void set_cart(vecx_context_t *vc, unsigned pos, unsigned char data);
 
 int vecx_statesz();
-int vecx_serialize(char* dst, int size);
-int vecx_deserialize(char* dst, int size);
+int vecx_serialize(vecx_context_t *vc, char* dst, int size);
+int vecx_deserialize(vecx_context_t *vc, char* dst, int size);
 
-void vecx_reset (void);
-int vecx_emu (long cycles);
+void vecx_reset (vecx_context_t *vc);
+int vecx_emu (vecx_context_t *vc, long cycles);
 
 #endif